@@ -0,0 +1,29 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <stdio.h>
+
+/* The microbenchmarks run a piece of kwm in a loop and report the mean time of one
+ * call. Every case is run once before it is timed, so that caches and tables that
+ * are built lazily are warm, and the result of every call is summed into
+ * KwmBenchSink so that the compiler cannot drop the work. */
+
+static volatile long KwmBenchSink = 0;
+
+template<typename F>
+double KwmBenchRun(const char *Name, int Iterations, F Function)
+{
+    KwmBenchSink += Function();
+
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for(int Iteration = 0; Iteration < Iterations; ++Iteration)
+        KwmBenchSink += Function();
+
+    std::chrono::duration<double, std::nano> Duration = std::chrono::steady_clock::now() - Start;
+    double Result = Duration.count() / Iterations;
+    printf("%-40s %10.1fns\n", Name, Result);
+    return Result;
+}
+
+#endif
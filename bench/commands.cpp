@@ -0,0 +1,66 @@
+#include "../kwm/interpreter.h"
+#include "../kwm/cache.h"
+#include "bench.h"
+
+/* A client message is either resolved against the command table or found in the
+ * parsed command cache. Both are timed over the commands that clients repeat, the
+ * same set that tests/command.cpp checks for allocations. */
+
+void KwmInitStubBackend(int Windows);
+
+const char *Commands[] =
+{
+    "config focused-border size 4",
+    "config split-ratio 0.5",
+    "window -f east",
+    "window -s prev",
+    "window -c split-mode toggle",
+    "space -t bsp",
+    "query focused",
+    "query split-mode global",
+    "query dir east wrap",
+};
+
+#define COMMANDS (int) (sizeof(Commands) / sizeof(Commands[0]))
+
+int main()
+{
+    KwmInitStubBackend(4);
+    KwmInitInterpreter();
+
+    std::vector<std::string> Messages(Commands, Commands + COMMANDS);
+    std::vector<std::string> Args;
+    std::string Error;
+    int Next = 0;
+
+    KwmBenchRun("commands: resolve", 1000000, [&]()
+    {
+        kwm_command *Command = NULL;
+        std::string &Message = Messages[Next++ % COMMANDS];
+        return KwmCompileCommand(Message, &Command, Args, Error) ? 1 : 0;
+    });
+
+    for(int Index = 0; Index < COMMANDS; ++Index)
+    {
+        kwm_command *Command = NULL;
+        KwmCompileCommand(Messages[Index], &Command, Args, Error);
+        KwmCacheCommand(Messages[Index], Command, Args);
+    }
+
+    KwmBenchRun("commands: cache hit", 1000000, [&]()
+    {
+        kwm_command *Command = NULL;
+        std::string &Message = Messages[Next++ % COMMANDS];
+        return KwmGetCachedCommand(Message, &Command, Args) ? 1 : 0;
+    });
+
+    std::string Missing = "window -f north";
+    KwmBenchRun("commands: cache miss", 1000000, [&]()
+    {
+        kwm_command *Command = NULL;
+        return KwmGetCachedCommand(Missing, &Command, Args) ? 1 : 0;
+    });
+
+    printf("commands: %s\n", KwmGetCommandCacheStats().c_str());
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "../kwm/define.h"
+#include "bench.h"
+
+#include <map>
+
+/* A generated config of 2000 lines in kwmrc syntax is expanded the way
+ * KwmExecuteFile does it: comments are skipped, 'define' lines add a define and
+ * every other line has the defines substituted. It is timed with the trie in
+ * define.cpp and with the std::map and std::string::find loop that kwm used
+ * before, which replaced only the first occurrence of each define and let a
+ * shorter name such as 'mod' replace the start of 'mod2'. The lines on which the
+ * two disagree are counted. */
+
+#define CONFIG_LINES 2000
+
+const char *Defines[][2] =
+{
+    { "hyper", "cmd+ctrl+alt+shift" },
+    { "mod", "cmd+alt" },
+    { "mod2", "cmd+ctrl" },
+    { "mod3", "mod+shift" },
+    { "term", "/Applications/iTerm2.app" },
+    { "focused_color", "FFBDD322" },
+    { "marked_color", "FFCC5577" },
+    { "ratio_step", "0.05" },
+};
+
+#define DEFINES (int) (sizeof(Defines) / sizeof(Defines[0]))
+
+const char *Keys = "hjklasdfgqwertyuiopzxcvbnm";
+const char *Directions[] = { "west", "south", "north", "east" };
+
+std::vector<std::string> GenerateConfig()
+{
+    std::vector<std::string> Lines;
+    for(int Index = 0; Index < DEFINES; ++Index)
+        Lines.push_back(std::string("define ") + Defines[Index][0] + " " + Defines[Index][1]);
+
+    for(int Index = 0; Index < 32; ++Index)
+        Lines.push_back("define app" + std::to_string(Index) + " /Applications/App" + std::to_string(Index) + ".app");
+
+    for(int Index = 0; (int) Lines.size() < CONFIG_LINES; ++Index)
+    {
+        std::string Key(1, Keys[Index % 26]);
+        switch(Index % 10)
+        {
+            case 0: Lines.push_back("# Bindings for group " + std::to_string(Index / 10)); break;
+            case 1: Lines.push_back("kwmc bind hyper-" + Key + " window -f " + Directions[Index % 4]); break;
+            case 2: Lines.push_back("kwmc bind mod-" + Key + " window -s " + Directions[Index % 4]); break;
+            case 3: Lines.push_back("kwmc bind mod2-" + Key + " space -fExperimental " + std::to_string(Index % 9 + 1)); break;
+            case 4: Lines.push_back("kwmc bind mod3-" + Key + " window -c reduce ratio_step"); break;
+            case 5: Lines.push_back("kwmc bind mod-return sys open -na app" + std::to_string(Index % 32) + " term"); break;
+            case 6: Lines.push_back("kwmc config focused-border color focused_color"); break;
+            case 7: Lines.push_back("kwmc config marked-border color marked_color"); break;
+            case 8: Lines.push_back("kwmc rule owner=\"App" + std::to_string(Index % 32) + "\" properties={float=\"true\"}"); break;
+            case 9: Lines.push_back("kwmc config padding 40 20 20 20"); break;
+        }
+    }
+
+    return Lines;
+}
+
+void KwmDefineLinear(std::map<std::string, std::string> &Defines, const std::string &Line)
+{
+    std::size_t Name = Line.find(' ');
+    std::size_t Value = Line.find(' ', Name + 1);
+    if(Name != std::string::npos && Value != std::string::npos)
+        Defines[Line.substr(Name + 1, Value - Name - 1)] = Line.substr(Value + 1);
+}
+
+void KwmSubstituteDefinesLinear(std::map<std::string, std::string> &Defines, std::string &Line)
+{
+    std::map<std::string, std::string>::iterator It;
+    for(It = Defines.begin(); It != Defines.end(); ++It)
+    {
+        std::size_t Pos = Line.find(It->first);
+        if(Pos != std::string::npos)
+            Line.replace(Pos, It->first.size(), It->second);
+    }
+}
+
+void KwmDefineTrie(kwm_defines *Defines, const std::string &Line)
+{
+    std::size_t Name = Line.find(' ');
+    std::size_t Value = Line.find(' ', Name + 1);
+    if(Name != std::string::npos && Value != std::string::npos)
+        KwmAddDefine(Defines, Line.substr(Name + 1, Value - Name - 1), Line.substr(Value + 1));
+}
+
+void ExpandConfigTrie(std::vector<std::string> &Config, std::vector<std::string> &Output)
+{
+    kwm_defines Defines;
+    KwmInitDefines(&Defines);
+    for(std::size_t Index = 0; Index < Config.size(); ++Index)
+    {
+        std::string &Line = Output[Index];
+        Line = Config[Index];
+        if(Line.empty() || Line[0] == '#')
+            continue;
+
+        if(Line.compare(0, 6, "define") == 0)
+            KwmDefineTrie(&Defines, Line);
+        else
+            KwmSubstituteDefines(&Defines, Line);
+    }
+}
+
+void ExpandConfigLinear(std::vector<std::string> &Config, std::vector<std::string> &Output)
+{
+    std::map<std::string, std::string> Defines;
+    for(std::size_t Index = 0; Index < Config.size(); ++Index)
+    {
+        std::string &Line = Output[Index];
+        Line = Config[Index];
+        if(Line.empty() || Line[0] == '#')
+            continue;
+
+        if(Line.compare(0, 6, "define") == 0)
+            KwmDefineLinear(Defines, Line);
+        else
+            KwmSubstituteDefinesLinear(Defines, Line);
+    }
+}
+
+int main()
+{
+    std::vector<std::string> Config = GenerateConfig();
+    std::vector<std::string> Trie(Config.size()), Linear(Config.size());
+
+    KwmBenchRun("defines: 2000 lines, trie", 200, [&]()
+    {
+        ExpandConfigTrie(Config, Trie);
+        return Trie.size();
+    });
+
+    KwmBenchRun("defines: 2000 lines, map and find", 200, [&]()
+    {
+        ExpandConfigLinear(Config, Linear);
+        return Linear.size();
+    });
+
+    int Differ = 0;
+    for(std::size_t Index = 0; Index < Config.size(); ++Index)
+        Differ += Trie[Index] != Linear[Index];
+
+    printf("defines: the two expansions differ on %d of %zu lines\n", Differ, Config.size());
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "../kwm/types.h"
+#include "../kwm/keys.h"
+#include "../kwm/queue.h"
+#include "bench.h"
+
+/* Every key press goes through KwmProcessKeyEvent on the event tap. With 500
+ * bindings, every modifier combination on 34 keys, it is timed for a bound and
+ * an unbound key, next to a scan of the binding list for the same keys, which is
+ * what the event tap did before the hotkey table. There is no keyboard layout
+ * here, so the keycodes of letters and digits are seeded. */
+
+extern kwm_hotkeys KWMHotkeys;
+
+void KwmInitStubBackend(int Windows);
+void KwmInitInterpreter();
+
+int main()
+{
+    KwmInitStubBackend(4);
+    KwmInitInterpreter();
+    KwmInitKeyQueue(&KWMHotkeys.Queue);
+    KWMHotkeys.Prefix.Timeout = 0.75;
+    KWMHotkeys.SequenceTimeout = 1.0;
+    KwmRebuildHotkeyTable();
+
+    const char *Keys = "abcdefghijklmnopqrstuvwxyz0123456789";
+    for(int Index = 0; Keys[Index]; ++Index)
+        KwmSetCachedKeycode(Keys[Index], Index);
+
+    const char *Mods[] = { "cmd", "alt", "ctrl", "shift", "cmd+alt", "cmd+ctrl", "cmd+shift", "alt+ctrl",
+                           "alt+shift", "ctrl+shift", "cmd+alt+ctrl", "cmd+alt+shift", "cmd+ctrl+shift",
+                           "alt+ctrl+shift", "cmd+alt+ctrl+shift" };
+    std::string Error;
+    for(int Index = 0; Index < 500; ++Index)
+    {
+        std::string KeySym = std::string(Mods[Index % 15]) + "-" + Keys[Index / 15];
+        if(!KwmAddHotkey(KeySym, "window -f east", false, Error))
+        {
+            printf("hotkeys: '%s' was not bound: %s\n", KeySym.c_str(), Error.c_str());
+            return 1;
+        }
+    }
+
+    if(KWMHotkeys.List.size() != 500)
+    {
+        printf("hotkeys: %zu of 500 bindings in the list\n", KWMHotkeys.List.size());
+        return 1;
+    }
+
+    modifiers Bound = { true, true, false, false };
+    modifiers Unbound = {};
+    kwm_key_event Event;
+    bool Passthrough;
+    int Next = 0;
+
+    KwmBenchRun("hotkeys: bound key", 1000000, [&]()
+    {
+        bool Result = KwmProcessKeyEvent(Bound, Next++ % 26, &Passthrough);
+        while(KwmPopKeyEvent(&KWMHotkeys.Queue, &Event));
+        return Result;
+    });
+
+    KwmBenchRun("hotkeys: unbound key", 1000000, [&]()
+    {
+        bool Result = KwmProcessKeyEvent(Unbound, Next++ % 26, &Passthrough);
+        while(KwmPopKeyEvent(&KWMHotkeys.Queue, &Event));
+        return Result;
+    });
+
+    hotkey Key = {};
+    auto ScanBindings = [&]()
+    {
+        Key.Key = Next++ % 26;
+        for(std::size_t Index = 0; Index < KWMHotkeys.List.size(); ++Index)
+        {
+            if(HotkeysAreEqual(&KWMHotkeys.List[Index], &Key))
+                return true;
+        }
+
+        return false;
+    };
+
+    Key.Mod = Bound;
+    KwmBenchRun("hotkeys: scan, bound key", 100000, ScanBindings);
+
+    Key.Mod = Unbound;
+    KwmBenchRun("hotkeys: scan, unbound key", 100000, ScanBindings);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "../kwm/types.h"
+#include "../kwm/rules.h"
+#include "../kwm/regex.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <regex>
+
+/* One rule with an owner and a name pattern is matched against window titles and
+ * compared with the 24 rules of exact owners and title substrings it replaces,
+ * through the rule index and through MatchWindowRule on every rule. Both rule sets
+ * must match the same windows. The DFA in regex.cpp is then timed against
+ * std::regex, which is what a pattern would cost without it. */
+
+extern kwm_tiling KWMTiling;
+
+const char *Owners[] = { "Safari", "Mail", "Xcode", "Finder" };
+const char *Names[] = { "Preferences", "Settings", "Inspector", "Info", "Colors", "Fonts" };
+
+#define OWNERS (int) (sizeof(Owners) / sizeof(Owners[0]))
+#define NAMES (int) (sizeof(Names) / sizeof(Names[0]))
+
+const char *Patterns[] =
+{
+    "^(Preferences|Settings)( - .*)?$",
+    "[Ii]nspector|Console",
+    "\\d+ unread",
+    "^Picture.in.Picture$",
+};
+
+const char *Titles[] =
+{
+    "Preferences - General",
+    "Safari - Apple Developer Documentation for NSWindow and NSPanel",
+    "Web Inspector - github.com",
+    "Inbox (12 unread) - Mail",
+    "Picture in Picture",
+    "kwm - koekeishiya@macbook: ~/repos/kwm - vim kwm/rules.cpp",
+};
+
+#define PATTERNS (int) (sizeof(Patterns) / sizeof(Patterns[0]))
+#define TITLES (int) (sizeof(Titles) / sizeof(Titles[0]))
+
+void AddRegexRule()
+{
+    KwmClearRules();
+    KwmAddRule("owner=/^(Safari|Mail|Xcode|Finder)$/ name=/Preferences|Settings|Inspector|Info|Colors|Fonts/ properties={float=\"true\"}");
+}
+
+void AddExpandedRules()
+{
+    KwmClearRules();
+    for(int Owner = 0; Owner < OWNERS; ++Owner)
+    {
+        for(int Name = 0; Name < NAMES; ++Name)
+            KwmAddRule(std::string("owner=\"") + Owners[Owner] + "\" name=\"" + Names[Name] + "\" properties={float=\"true\"}");
+    }
+}
+
+std::vector<bool> MatchWindows(std::vector<window_info> &Windows)
+{
+    std::vector<bool> Matched;
+    for(std::size_t Index = 0; Index < Windows.size(); ++Index)
+        Matched.push_back(!KwmFindMatchingRules(&Windows[Index]).empty());
+
+    return Matched;
+}
+
+void TimeRules(std::vector<window_info> &Windows, const std::string &Name)
+{
+    int Next = 0;
+    KwmBenchRun(("regex: " + Name + ", index").c_str(), 200000, [&]()
+    {
+        return KwmFindMatchingRules(&Windows[Next++ % Windows.size()]).size();
+    });
+
+    KwmBenchRun(("regex: " + Name + ", every rule").c_str(), 200000, [&]()
+    {
+        window_info *Window = &Windows[Next++ % Windows.size()];
+        int Matches = 0;
+        for(std::size_t Index = 0; Index < KWMTiling.WindowRules.size(); ++Index)
+            Matches += MatchWindowRule(&KWMTiling.WindowRules[Index], Window);
+
+        return Matches;
+    });
+}
+
+int main()
+{
+    const char *WindowOwners[] = { "Safari", "Terminal", "Xcode", "Mail", "Finder", "Slack" };
+    std::vector<window_info> Windows;
+    for(int Index = 0; Index < 64; ++Index)
+    {
+        window_info Window = {};
+        Window.Owner = WindowOwners[Index % 6];
+        Window.Name = Index % 3 ? Titles[Index % TITLES] : std::string(Names[Index % NAMES]) + " - " + std::to_string(Index);
+        Window.WID = Index + 1;
+        Windows.push_back(Window);
+    }
+
+    AddRegexRule();
+    if(KWMTiling.WindowRules.size() != 1)
+    {
+        printf("regex: the regex rule was not parsed\n");
+        return 1;
+    }
+
+    std::vector<bool> RegexMatches = MatchWindows(Windows);
+    TimeRules(Windows, "1 regex rule");
+
+    AddExpandedRules();
+    if(KWMTiling.WindowRules.size() != OWNERS * NAMES)
+    {
+        printf("regex: only %zu of %d substring rules were parsed\n", KWMTiling.WindowRules.size(), OWNERS * NAMES);
+        return 1;
+    }
+
+    if(MatchWindows(Windows) != RegexMatches)
+    {
+        printf("regex: the regex rule and the substring rules match different windows\n");
+        return 1;
+    }
+
+    TimeRules(Windows, "24 substring rules");
+    printf("regex: both rule sets match %d of %zu windows\n",
+           (int) std::count(RegexMatches.begin(), RegexMatches.end(), true), Windows.size());
+
+    std::vector<kwm_regex> Regexes(PATTERNS);
+    std::vector<std::regex> StdRegexes;
+    for(int Index = 0; Index < PATTERNS; ++Index)
+    {
+        std::string Error;
+        if(!KwmCompileRegex(Patterns[Index], &Regexes[Index], Error))
+        {
+            printf("regex: /%s/ does not compile: %s\n", Patterns[Index], Error.c_str());
+            return 1;
+        }
+
+        StdRegexes.push_back(std::regex(Patterns[Index]));
+    }
+
+    std::vector<std::string> Texts(Titles, Titles + TITLES);
+    int Next = 0;
+    KwmBenchRun("regex: dfa", 1000000, [&]()
+    {
+        int Case = Next++;
+        return KwmMatchRegex(&Regexes[Case % PATTERNS], Texts[(Case / PATTERNS) % TITLES]);
+    });
+
+    KwmBenchRun("regex: std::regex", 100000, [&]()
+    {
+        int Case = Next++;
+        return std::regex_search(Texts[(Case / PATTERNS) % TITLES], StdRegexes[Case % PATTERNS]);
+    });
+
+    KwmBenchRun("regex: compile", 10000, [&]()
+    {
+        kwm_regex Regex;
+        std::string Error;
+        return KwmCompileRegex(Patterns[Next++ % PATTERNS], &Regex, Error);
+    });
+
+    return 0;
+}
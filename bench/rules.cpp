@@ -0,0 +1,98 @@
+#include "../kwm/types.h"
+#include "../kwm/rules.h"
+#include "bench.h"
+
+/* Rule sets of 10, 100 and 1000 rules are matched against the same 64 windows by
+ * the rule index and by testing every rule in turn with MatchWindowRule, the way
+ * CheckWindowRules did before the index. Most rules float one application by its
+ * owner, the rest match a substring of the title, some of them with an except.
+ * CheckWindowRules is then timed with the 1000 rules for windows it has seen
+ * before, which the memo answers, and for windows with a new title each time,
+ * which always miss it. */
+
+extern kwm_tiling KWMTiling;
+
+void AddRules(int Count)
+{
+    KwmClearRules();
+    for(int Index = 0; Index < Count; ++Index)
+    {
+        std::string Number = std::to_string(Index);
+        switch(Index % 10)
+        {
+            case 7: KwmAddRule("name=\"Panel " + Number + "\" properties={float=\"true\"}"); break;
+            case 8: KwmAddRule("name=\"Inspector " + Number + "\" properties={float=\"true\"}"); break;
+            case 9: KwmAddRule("name=\"Preferences " + Number + "\" except=\"Document\" properties={display=\"1\"}"); break;
+            default: KwmAddRule("owner=\"App" + Number + "\" properties={float=\"true\"}"); break;
+        }
+    }
+}
+
+int main()
+{
+    std::vector<window_info> Windows;
+    const char *Owners[] = { "Terminal", "App3", "Safari", "App42", "Mail", "App901" };
+    const char *Titles[] = { " Document ", " Panel 17 ", " Preferences 9 ", " Inspector 208 " };
+    for(int Index = 0; Index < 64; ++Index)
+    {
+        window_info Window = {};
+        Window.Owner = Owners[Index % 6];
+        Window.Name = Window.Owner + Titles[Index % 4] + std::to_string(Index);
+        Window.WID = Index + 1;
+        Windows.push_back(Window);
+    }
+
+    int Sizes[] = { 10, 100, 1000 };
+    for(int Size = 0; Size < 3; ++Size)
+    {
+        AddRules(Sizes[Size]);
+        if(KWMTiling.WindowRules.size() != (std::size_t) Sizes[Size])
+        {
+            printf("rules: only %zu of %d rules were parsed\n", KWMTiling.WindowRules.size(), Sizes[Size]);
+            return 1;
+        }
+
+        int Next = 0;
+        std::string Name = "rules: " + std::to_string(Sizes[Size]) + " rules, ";
+        KwmBenchRun((Name + "index").c_str(), 200000, [&]()
+        {
+            return KwmFindMatchingRules(&Windows[Next++ % 64]).size();
+        });
+
+        KwmBenchRun((Name + "every rule").c_str(), 200000 / Sizes[Size] * 10, [&]()
+        {
+            window_info *Window = &Windows[Next++ % 64];
+            int Matches = 0;
+            for(std::size_t Index = 0; Index < KWMTiling.WindowRules.size(); ++Index)
+                Matches += MatchWindowRule(&KWMTiling.WindowRules[Index], Window);
+
+            return Matches;
+        });
+    }
+
+    std::vector<window_info> Titled;
+    for(int Index = 0; Index < 4096; ++Index)
+    {
+        window_info Window = Windows[Index % 64];
+        Window.Name += " - " + std::to_string(Index);
+        Titled.push_back(Window);
+    }
+
+    int Next = 0;
+    KwmBenchRun("rules: memo hit", 1000000, [&]()
+    {
+        window_info *Window = &Windows[Next++ % 64];
+        CheckWindowRules(Window);
+        return Window->Float;
+    });
+
+    KwmBenchRun("rules: memo miss", 4096, [&]()
+    {
+        window_info *Window = &Titled[Next++ % Titled.size()];
+        CheckWindowRules(Window);
+        return Window->Float;
+    });
+
+    printf("rules: %s\n", KwmGetRuleCacheStats().c_str());
+    return 0;
+}
@@ -0,0 +1,105 @@
+#ifndef BENCH_STUB_CARBON_H
+#define BENCH_STUB_CARBON_H
+
+/* Just enough of CoreFoundation, CoreGraphics, Accessibility and the text input
+ * APIs for kwm's headers, and for the framework-independent parts of keys.cpp, to
+ * compile on a system without the macOS frameworks. platform.cpp defines the
+ * functions that keys.cpp calls; they report that no keyboard layout is present. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef unsigned char Boolean;
+typedef uint32_t UInt32;
+typedef int32_t OSStatus;
+typedef long CFIndex;
+typedef uint16_t UniChar;
+typedef unsigned long UniCharCount;
+
+typedef const void *CFTypeRef;
+typedef const struct __CFString *CFStringRef;
+typedef const struct __CFArray *CFArrayRef;
+typedef const struct __CFDictionary *CFDictionaryRef;
+typedef const struct __CFUUID *CFUUIDRef;
+typedef const struct __CFData *CFDataRef;
+typedef const struct __CFAllocator *CFAllocatorRef;
+typedef struct __CFNotificationCenter *CFNotificationCenterRef;
+typedef void (*CFNotificationCallback)(CFNotificationCenterRef Center, void *Observer, CFStringRef Name,
+                                       const void *Object, CFDictionaryRef UserInfo);
+typedef struct __CFMachPort *CFMachPortRef;
+typedef struct __CFRunLoopSource *CFRunLoopSourceRef;
+
+struct CGPoint { double x, y; };
+struct CGSize { double width, height; };
+struct CGRect { CGPoint origin; CGSize size; };
+
+typedef uint16_t CGKeyCode;
+typedef uint32_t CGDirectDisplayID;
+typedef uint32_t CGDisplayChangeSummaryFlags;
+typedef uint64_t CGEventMask;
+typedef uint64_t CGEventFlags;
+typedef uint32_t CGEventType;
+typedef uint64_t CGSpaceID;
+typedef struct __CGEvent *CGEventRef;
+typedef struct __CGEventTapProxy *CGEventTapProxy;
+
+typedef int AXError;
+typedef const struct __AXUIElement *AXUIElementRef;
+typedef struct __AXObserver *AXObserverRef;
+
+struct ProcessSerialNumber { UInt32 highLongOfPSN, lowLongOfPSN; };
+
+typedef struct __TISInputSource *TISInputSourceRef;
+typedef struct UCKeyboardLayout UCKeyboardLayout;
+
+struct CFRange { CFIndex location, length; };
+
+enum { kCFStringEncodingMacRoman = 0, kCFStringEncodingUTF8 = 0x08000100 };
+enum { CFNotificationSuspensionBehaviorDeliverImmediately = 4 };
+enum { kCGHIDEventTap = 0 };
+enum { kCGKeyboardEventKeycode = 9 };
+enum { kCGEventFlagMaskShift = 1 << 17, kCGEventFlagMaskControl = 1 << 18,
+       kCGEventFlagMaskAlternate = 1 << 19, kCGEventFlagMaskCommand = 1 << 20 };
+enum { noErr = 0 };
+enum { kUCKeyActionDown = 0 };
+enum { kVK_Return = 0x24, kVK_Tab = 0x30, kVK_Space = 0x31, kVK_Delete = 0x33, kVK_Escape = 0x35,
+       kVK_F17 = 0x40, kVK_F18 = 0x4F, kVK_F19 = 0x50, kVK_F20 = 0x5A, kVK_F5 = 0x60, kVK_F6 = 0x61,
+       kVK_F7 = 0x62, kVK_F3 = 0x63, kVK_F8 = 0x64, kVK_F9 = 0x65, kVK_F11 = 0x67, kVK_F13 = 0x69,
+       kVK_F16 = 0x6A, kVK_F14 = 0x6B, kVK_F10 = 0x6D, kVK_F12 = 0x6F, kVK_F15 = 0x71,
+       kVK_ForwardDelete = 0x75, kVK_F4 = 0x76, kVK_F2 = 0x78, kVK_F1 = 0x7A, kVK_LeftArrow = 0x7B,
+       kVK_RightArrow = 0x7C, kVK_DownArrow = 0x7D, kVK_UpArrow = 0x7E };
+
+extern CFStringRef kTISPropertyInputSourceID;
+extern CFStringRef kTISPropertyUnicodeKeyLayoutData;
+extern CFStringRef kTISNotifySelectedKeyboardInputSourceChanged;
+
+void CFRelease(CFTypeRef Object);
+CFIndex CFStringGetLength(CFStringRef String);
+const char *CFStringGetCStringPtr(CFStringRef String, UInt32 Encoding);
+Boolean CFStringGetCString(CFStringRef String, char *Buffer, CFIndex Size, UInt32 Encoding);
+CGEventRef CGEventCreate(void *Source);
+CGPoint CGEventGetLocation(CGEventRef Event);
+
+CFRange CFRangeMake(CFIndex Location, CFIndex Length);
+const uint8_t *CFDataGetBytePtr(CFDataRef Data);
+CFStringRef CFStringCreateWithCString(CFAllocatorRef Allocator, const char *String, UInt32 Encoding);
+void CFStringGetCharacters(CFStringRef String, CFRange Range, UniChar *Buffer);
+CFNotificationCenterRef CFNotificationCenterGetDistributedCenter(void);
+void CFNotificationCenterAddObserver(CFNotificationCenterRef Center, const void *Observer, CFNotificationCallback Callback,
+                                     CFStringRef Name, const void *Object, long Behavior);
+
+CGEventRef CGEventCreateKeyboardEvent(void *Source, CGKeyCode Keycode, bool Down);
+CGEventFlags CGEventGetFlags(CGEventRef Event);
+void CGEventSetFlags(CGEventRef Event, CGEventFlags Flags);
+int64_t CGEventGetIntegerValueField(CGEventRef Event, int Field);
+void CGEventKeyboardSetUnicodeString(CGEventRef Event, UniCharCount Length, const UniChar *String);
+void CGEventPost(int Tap, CGEventRef Event);
+
+TISInputSourceRef TISCopyCurrentASCIICapableKeyboardLayoutInputSource(void);
+void *TISGetInputSourceProperty(TISInputSourceRef Source, CFStringRef Key);
+UInt32 LMGetKbdType(void);
+OSStatus UCKeyTranslate(const UCKeyboardLayout *Layout, uint16_t Keycode, uint16_t Action, UInt32 Modifiers,
+                        UInt32 KeyboardType, UInt32 Options, UInt32 *DeadKeyState, UniCharCount MaxLength,
+                        UniCharCount *Length, UniChar *String);
+
+#endif
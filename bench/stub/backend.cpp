@@ -0,0 +1,276 @@
+#include "../../kwm/types.h"
+#include "../../kwm/daemon.h"
+#include "../../kwm/cache.h"
+#include "../../kwm/json.h"
+#include "../../kwm/display.h"
+#include "../../kwm/space.h"
+#include "../../kwm/window.h"
+#include "../../kwm/container.h"
+#include "../../kwm/node.h"
+#include "../../kwm/tree.h"
+#include "../../kwm/keys.h"
+#include "../../kwm/border.h"
+#include "../../kwm/serializer.h"
+#include "../../kwm/application.h"
+#include "../../kwm/rules.h"
+#include "../../kwm/config.h"
+#include "../../kwm/state.h"
+#include "../../kwm/kwm.h"
+
+/* The window backend of kwm-stub. There is one display with one space holding a
+ * row of fake windows, ordered west to east. Focus and swap commands move through
+ * that row and report their changes the way the real backend does, by emitting
+ * events and updating the state page. Bindings and window rules are kwm's own;
+ * everything that would talk to the window server, the trees or the config does
+ * nothing. */
+
+kwm_path KWMPath = {};
+kwm_screen KWMScreen = {};
+kwm_toggles KWMToggles = {};
+kwm_focus KWMFocus = {};
+kwm_mode KWMMode = {};
+kwm_tiling KWMTiling = {};
+kwm_thread KWMThread = {};
+kwm_hotkeys KWMHotkeys = {};
+kwm_border FocusedBorder = {};
+kwm_border MarkedBorder = {};
+kwm_border PrefixBorder = {};
+
+void KwmInitStubBackend(int Windows)
+{
+    const char *Owners[] = { "Terminal", "Safari", "Mail", "Xcode" };
+    for(int Index = 0; Index < Windows; ++Index)
+    {
+        window_info Window = {};
+        Window.Owner = Owners[Index % 4];
+        Window.Name = Window.Owner + " " + std::to_string(Index);
+        Window.PID = 100 + Index % 4;
+        Window.WID = Index + 1;
+        Window.X = Index * 400;
+        Window.Width = 400;
+        Window.Height = 800;
+        KWMTiling.WindowLst.push_back(Window);
+    }
+
+    screen_info Screen = {};
+    Screen.Width = Windows * 400;
+    Screen.Height = 800;
+    Screen.ActiveSpace = 1;
+    KWMTiling.DisplayMap[0] = Screen;
+    KWMScreen.Current = &KWMTiling.DisplayMap[0];
+    KWMScreen.SplitRatio = 0.5;
+    KWMScreen.MarkedWindow = -1;
+
+    KWMToggles.EnableTilingMode = true;
+    KWMMode.Space = SpaceModeBSP;
+    KWMFocus.Window = KWMTiling.WindowLst.empty() ? NULL : &KWMTiling.WindowLst[0];
+}
+
+int GetFocusedWindowIndex()
+{
+    return KWMFocus.Window ? KWMFocus.Window - &KWMTiling.WindowLst[0] : -1;
+}
+
+void SetStubFocus(int Index)
+{
+    int Count = KWMTiling.WindowLst.size();
+    if(Count == 0)
+        return;
+
+    Index = (Index % Count + Count) % Count;
+    KWMFocus.Window = &KWMTiling.WindowLst[Index];
+    KwmEmitEvent(EventTypeFocus);
+}
+
+int GetStubNeighbour(int Degrees, bool Wrap)
+{
+    int Count = KWMTiling.WindowLst.size();
+    int Index = GetFocusedWindowIndex();
+    if(Index == -1 || (Degrees != 90 && Degrees != 270))
+        return -1;
+
+    Index += Degrees == 90 ? 1 : -1;
+    if(Index < 0 || Index >= Count)
+        return Wrap ? (Index + Count) % Count : -1;
+
+    return Index;
+}
+
+void SwapStubWindows(int Index)
+{
+    int Focused = GetFocusedWindowIndex();
+    if(Focused == -1 || Index == -1 || Index == Focused)
+        return;
+
+    std::swap(KWMTiling.WindowLst[Focused], KWMTiling.WindowLst[Index]);
+    std::swap(KWMTiling.WindowLst[Focused].X, KWMTiling.WindowLst[Index].X);
+    KwmMarkEventPending(EventTypeTree);
+    SetStubFocus(Index);
+}
+
+void ShiftWindowFocus(int Shift) { SetStubFocus(GetFocusedWindowIndex() + Shift); }
+void ShiftSubTreeWindowFocus(int Shift) { ShiftWindowFocus(Shift); }
+void ShiftWindowFocusDirected(int Degrees)
+{
+    int Index = GetStubNeighbour(Degrees, false);
+    if(Index != -1)
+        SetStubFocus(Index);
+}
+
+void FocusWindowByID(int WindowID)
+{
+    for(std::size_t Index = 0; Index < KWMTiling.WindowLst.size(); ++Index)
+        if(KWMTiling.WindowLst[Index].WID == WindowID)
+            SetStubFocus(Index);
+}
+
+bool FindClosestWindow(int Degrees, window_info **Target, bool Wrap)
+{
+    int Index = GetStubNeighbour(Degrees, Wrap);
+    if(Index == -1)
+        return false;
+
+    *Target = &KWMTiling.WindowLst[Index];
+    return true;
+}
+
+void SwapFocusedWindowDirected(int Degrees) { SwapStubWindows(GetStubNeighbour(Degrees, false)); }
+void SwapFocusedWindowWithNearest(int Shift)
+{
+    int Count = KWMTiling.WindowLst.size();
+    SwapStubWindows(((GetFocusedWindowIndex() + Shift) % Count + Count) % Count);
+}
+
+void SwapFocusedWindowWithMarked()
+{
+    for(std::size_t Index = 0; Index < KWMTiling.WindowLst.size(); ++Index)
+        if(KWMTiling.WindowLst[Index].WID == KWMScreen.MarkedWindow)
+            SwapStubWindows(Index);
+}
+
+void MarkFocusedWindowContainer()
+{
+    KWMScreen.MarkedWindow = KWMFocus.Window ? KWMFocus.Window->WID : -1;
+    KwmUpdateStatePage();
+}
+
+void MarkWindowContainer(window_info *Window)
+{
+    KWMScreen.MarkedWindow = Window ? Window->WID : -1;
+    KwmUpdateStatePage();
+}
+
+std::vector<window_info> FilterWindowListAllDisplays() { return KWMTiling.WindowLst; }
+bool IsWindowFloating(int WindowID, int *Index) { return false; }
+int GetSpaceNumberFromCGSpaceID(screen_info *Screen, int CGSpaceID) { return CGSpaceID; }
+void GetTagForCurrentSpace(char *Tag, std::size_t Size) { snprintf(Tag, Size, "[bsp]"); }
+void GetTagForCurrentSpace(std::string &Tag) { Tag = "[bsp]"; }
+const char *GetSpaceModeName(space_tiling_option Mode) { return Mode == SpaceModeBSP ? "bsp" : Mode == SpaceModeMonocle ? "monocle" : "float"; }
+
+bool DoesSpaceExistInMapOfScreen(screen_info *Screen) { return false; }
+bool IsSpaceInitializedForScreen(screen_info *Screen) { return false; }
+space_info *GetActiveSpaceOfScreen(screen_info *Screen) { return NULL; }
+space_settings *GetSpaceSettingsForDesktopID(int ScreenID, int DesktopID) { return NULL; }
+space_settings *GetSpaceSettingsForDisplay(unsigned int ScreenID) { return NULL; }
+tree_node *GetTreeNodeFromWindowID(tree_node *Node, int WindowID) { return NULL; }
+bool IsLeftChild(tree_node *Node) { return false; }
+int GetIndexOfNextScreen() { return 0; }
+int GetIndexOfPrevScreen() { return 0; }
+screen_info *GetDisplayFromScreenID(unsigned int ID) { return ID == 0 ? KWMScreen.Current : NULL; }
+screen_info *GetDisplayOfWindow(window_info *Window) { return Window ? KWMScreen.Current : NULL; }
+int GetNumberOfSpacesOfDisplay(screen_info *Screen) { return 1; }
+int GetCGSpaceIDFromSpaceNumber(screen_info *Screen, int SpaceID) { return SpaceID; }
+bool IsWindowOnSpace(int WindowID, int CGSpaceID) { return CGSpaceID == 1; }
+void AddWindowToSpace(int CGSpaceID, int WindowID) {}
+void RemoveWindowFromSpace(int CGSpaceID, int WindowID) {}
+
+void SerializeFocusToJson(json_writer *Writer)
+{
+    JsonBeginObject(Writer, "focus");
+    if(KWMFocus.Window)
+    {
+        JsonWriteInt(Writer, "id", KWMFocus.Window->WID);
+        JsonWriteString(Writer, "owner", KWMFocus.Window->Owner);
+        JsonWriteString(Writer, "name", KWMFocus.Window->Name);
+    }
+    else
+    {
+        JsonWriteNull(Writer, "id");
+    }
+    JsonWriteInt(Writer, "marked", KWMScreen.MarkedWindow);
+    JsonEndObject(Writer);
+}
+
+void SerializeSettingsToJson(json_writer *Writer)
+{
+    JsonBeginObject(Writer, "settings");
+    JsonWriteString(Writer, "space-mode", GetSpaceModeName(KWMMode.Space));
+    JsonWriteDouble(Writer, "split-ratio", KWMScreen.SplitRatio);
+    JsonEndObject(Writer);
+}
+
+void SerializeDisplaysToJson(json_writer *Writer)
+{
+    JsonBeginArray(Writer, "displays");
+    JsonEndArray(Writer);
+}
+
+void SerializeWindowsToJson(json_writer *Writer)
+{
+    JsonBeginArray(Writer, "windows");
+    for(std::size_t Index = 0; Index < KWMTiling.WindowLst.size(); ++Index)
+    {
+        window_info *Window = &KWMTiling.WindowLst[Index];
+        JsonBeginObject(Writer, NULL);
+        JsonWriteInt(Writer, "id", Window->WID);
+        JsonWriteString(Writer, "owner", Window->Owner);
+        JsonWriteString(Writer, "name", Window->Name);
+        JsonWriteInt(Writer, "x", Window->X);
+        JsonEndObject(Writer);
+    }
+    JsonEndArray(Writer);
+}
+
+void KwmQuit() { exit(0); }
+void KwmReloadConfig(std::string &Report) { Report.clear(); }
+void KwmBypassConfigCache() {}
+std::string KwmGetConfigCacheStats() { return "kwm-stub does not load a config"; }
+void KwmExecuteThreadedSystemCommand(std::string Command) {}
+
+void ActivateSpaceWithoutTransition(std::string SpaceID) {}
+void MoveFocusedWindowToSpace(std::string SpaceID) {}
+void GoToPreviousSpace(bool MoveFocusedWindow) {}
+void TileFocusedSpace(space_tiling_option Mode) {}
+void FloatFocusedSpace() {}
+void GiveFocusToScreen(unsigned int ScreenIndex, tree_node *Focus, bool Mouse, bool UpdateFocus) {}
+void MoveWindowToDisplay(window_info *Window, int Shift, bool Relative) {}
+void ChangeGapOfDisplay(const std::string &Side, int Offset) {}
+void ChangePaddingOfDisplay(const std::string &Side, int Offset) {}
+void SetDefaultGapOfDisplay(container_offset Offset) {}
+void SetDefaultPaddingOfDisplay(container_offset Offset) {}
+void AllowRoleForApplication(std::string Application, std::string Role) {}
+
+void FocusWindowBelowCursor() {}
+void MoveFloatingWindow(int X, int Y) {}
+void DetachAndReinsertWindow(int WindowID, int Degrees) {}
+void ToggleFocusedWindowFloating() {}
+void ToggleFocusedWindowFullscreen() {}
+void ToggleFocusedWindowParentContainer() {}
+void ResizeWindowToContainerSize() {}
+void UpdateBorder(border_type BorderType) {}
+
+void ChangeSplitRatio(double Value) { KWMScreen.SplitRatio = Value; }
+void ModifyContainerSplitRatio(double Offset) {}
+void ModifyContainerSplitRatio(double Offset, int Degrees) {}
+void ChangeTypeOfFocusedNode(node_type Type) {}
+void ToggleTypeOfFocusedNode() {}
+void ToggleNodeSplitMode(screen_info *Screen, tree_node *Node) {}
+void CreatePseudoNode() {}
+void RemovePseudoNode() {}
+void RemoveWindowFromBSPTree(screen_info *Screen, int WindowID, bool Center, bool UpdateFocus) {}
+void RemoveWindowFromMonocleTree(screen_info *Screen, int WindowID, bool Center, bool UpdateFocus) {}
+void ApplyTreeNodeContainer(tree_node *Node) {}
+void CreateNodeContainers(screen_info *Screen, tree_node *Node, bool OptimalSplit) {}
+void RotateTree(tree_node *Node, int Deg) {}
+void SaveBSPTreeToFile(screen_info *Screen, std::string Name) {}
+void LoadBSPTreeFromFile(screen_info *Screen, std::string Name) {}
@@ -0,0 +1,72 @@
+#include "../../kwm/types.h"
+#include "../../kwm/daemon.h"
+#include "../../kwm/interpreter.h"
+#include "../../kwm/cache.h"
+#include "../../kwm/keys.h"
+
+/* kwm-stub runs kwm's daemon, interpreter, command table and caches on top of the
+ * fake window backend in backend.cpp, so that 'kwmc bench' can measure the IPC
+ * and interpreter path on any system:
+ *
+ *     kwm-stub [-p port] [-w windows] [-m monitor-interval-ms]
+ *
+ * A monitor thread takes KWMThread.Lock periodically and bumps the state
+ * generation, like the window monitor of the real daemon, so that queries see
+ * the same lock contention and cache invalidation. */
+
+extern int KwmDaemonPort;
+extern kwm_thread KWMThread;
+extern kwm_hotkeys KWMHotkeys;
+
+void KwmInitStubBackend(int Windows);
+
+int KwmStubMonitorInterval = 200;
+
+void *KwmStubWindowMonitor(void *)
+{
+    while(KwmStubMonitorInterval > 0)
+    {
+        usleep(KwmStubMonitorInterval * 1000);
+
+        pthread_mutex_lock(&KWMThread.Lock);
+        usleep(500);
+        KwmBumpGeneration();
+        pthread_mutex_unlock(&KWMThread.Lock);
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int Windows = 8;
+    for(int Index = 1; Index + 1 < argc; Index += 2)
+    {
+        std::string Arg = argv[Index];
+        if(Arg == "-p")
+            KwmDaemonPort = atoi(argv[Index + 1]);
+        else if(Arg == "-w")
+            Windows = atoi(argv[Index + 1]);
+        else if(Arg == "-m")
+            KwmStubMonitorInterval = atoi(argv[Index + 1]);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    pthread_mutex_init(&KWMThread.Lock, NULL);
+    KwmInitStubBackend(Windows);
+    KwmInitInterpreter();
+    KwmInitKeyQueue(&KWMHotkeys.Queue);
+    KWMHotkeys.Prefix.Timeout = 0.75;
+    KWMHotkeys.SequenceTimeout = 1.0;
+    KwmRebuildHotkeyTable();
+    if(!KwmStartDaemon())
+    {
+        std::cout << "kwm-stub: could not listen on port " << KwmDaemonPort << std::endl;
+        return 1;
+    }
+
+    pthread_create(&KWMThread.WindowMonitor, NULL, &KwmStubWindowMonitor, NULL);
+    std::cout << "kwm-stub: listening on port " << KwmDaemonPort << std::endl;
+    KwmDaemonHandleConnectionBG(NULL);
+    return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef BENCH_STUB_LIBPROC_H
+#define BENCH_STUB_LIBPROC_H
+
+#define PROC_PIDPATHINFO_MAXSIZE 4096
+
+#endif
@@ -0,0 +1,41 @@
+#include <Carbon/Carbon.h>
+
+/* The system calls of keys.cpp, for kwm-stub and the benchmarks. There is no
+ * keyboard layout, so KeycodeForChar only knows the keycodes seeded through
+ * KwmSetCachedKeycode, and synthesized key events go nowhere. */
+
+CFStringRef kTISPropertyInputSourceID = NULL;
+CFStringRef kTISPropertyUnicodeKeyLayoutData = NULL;
+CFStringRef kTISNotifySelectedKeyboardInputSourceChanged = NULL;
+
+void CFRelease(CFTypeRef Object) {}
+CFIndex CFStringGetLength(CFStringRef String) { return 0; }
+const char *CFStringGetCStringPtr(CFStringRef String, UInt32 Encoding) { return NULL; }
+Boolean CFStringGetCString(CFStringRef String, char *Buffer, CFIndex Size, UInt32 Encoding) { return false; }
+CFStringRef CFStringCreateWithCString(CFAllocatorRef Allocator, const char *String, UInt32 Encoding) { return NULL; }
+void CFStringGetCharacters(CFStringRef String, CFRange Range, UniChar *Buffer) {}
+CFRange CFRangeMake(CFIndex Location, CFIndex Length) { CFRange Range = { Location, Length }; return Range; }
+const uint8_t *CFDataGetBytePtr(CFDataRef Data) { return NULL; }
+CFNotificationCenterRef CFNotificationCenterGetDistributedCenter(void) { return NULL; }
+void CFNotificationCenterAddObserver(CFNotificationCenterRef Center, const void *Observer, CFNotificationCallback Callback,
+                                     CFStringRef Name, const void *Object, long Behavior) {}
+
+CGEventRef CGEventCreate(void *Source) { return NULL; }
+CGPoint CGEventGetLocation(CGEventRef Event) { CGPoint Point = { 0, 0 }; return Point; }
+CGEventRef CGEventCreateKeyboardEvent(void *Source, CGKeyCode Keycode, bool Down) { return NULL; }
+CGEventFlags CGEventGetFlags(CGEventRef Event) { return 0; }
+void CGEventSetFlags(CGEventRef Event, CGEventFlags Flags) {}
+int64_t CGEventGetIntegerValueField(CGEventRef Event, int Field) { return 0; }
+void CGEventKeyboardSetUnicodeString(CGEventRef Event, UniCharCount Length, const UniChar *String) {}
+void CGEventPost(int Tap, CGEventRef Event) {}
+
+TISInputSourceRef TISCopyCurrentASCIICapableKeyboardLayoutInputSource(void) { return NULL; }
+void *TISGetInputSourceProperty(TISInputSourceRef Source, CFStringRef Key) { return NULL; }
+UInt32 LMGetKbdType(void) { return 0; }
+OSStatus UCKeyTranslate(const UCKeyboardLayout *Layout, uint16_t Keycode, uint16_t Action, UInt32 Modifiers,
+                        UInt32 KeyboardType, UInt32 Options, UInt32 *DeadKeyState, UniCharCount MaxLength,
+                        UniCharCount *Length, UniChar *String)
+{
+    *Length = 0;
+    return -1;
+}
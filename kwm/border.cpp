@@ -1,14 +1,13 @@
 #include "border.h"
 #include "window.h"
+#include "daemon.h"
 
-void UpdateBorder(std::string BorderType)
+void UpdateBorder(border_type BorderType)
 {
-    Assert(BorderType == "focused" || BorderType == "marked");
-
     kwm_border *Border = &FocusedBorder;
     int WindowID = KWMFocus.Window ? KWMFocus.Window->WID : -1;
 
-    if(BorderType == "focused" &&
+    if(BorderType == BorderTypeFocused &&
        FocusedBorder.Enabled &&
        PrefixBorder.Enabled &&
        KWMHotkeys.Prefix.Active)
@@ -16,7 +15,7 @@ void UpdateBorder(std::string BorderType)
         Border = &PrefixBorder;
         Border->Handle = FocusedBorder.Handle;
     }
-    else if(BorderType == "marked")
+    else if(BorderType == BorderTypeMarked)
     {
         WindowID = KWMScreen.MarkedWindow;
         Border = &MarkedBorder;
@@ -30,4 +29,6 @@ void UpdateBorder(std::string BorderType)
         ClearBorder(Border);
     else if(Border->Enabled)
         RefreshBorder(Border, WindowID);
+
+    KwmFlushPendingEvents();
 }
@@ -57,27 +57,34 @@ RefreshBorder(kwm_border *Border, int WindowID)
     {
         CGPoint WindowPos = GetWindowPos(WindowRef);
         CGSize WindowSize = GetWindowSize(WindowRef);
-        std::string Command = "x:" + std::to_string(WindowPos.x) + \
-                              " y:" + std::to_string(WindowPos.y) + \
-                              " w:" + std::to_string(WindowSize.width) + \
-                              " h:" + std::to_string(WindowSize.height) + \
-                              " " + Border->Color.Format + \
-                              " s:" + std::to_string(Border->Width);
-
-        Command += (Border->Radius != -1 ? " rad:" + std::to_string(Border->Radius) : "") + "\n";
         if(WindowPos.x == KWMScreen.Current->X &&
            WindowPos.y == KWMScreen.Current->Y &&
            WindowSize.width == KWMScreen.Current->Width &&
            WindowSize.height == KWMScreen.Current->Height)
-            Command = "clear\n";
+        {
+            ClearBorder(Border);
+            return;
+        }
 
-        fwrite(Command.c_str(), Command.size(), 1, Border->Handle);
-        fflush(Border->Handle);
+        char Command[512];
+        int Length = snprintf(Command, sizeof(Command), "x:%f y:%f w:%f h:%f %s s:%d",
+                              WindowPos.x, WindowPos.y, WindowSize.width, WindowSize.height,
+                              Border->Color.Format.c_str(), Border->Width);
+
+        if(Border->Radius != -1 && Length > 0 && Length < (int) sizeof(Command))
+            Length += snprintf(Command + Length, sizeof(Command) - Length, " rad:%f", Border->Radius);
+
+        if(Length > 0 && Length < (int) sizeof(Command) - 1)
+        {
+            Command[Length++] = '\n';
+            fwrite(Command, Length, 1, Border->Handle);
+            fflush(Border->Handle);
+        }
     }
     else
         ClearBorder(Border);
 }
 
-void UpdateBorder(std::string BorderType);
+void UpdateBorder(border_type BorderType);
 
 #endif
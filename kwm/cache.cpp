@@ -0,0 +1,267 @@
+#include "cache.h"
+#include "command.h"
+
+extern kwm_thread KWMThread;
+
+/* Every change to focus, trees, spaces, settings or the window list bumps the
+ * generation counter, and all of them are made with KWMThread.Lock held. Query
+ * responses are published as an immutable snapshot that belongs to a single
+ * generation: every response in it was rendered from the same state, and queries
+ * read it without taking KWMThread.Lock. A snapshot is only replaced, never
+ * modified, so a reader keeps a consistent view for as long as it holds on to it.
+ *
+ * A query that is not in the snapshot, or arrives after the generation moved on,
+ * queues itself and waits for a new snapshot. One thread at a time builds it: it
+ * takes every queued query, renders them all under one acquisition of
+ * KWMThread.Lock and publishes the result, carrying over the responses of the old
+ * snapshot if the generation did not change. However many clients are polling,
+ * queries therefore take KWMThread.Lock at most once per generation for every
+ * distinct query, and never on a hit. A query is answered from a snapshot whose
+ * generation is at least the one it arrived at, so it always sees a mutation that
+ * finished before it was received. */
+
+#define KWM_QUERY_CACHE_MAX_ENTRIES 64
+
+unsigned int KwmGeneration = 0;
+std::shared_ptr<const query_snapshot> KwmQuerySnapshot;
+pthread_mutex_t KwmQuerySnapshotLock = PTHREAD_MUTEX_INITIALIZER;
+
+std::vector<query_request> KwmPendingQueries;
+bool KwmQuerySnapshotBuilding = false;
+pthread_mutex_t KwmQueryBuildLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t KwmQuerySnapshotPublished = PTHREAD_COND_INITIALIZER;
+
+unsigned int KwmQueryCacheHits = 0;
+unsigned int KwmQueryCacheMisses = 0;
+unsigned int KwmQuerySnapshotBuilds = 0;
+
+void KwmBumpGeneration()
+{
+    __sync_add_and_fetch(&KwmGeneration, 1);
+}
+
+unsigned int KwmGetGeneration()
+{
+    return __sync_add_and_fetch(&KwmGeneration, 0);
+}
+
+std::shared_ptr<const query_snapshot> KwmGetQuerySnapshot()
+{
+    pthread_mutex_lock(&KwmQuerySnapshotLock);
+    std::shared_ptr<const query_snapshot> Snapshot = KwmQuerySnapshot;
+    pthread_mutex_unlock(&KwmQuerySnapshotLock);
+    return Snapshot;
+}
+
+void KwmPublishQuerySnapshot(std::shared_ptr<const query_snapshot> Snapshot)
+{
+    pthread_mutex_lock(&KwmQuerySnapshotLock);
+    KwmQuerySnapshot.swap(Snapshot);
+    pthread_mutex_unlock(&KwmQuerySnapshotLock);
+}
+
+/* Generations are compared as a distance so that the counter may wrap. */
+bool KwmFindQueryResponse(const std::string &Query, unsigned int Generation, std::string &Output)
+{
+    std::shared_ptr<const query_snapshot> Snapshot = KwmGetQuerySnapshot();
+    if(!Snapshot || (int) (Snapshot->Generation - Generation) < 0)
+        return false;
+
+    std::map<std::string, std::string>::const_iterator It = Snapshot->Responses.find(Query);
+    if(It == Snapshot->Responses.end())
+        return false;
+
+    Output = It->second;
+    return true;
+}
+
+void KwmBuildQuerySnapshot(std::vector<query_request> &Requests)
+{
+    std::shared_ptr<const query_snapshot> Previous = KwmGetQuerySnapshot();
+    std::shared_ptr<query_snapshot> Snapshot = std::make_shared<query_snapshot>();
+    bool Carry = Previous && Previous->Generation == KwmGetGeneration() &&
+                 Previous->Responses.size() + Requests.size() <= KWM_QUERY_CACHE_MAX_ENTRIES;
+    if(Carry)
+        Snapshot->Responses = Previous->Responses;
+
+    pthread_mutex_lock(&KWMThread.Lock);
+    Snapshot->Generation = KwmGetGeneration();
+    if(Carry && Previous->Generation != Snapshot->Generation)
+        Snapshot->Responses.clear();
+
+    for(std::size_t Index = 0; Index < Requests.size(); ++Index)
+    {
+        query_request *Request = &Requests[Index];
+        std::string &Output = Snapshot->Responses[Request->Query];
+        Output.clear();
+        Request->Command->Query(Request->Args, Request->Command->Data, Output);
+    }
+    pthread_mutex_unlock(&KWMThread.Lock);
+
+    KwmPublishQuerySnapshot(Snapshot);
+    __sync_add_and_fetch(&KwmQuerySnapshotBuilds, 1);
+}
+
+void KwmQueueQuery(const std::string &Query, kwm_command *Command, std::vector<std::string> &Args)
+{
+    for(std::size_t Index = 0; Index < KwmPendingQueries.size(); ++Index)
+    {
+        if(KwmPendingQueries[Index].Query == Query)
+            return;
+    }
+
+    query_request Request = { Query, Command, Args };
+    KwmPendingQueries.push_back(Request);
+}
+
+void KwmGetQueryResponse(kwm_command *Command, std::vector<std::string> &Args, std::string &Output)
+{
+    std::string Query = Command->Path;
+    for(std::size_t ArgIndex = 0; ArgIndex < Args.size(); ++ArgIndex)
+        Query += " " + Args[ArgIndex];
+
+    unsigned int Generation = KwmGetGeneration();
+    if(KwmFindQueryResponse(Query, Generation, Output))
+    {
+        __sync_add_and_fetch(&KwmQueryCacheHits, 1);
+        return;
+    }
+
+    __sync_add_and_fetch(&KwmQueryCacheMisses, 1);
+    pthread_mutex_lock(&KwmQueryBuildLock);
+    while(!KwmFindQueryResponse(Query, Generation, Output))
+    {
+        KwmQueueQuery(Query, Command, Args);
+        if(KwmQuerySnapshotBuilding)
+        {
+            pthread_cond_wait(&KwmQuerySnapshotPublished, &KwmQueryBuildLock);
+            continue;
+        }
+
+        std::vector<query_request> Requests;
+        Requests.swap(KwmPendingQueries);
+        KwmQuerySnapshotBuilding = true;
+        pthread_mutex_unlock(&KwmQueryBuildLock);
+
+        KwmBuildQuerySnapshot(Requests);
+
+        pthread_mutex_lock(&KwmQueryBuildLock);
+        KwmQuerySnapshotBuilding = false;
+        pthread_cond_broadcast(&KwmQuerySnapshotPublished);
+    }
+    pthread_mutex_unlock(&KwmQueryBuildLock);
+}
+
+std::string KwmGetQueryCacheStats()
+{
+    std::shared_ptr<const query_snapshot> Snapshot = KwmGetQuerySnapshot();
+    unsigned int Hits = __sync_add_and_fetch(&KwmQueryCacheHits, 0);
+    unsigned int Misses = __sync_add_and_fetch(&KwmQueryCacheMisses, 0);
+    unsigned int Builds = __sync_add_and_fetch(&KwmQuerySnapshotBuilds, 0);
+
+    unsigned int Total = Hits + Misses;
+    char Buffer[32];
+    snprintf(Buffer, sizeof(Buffer), "%.1f%%", Total ? (100.0 * Hits) / Total : 0.0);
+
+    return "hits: " + std::to_string(Hits) +
+           ", misses: " + std::to_string(Misses) +
+           ", hit-rate: " + Buffer +
+           ", builds: " + std::to_string(Builds) +
+           ", entries: " + std::to_string(Snapshot ? Snapshot->Responses.size() : 0) +
+           ", snapshot: " + std::to_string(Snapshot ? Snapshot->Generation : 0) +
+           ", generation: " + std::to_string(KwmGetGeneration());
+}
+
+/* Clients such as status bars and hotkey daemons send the same few command strings
+ * over and over. The resolved command and its arguments are kept in a small LRU
+ * list keyed by the raw message, so a repeated message skips tokenizing, resolving
+ * and validating. The command table never changes at runtime, so an entry can only
+ * leave the cache by being the least recently used one. */
+
+#define KWM_COMMAND_CACHE_DEFAULT_SIZE 64
+
+std::list<parsed_command> KwmCommandCache;
+std::map<std::string, std::list<parsed_command>::iterator> KwmCommandCacheIndex;
+pthread_mutex_t KwmCommandCacheLock = PTHREAD_MUTEX_INITIALIZER;
+std::size_t KwmCommandCacheSize = KWM_COMMAND_CACHE_DEFAULT_SIZE;
+unsigned int KwmCommandCacheHits = 0;
+unsigned int KwmCommandCacheMisses = 0;
+unsigned int KwmCommandCacheEvictions = 0;
+
+bool KwmGetCachedCommand(const std::string &Message, kwm_command **Command, std::vector<std::string> &Args)
+{
+    bool Result = false;
+
+    pthread_mutex_lock(&KwmCommandCacheLock);
+    std::map<std::string, std::list<parsed_command>::iterator>::iterator It = KwmCommandCacheIndex.find(Message);
+    if(It != KwmCommandCacheIndex.end())
+    {
+        KwmCommandCache.splice(KwmCommandCache.begin(), KwmCommandCache, It->second);
+        *Command = It->second->Command;
+        Args = It->second->Args;
+        Result = true;
+        ++KwmCommandCacheHits;
+    }
+    else
+    {
+        ++KwmCommandCacheMisses;
+    }
+    pthread_mutex_unlock(&KwmCommandCacheLock);
+
+    return Result;
+}
+
+void KwmEvictCommands(std::size_t Size)
+{
+    while(KwmCommandCache.size() > Size)
+    {
+        KwmCommandCacheIndex.erase(KwmCommandCache.back().Message);
+        KwmCommandCache.pop_back();
+        ++KwmCommandCacheEvictions;
+    }
+}
+
+void KwmCacheCommand(const std::string &Message, kwm_command *Command, std::vector<std::string> &Args)
+{
+    pthread_mutex_lock(&KwmCommandCacheLock);
+    if(KwmCommandCacheSize > 0 &&
+       KwmCommandCacheIndex.find(Message) == KwmCommandCacheIndex.end())
+    {
+        KwmEvictCommands(KwmCommandCacheSize - 1);
+
+        parsed_command Parsed = { Message, Command, Args };
+        KwmCommandCache.push_front(Parsed);
+        KwmCommandCacheIndex[Message] = KwmCommandCache.begin();
+    }
+    pthread_mutex_unlock(&KwmCommandCacheLock);
+}
+
+void KwmSetCommandCacheSize(int Size)
+{
+    pthread_mutex_lock(&KwmCommandCacheLock);
+    KwmCommandCacheSize = Size > 0 ? Size : 0;
+    KwmEvictCommands(KwmCommandCacheSize);
+    pthread_mutex_unlock(&KwmCommandCacheLock);
+}
+
+std::string KwmGetCommandCacheStats()
+{
+    pthread_mutex_lock(&KwmCommandCacheLock);
+    unsigned int Hits = KwmCommandCacheHits;
+    unsigned int Misses = KwmCommandCacheMisses;
+    unsigned int Evictions = KwmCommandCacheEvictions;
+    std::size_t Entries = KwmCommandCache.size();
+    std::size_t Size = KwmCommandCacheSize;
+    pthread_mutex_unlock(&KwmCommandCacheLock);
+
+    unsigned int Total = Hits + Misses;
+    char Buffer[32];
+    snprintf(Buffer, sizeof(Buffer), "%.1f%%", Total ? (100.0 * Hits) / Total : 0.0);
+
+    return "hits: " + std::to_string(Hits) +
+           ", misses: " + std::to_string(Misses) +
+           ", hit-rate: " + Buffer +
+           ", evictions: " + std::to_string(Evictions) +
+           ", entries: " + std::to_string(Entries) +
+           ", size: " + std::to_string(Size);
+}
@@ -0,0 +1,17 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "types.h"
+
+void KwmBumpGeneration();
+unsigned int KwmGetGeneration();
+
+void KwmGetQueryResponse(kwm_command *Command, std::vector<std::string> &Args, std::string &Output);
+std::string KwmGetQueryCacheStats();
+
+bool KwmGetCachedCommand(const std::string &Message, kwm_command **Command, std::vector<std::string> &Args);
+void KwmCacheCommand(const std::string &Message, kwm_command *Command, std::vector<std::string> &Args);
+void KwmSetCommandCacheSize(int Size);
+std::string KwmGetCommandCacheStats();
+
+#endif
@@ -0,0 +1,281 @@
+#include "command.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+unsigned int KwmHashCommandPath(unsigned int Hash, const char *Text, std::size_t Length)
+{
+    for(std::size_t Index = 0; Index < Length; ++Index)
+    {
+        Hash ^= (unsigned char) Text[Index];
+        Hash *= FNV_PRIME;
+    }
+
+    return Hash;
+}
+
+void KwmInitCommandTable(kwm_command_table *Table, kwm_command *Commands, int Count)
+{
+    unsigned int Size = 16;
+    while(Size < (unsigned int) Count * 2)
+        Size <<= 1;
+
+    Table->Commands = Commands;
+    Table->Count = Count;
+    Table->Mask = Size - 1;
+    Table->Slots.assign(Size, -1);
+
+    for(int Index = 0; Index < Count; ++Index)
+    {
+        kwm_command *Command = &Commands[Index];
+        Command->Hash = KwmHashCommandPath(FNV_OFFSET_BASIS, Command->Path, strlen(Command->Path));
+        if(Index > 0 && strcmp(Commands[Index - 1].Path, Command->Path) == 0)
+            continue;
+
+        unsigned int Slot = Command->Hash & Table->Mask;
+        while(Table->Slots[Slot] != -1)
+            Slot = (Slot + 1) & Table->Mask;
+
+        Table->Slots[Slot] = Index;
+    }
+}
+
+unsigned int KwmGetCommandTableSignature(kwm_command_table *Table)
+{
+    unsigned int Hash = FNV_OFFSET_BASIS;
+    for(int Index = 0; Index < Table->Count; ++Index)
+    {
+        kwm_command *Command = &Table->Commands[Index];
+        Hash = KwmHashCommandPath(Hash, Command->Path, strlen(Command->Path) + 1);
+        Hash = KwmHashCommandPath(Hash, Command->Schema, strlen(Command->Schema) + 1);
+    }
+
+    return Hash;
+}
+
+int KwmFindCommand(kwm_command_table *Table, const char *Path, std::size_t Length, unsigned int Hash)
+{
+    unsigned int Slot = Hash & Table->Mask;
+    while(Table->Slots[Slot] != -1)
+    {
+        kwm_command *Command = &Table->Commands[Table->Slots[Slot]];
+        if(Command->Hash == Hash &&
+           strncmp(Command->Path, Path, Length) == 0 &&
+           Command->Path[Length] == '\0')
+            return Table->Slots[Slot];
+
+        Slot = (Slot + 1) & Table->Mask;
+    }
+
+    return -1;
+}
+
+bool KwmMatchCommandArg(const char *Spec, std::size_t Length, const std::string &Arg)
+{
+    const char *Value = Arg.c_str();
+    char *End = NULL;
+
+    if(Length == 5 && strncmp(Spec, "<int>", Length) == 0)
+    {
+        strtol(Value, &End, 10);
+        return !Arg.empty() && *End == '\0';
+    }
+    else if(Length == 7 && strncmp(Spec, "<float>", Length) == 0)
+    {
+        strtod(Value, &End);
+        return !Arg.empty() && *End == '\0';
+    }
+    else if(Length == 5 && strncmp(Spec, "<hex>", Length) == 0)
+    {
+        if(Value[0] == '0' && (Value[1] == 'x' || Value[1] == 'X'))
+            Value += 2;
+
+        std::size_t Digits = strspn(Value, "0123456789abcdefABCDEF");
+        return Digits > 0 && Digits <= 8 && Value[Digits] == '\0';
+    }
+    else if((Length == 6 && strncmp(Spec, "<word>", Length) == 0) ||
+            (Length == 6 && strncmp(Spec, "<text>", Length) == 0))
+    {
+        return !Arg.empty();
+    }
+
+    return Arg.size() == Length && strncmp(Spec, Value, Length) == 0;
+}
+
+bool KwmMatchCommandAlternatives(const char *Spec, std::size_t Length, const std::string &Arg)
+{
+    const char *End = Spec + Length;
+    while(Spec < End)
+    {
+        const char *Split = Spec;
+        while(Split < End && *Split != '|')
+            ++Split;
+
+        if(KwmMatchCommandArg(Spec, Split - Spec, Arg))
+            return true;
+
+        Spec = Split + 1;
+    }
+
+    return false;
+}
+
+bool KwmValidateCommandArgs(const char *Schema, std::vector<std::string> &Args, std::string &Error)
+{
+    std::size_t ArgIndex = 0;
+    const char *Spec = Schema;
+    while(*Spec)
+    {
+        while(*Spec == ' ')
+            ++Spec;
+
+        if(!*Spec)
+            break;
+
+        std::size_t Length = strcspn(Spec, " ");
+        const char *Name = Spec;
+        bool Optional = Spec[0] == '[';
+        const char *Alternatives = Optional ? Spec + 1 : Spec;
+        std::size_t AlternativesLength = Optional ? Length - 2 : Length;
+        bool Text = AlternativesLength == 6 && strncmp(Alternatives, "<text>", 6) == 0;
+        Spec += Length;
+
+        if(ArgIndex >= Args.size())
+        {
+            if(Optional)
+                break;
+
+            Error = "missing argument '" + std::string(Name, Length) + "'";
+            return false;
+        }
+
+        if(!KwmMatchCommandAlternatives(Alternatives, AlternativesLength, Args[ArgIndex]))
+        {
+            Error = "invalid argument '" + Args[ArgIndex] + "', expected '" + std::string(Name, Length) + "'";
+            return false;
+        }
+
+        ArgIndex = Text ? Args.size() : ArgIndex + 1;
+    }
+
+    if(ArgIndex < Args.size())
+    {
+        Error = "unexpected argument '" + Args[ArgIndex] + "'";
+        return false;
+    }
+
+    return true;
+}
+
+void KwmCreateCommandUsage(kwm_command *Command, std::string &Output)
+{
+    Output += Command->Path;
+    if(Command->Schema[0])
+        Output += std::string(" ") + Command->Schema;
+}
+
+/* Tokens are separated by single spaces, so every candidate path is a prefix of
+ * Message itself. The path is hashed and compared in place; the only strings built
+ * are the arguments handed to the handler (and the message if resolving fails). */
+kwm_command *KwmResolveCommand(kwm_command_table *Table, const std::string &Message,
+                               std::vector<std::string> &Args, std::string &Error)
+{
+    const char *Text = Message.c_str();
+    std::size_t Size = Message.size();
+
+    unsigned int Hashes[KWM_COMMAND_MAX_DEPTH];
+    std::size_t Lengths[KWM_COMMAND_MAX_DEPTH];
+    unsigned int Hash = FNV_OFFSET_BASIS;
+
+    int Depth = 0;
+    std::size_t Start = 0;
+    for(; Depth < KWM_COMMAND_MAX_DEPTH && Start < Size; ++Depth)
+    {
+        const char *Split = (const char *) memchr(Text + Start, ' ', Size - Start);
+        std::size_t End = Split ? Split - Text : Size;
+
+        if(Depth > 0)
+            Hash = KwmHashCommandPath(Hash, " ", 1);
+
+        Hash = KwmHashCommandPath(Hash, Text + Start, End - Start);
+        Hashes[Depth] = Hash;
+        Lengths[Depth] = End;
+        Start = End + 1;
+    }
+
+    for(int Index = Depth - 1; Index >= 0; --Index)
+    {
+        int First = KwmFindCommand(Table, Text, Lengths[Index], Hashes[Index]);
+        if(First == -1)
+            continue;
+
+        Args.clear();
+        Start = Lengths[Index] + 1;
+        while(Start < Size)
+        {
+            const char *Split = (const char *) memchr(Text + Start, ' ', Size - Start);
+            std::size_t End = Split ? Split - Text : Size;
+            Args.push_back(std::string(Text + Start, End - Start));
+            Start = End + 1;
+        }
+
+        std::string Usage;
+        int Variant = First;
+        for(; Variant < Table->Count && strcmp(Table->Commands[Variant].Path, Table->Commands[First].Path) == 0; ++Variant)
+        {
+            std::string VariantError;
+            if(KwmValidateCommandArgs(Table->Commands[Variant].Schema, Args, VariantError))
+                return &Table->Commands[Variant];
+
+            if(Variant == First)
+                Error = VariantError;
+
+            Usage += "\nusage: ";
+            KwmCreateCommandUsage(&Table->Commands[Variant], Usage);
+        }
+
+        if(Variant - First > 1)
+            Error = std::string("invalid arguments for '") + Table->Commands[First].Path + "'";
+
+        Error = "error: " + Error + Usage;
+        return NULL;
+    }
+
+    std::string Verb = Message.substr(0, Message.find(' '));
+    std::string Command = Message.substr(0, Depth ? Lengths[Depth - 1] : 0);
+    for(int Index = 0; Index < Table->Count; ++Index)
+    {
+        const char *Candidate = Table->Commands[Index].Path;
+        if(!Verb.empty() && strncmp(Candidate, Verb.c_str(), Verb.size()) == 0 && Candidate[Verb.size()] == ' ')
+        {
+            Error = "error: unknown command '" + Command + "', see 'kwmc help " + Verb + "'";
+            return NULL;
+        }
+    }
+
+    Error = "error: unknown command '" + Command + "', see 'kwmc help'";
+    return NULL;
+}
+
+void KwmCreateCommandHelp(kwm_command_table *Table, std::string Prefix, std::string &Output)
+{
+    for(int Index = 0; Index < Table->Count; ++Index)
+    {
+        kwm_command *Command = &Table->Commands[Index];
+        if(strncmp(Command->Path, Prefix.c_str(), Prefix.size()) == 0 &&
+           (Command->Path[Prefix.size()] == '\0' || Command->Path[Prefix.size()] == ' ' || Prefix.empty()))
+        {
+            if(!Output.empty())
+                Output += "\n";
+
+            KwmCreateCommandUsage(Command, Output);
+            Output += std::string("\n    ") + Command->Help;
+        }
+    }
+
+    if(Output.empty())
+        Output = "error: no command matches '" + Prefix + "'";
+}
@@ -0,0 +1,65 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <string>
+#include <vector>
+
+/* Commands are described by a static table. Path is the verb path ("config spawn"),
+ * Schema describes the arguments that follow it, separated by spaces:
+ *
+ *     left|right      one of the listed alternatives
+ *     <int>           a decimal integer
+ *     <float>         a floating point number
+ *     <hex>           a hexadecimal number, with or without 0x
+ *     <word>          any single token
+ *     <text>          one or more tokens, must be the last argument
+ *     [..]            the argument may be left out
+ *
+ * Alternatives may mix literals and types ("prev|next|<int>"). Several entries
+ * may share a path when their schemas differ; they must be adjacent in the
+ * table and are tried in order.
+ *
+ * Paths are hashed (FNV-1a) into an open addressing table, so resolving a
+ * command costs at most one probe per token of the longest path. */
+
+#define KWM_COMMAND_HANDLER(name) void name(std::vector<std::string> &Args, void *Data, int ClientSockFD)
+typedef KWM_COMMAND_HANDLER(kwm_command_handler);
+
+#define KWM_QUERY_HANDLER(name) void name(std::vector<std::string> &Args, void *Data, std::string &Output)
+typedef KWM_QUERY_HANDLER(kwm_query_handler);
+
+#define KWM_COMMAND_MAX_DEPTH 3
+
+struct kwm_command
+{
+    const char *Path;
+    const char *Schema;
+    const char *Help;
+
+    kwm_command_handler *Handler;
+    kwm_query_handler *Query;
+    void *Data;
+    bool ReadOnly;
+
+    unsigned int Hash;
+};
+
+struct kwm_command_table
+{
+    kwm_command *Commands;
+    int Count;
+
+    unsigned int Mask;
+    std::vector<int> Slots;
+};
+
+unsigned int KwmHashCommandPath(unsigned int Hash, const char *Text, std::size_t Length);
+void KwmInitCommandTable(kwm_command_table *Table, kwm_command *Commands, int Count);
+unsigned int KwmGetCommandTableSignature(kwm_command_table *Table);
+int KwmFindCommand(kwm_command_table *Table, const char *Path, std::size_t Length, unsigned int Hash);
+bool KwmValidateCommandArgs(const char *Schema, std::vector<std::string> &Args, std::string &Error);
+kwm_command *KwmResolveCommand(kwm_command_table *Table, const std::string &Message,
+                               std::vector<std::string> &Args, std::string &Error);
+void KwmCreateCommandHelp(kwm_command_table *Table, std::string Prefix, std::string &Output);
+
+#endif
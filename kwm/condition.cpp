@@ -0,0 +1,264 @@
+#include "condition.h"
+#include "interpreter.h"
+#include "helpers.h"
+#include "space.h"
+#include "window.h"
+#include "serializer.h"
+
+extern kwm_screen KWMScreen;
+extern kwm_focus KWMFocus;
+extern kwm_hotkeys KWMHotkeys;
+extern kwm_mode KWMMode;
+
+/* A conditional command has the form
+ *
+ *     if <field> ==|!= <value> then <command> [else <command>]
+ *
+ * where the else branch may itself be another 'if'. The chain is compiled into a
+ * list of clauses; the last clause of a chain with an else branch uses the field
+ * ConditionFieldAlways. Every branch is resolved through the command table once,
+ * so evaluating a chain only compares live state against the compiled values. */
+
+struct kwm_condition_field
+{
+    const char *Name;
+    condition_field Field;
+    const char *Values;
+};
+
+kwm_condition_field KwmConditionFields[] =
+{
+    { "focused.owner", ConditionFieldFocusedOwner, NULL },
+    { "focused.name", ConditionFieldFocusedName, NULL },
+    { "focused.id", ConditionFieldFocusedID, "<int>" },
+    { "focused.float", ConditionFieldFocusedFloat, "true|false" },
+    { "marked.id", ConditionFieldMarkedID, "<int>" },
+    { "space.mode", ConditionFieldSpaceMode, "bsp|monocle|float" },
+    { "display.id", ConditionFieldDisplayID, "<int>" },
+    { "prefix", ConditionFieldPrefix, "active|inactive" },
+};
+
+bool KwmIsConditionalCommand(const std::string &Message)
+{
+    return Message.compare(0, 3, "if ") == 0;
+}
+
+bool KwmReadConditionWord(const std::string &Message, std::size_t *At, std::string &Word)
+{
+    std::size_t Start = *At;
+    if(Start >= Message.size())
+        return false;
+
+    if(Message[Start] == '"')
+    {
+        std::size_t End = Message.find('"', Start + 1);
+        if(End == std::string::npos)
+            return false;
+
+        Word = Message.substr(Start + 1, End - (Start + 1));
+        *At = End + 1;
+    }
+    else
+    {
+        std::size_t End = Message.find(' ', Start);
+        if(End == std::string::npos)
+            End = Message.size();
+
+        Word = Message.substr(Start, End - Start);
+        *At = End;
+    }
+
+    if(*At < Message.size() && Message[*At] == ' ')
+        ++*At;
+
+    return true;
+}
+
+bool KwmCompileConditionValue(kwm_condition_field *Field, kwm_condition *Condition, std::string &Error)
+{
+    if(!Field->Values)
+        return true;
+
+    std::vector<std::string> Value(1, Condition->Value);
+    if(!KwmValidateCommandArgs(Field->Values, Value, Error))
+    {
+        Error = std::string("error: invalid value '") + Condition->Value +
+                "' for '" + Field->Name + "', expected '" + Field->Values + "'";
+        return false;
+    }
+
+    if(Condition->Field == ConditionFieldFocusedFloat)
+        Condition->Number = Condition->Value == "true";
+    else if(Condition->Field == ConditionFieldPrefix)
+        Condition->Number = Condition->Value == "active";
+    else
+        Condition->Number = ConvertStringToInt(Condition->Value);
+
+    return true;
+}
+
+bool KwmCompileConditionBranch(const std::string &Branch, kwm_condition *Condition, std::string &Error)
+{
+    if(KwmIsConditionalCommand(Branch))
+    {
+        Error = "error: 'if' is only allowed after 'else'";
+        return false;
+    }
+
+    return KwmCompileCommand(Branch, &Condition->Command, Condition->Args, Error);
+}
+
+bool KwmCompileConditions(const std::string &Message, std::vector<kwm_condition> &Conditions, std::string &Error)
+{
+    Conditions.clear();
+    std::string Chain = Message;
+    while(KwmIsConditionalCommand(Chain))
+    {
+        kwm_condition Condition = {};
+        std::string Name, Operator;
+        std::size_t At = 3;
+
+        if(!KwmReadConditionWord(Chain, &At, Name) ||
+           !KwmReadConditionWord(Chain, &At, Operator) ||
+           !KwmReadConditionWord(Chain, &At, Condition.Value))
+        {
+            Error = "error: expected 'if <field> ==|!= <value> then <command>'";
+            return false;
+        }
+
+        kwm_condition_field *Field = NULL;
+        for(std::size_t Index = 0; Index < sizeof(KwmConditionFields) / sizeof(KwmConditionFields[0]); ++Index)
+        {
+            if(Name == KwmConditionFields[Index].Name)
+                Field = &KwmConditionFields[Index];
+        }
+
+        if(!Field)
+        {
+            Error = "error: unknown condition field '" + Name + "'";
+            return false;
+        }
+
+        if(Operator != "==" && Operator != "!=")
+        {
+            Error = "error: unknown condition operator '" + Operator + "', expected '==' or '!='";
+            return false;
+        }
+
+        Condition.Field = Field->Field;
+        Condition.Equal = Operator == "==";
+        if(!KwmCompileConditionValue(Field, &Condition, Error))
+            return false;
+
+        if(Chain.compare(At, 5, "then ") != 0)
+        {
+            Error = "error: expected 'then' after condition";
+            return false;
+        }
+
+        std::string Then = Chain.substr(At + 5);
+        std::size_t Else = Then.find(" else ");
+        Chain = Else == std::string::npos ? "" : Then.substr(Else + 6);
+        if(Else != std::string::npos)
+            Then.erase(Else);
+
+        if(!KwmCompileConditionBranch(Then, &Condition, Error))
+            return false;
+
+        Conditions.push_back(Condition);
+        if(Else != std::string::npos && !KwmIsConditionalCommand(Chain))
+        {
+            kwm_condition Otherwise = {};
+            Otherwise.Field = ConditionFieldAlways;
+            Otherwise.Equal = true;
+            if(!KwmCompileConditionBranch(Chain, &Otherwise, Error))
+                return false;
+
+            Conditions.push_back(Otherwise);
+        }
+    }
+
+    if(Conditions.empty())
+    {
+        Error = "error: expected 'if <field> ==|!= <value> then <command>'";
+        return false;
+    }
+
+    return true;
+}
+
+space_tiling_option KwmGetActiveSpaceMode()
+{
+    space_tiling_option Mode = SpaceModeDefault;
+    if(KWMScreen.Current && DoesSpaceExistInMapOfScreen(KWMScreen.Current))
+        Mode = GetActiveSpaceOfScreen(KWMScreen.Current)->Settings.Mode;
+
+    return Mode == SpaceModeDefault ? KWMMode.Space : Mode;
+}
+
+bool KwmEvaluateCondition(kwm_condition *Condition)
+{
+    bool Result = false;
+    switch(Condition->Field)
+    {
+        case ConditionFieldAlways: { Result = true; } break;
+        case ConditionFieldFocusedOwner: { Result = KWMFocus.Window && KWMFocus.Window->Owner == Condition->Value; } break;
+        case ConditionFieldFocusedName: { Result = KWMFocus.Window && KWMFocus.Window->Name == Condition->Value; } break;
+        case ConditionFieldFocusedID: { Result = (KWMFocus.Window ? KWMFocus.Window->WID : -1) == Condition->Number; } break;
+        case ConditionFieldMarkedID: { Result = KWMScreen.MarkedWindow == Condition->Number; } break;
+        case ConditionFieldDisplayID:
+        {
+            if(KWMScreen.Current)
+                Result = Condition->Number >= 0 && KWMScreen.Current->ID == (unsigned int) Condition->Number;
+            else
+                Result = Condition->Number == -1;
+        } break;
+        case ConditionFieldPrefix: { Result = KWMHotkeys.Prefix.Active == (Condition->Number != 0); } break;
+        case ConditionFieldSpaceMode: { Result = Condition->Value == GetSpaceModeName(KwmGetActiveSpaceMode()); } break;
+        case ConditionFieldFocusedFloat:
+        {
+            bool Floating = KWMFocus.Window && IsWindowFloating(KWMFocus.Window->WID, NULL);
+            Result = Floating == (Condition->Number != 0);
+        } break;
+    }
+
+    return Condition->Equal ? Result : !Result;
+}
+
+kwm_condition *KwmEvaluateConditions(std::vector<kwm_condition> &Conditions)
+{
+    for(std::size_t Index = 0; Index < Conditions.size(); ++Index)
+    {
+        if(KwmEvaluateCondition(&Conditions[Index]))
+            return &Conditions[Index];
+    }
+
+    return NULL;
+}
+
+void KwmCreateConditionsString(std::vector<kwm_condition> &Conditions, std::string &Output)
+{
+    for(std::size_t Index = 0; Index < Conditions.size(); ++Index)
+    {
+        kwm_condition *Condition = &Conditions[Index];
+        if(Index > 0)
+            Output += " else ";
+
+        if(Condition->Field != ConditionFieldAlways)
+        {
+            for(std::size_t FieldIndex = 0; FieldIndex < sizeof(KwmConditionFields) / sizeof(KwmConditionFields[0]); ++FieldIndex)
+            {
+                if(KwmConditionFields[FieldIndex].Field == Condition->Field)
+                    Output += std::string("if ") + KwmConditionFields[FieldIndex].Name;
+            }
+
+            Output += Condition->Equal ? " == \"" : " != \"";
+            Output += Condition->Value + "\" then ";
+        }
+
+        Output += std::string(Condition->Command->Path) + " [";
+        for(std::size_t ArgIndex = 0; ArgIndex < Condition->Args.size(); ++ArgIndex)
+            Output += (ArgIndex ? ", " : "") + Condition->Args[ArgIndex];
+        Output += "]";
+    }
+}
@@ -0,0 +1,11 @@
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include "types.h"
+
+bool KwmIsConditionalCommand(const std::string &Message);
+bool KwmCompileConditions(const std::string &Message, std::vector<kwm_condition> &Conditions, std::string &Error);
+kwm_condition *KwmEvaluateConditions(std::vector<kwm_condition> &Conditions);
+void KwmCreateConditionsString(std::vector<kwm_condition> &Conditions, std::string &Output);
+
+#endif
@@ -0,0 +1,504 @@
+#include "config.h"
+#include "interpreter.h"
+#include "keys.h"
+#include "kwm.h"
+#include "rules.h"
+#include "space.h"
+#include "window.h"
+
+extern kwm_path KWMPath;
+extern kwm_command_table KwmCommandTable;
+extern kwm_hotkeys KWMHotkeys;
+extern kwm_tiling KWMTiling;
+
+/* While the config is executed, every file that is opened and every expanded line
+ * (includes followed, defines substituted) is recorded. The result is written to
+ * $HOME/.kwm/kwmrc.cache in a binary form where each kwmc line is already resolved
+ * to its index in the command table together with its arguments, and the keycodes
+ * of the characters bound by the config are stored with the keyboard layout they
+ * were translated for.
+ *
+ * The cache is used only if every recorded file still has the same modification
+ * time and size, or else the same content hash, and the command table is the one
+ * it was compiled against. Loading it skips reading and expanding the config files,
+ * resolving every command and translating the keyboard layout. */
+
+#define KWM_CONFIG_CACHE_MAGIC 0x43574b4d
+#define KWM_CONFIG_CACHE_VERSION 2
+
+bool KwmConfigRecording = false;
+bool KwmConfigBypass = false;
+std::vector<config_source> KwmConfigSources;
+std::vector<config_line> KwmConfigLines;
+
+bool KwmConfigFromCache = false;
+double KwmConfigLoadTime = 0;
+
+std::string KwmGetConfigCachePath()
+{
+    return KWMPath.EnvHome + "/" + KWMPath.ConfigFolder + "/" + KWMPath.ConfigFile + ".cache";
+}
+
+unsigned int KwmHashConfigFile(const std::string &Path)
+{
+    unsigned int Hash = 2166136261u;
+    FILE *Handle = fopen(Path.c_str(), "rb");
+    if(Handle)
+    {
+        char Buffer[4096];
+        std::size_t Bytes;
+        while((Bytes = fread(Buffer, 1, sizeof(Buffer), Handle)) > 0)
+        {
+            for(std::size_t Index = 0; Index < Bytes; ++Index)
+            {
+                Hash ^= (unsigned char) Buffer[Index];
+                Hash *= 16777619u;
+            }
+        }
+
+        fclose(Handle);
+    }
+
+    return Hash;
+}
+
+void KwmGetConfigSource(const std::string &Path, config_source *Source, bool Hash)
+{
+    struct stat Buffer;
+    Source->Path = Path;
+    Source->Size = -1;
+    Source->Hash = 0;
+
+    if(stat(Path.c_str(), &Buffer) == 0)
+    {
+        Source->Size = Buffer.st_size;
+        if(Hash)
+            Source->Hash = KwmHashConfigFile(Path);
+    }
+}
+
+void KwmBeginConfigRecording()
+{
+    KwmConfigRecording = true;
+    KwmConfigSources.clear();
+    KwmConfigLines.clear();
+}
+
+void KwmRecordConfigSource(const std::string &Path)
+{
+    if(KwmConfigRecording)
+    {
+        config_source Source;
+        KwmGetConfigSource(Path, &Source, true);
+        KwmConfigSources.push_back(Source);
+    }
+}
+
+void KwmRecordConfigLine(config_line_type Type, const std::string &Line)
+{
+    if(KwmConfigRecording)
+    {
+        config_line ConfigLine = { Type, Line };
+        KwmConfigLines.push_back(ConfigLine);
+    }
+}
+
+void KwmWriteCacheInt(FILE *Handle, long long Value)
+{
+    fwrite(&Value, sizeof(Value), 1, Handle);
+}
+
+void KwmWriteCacheString(FILE *Handle, const std::string &Value)
+{
+    KwmWriteCacheInt(Handle, Value.size());
+    fwrite(Value.c_str(), Value.size(), 1, Handle);
+}
+
+bool KwmReadCacheInt(FILE *Handle, long long *Value)
+{
+    return fread(Value, sizeof(*Value), 1, Handle) == 1;
+}
+
+bool KwmReadCacheString(FILE *Handle, std::string &Value)
+{
+    long long Length;
+    if(!KwmReadCacheInt(Handle, &Length) || Length < 0 || Length > (1 << 20))
+        return false;
+
+    Value.resize(Length);
+    return Length == 0 || fread(&Value[0], Length, 1, Handle) == 1;
+}
+
+void KwmEndConfigRecording()
+{
+    if(!KwmConfigRecording)
+        return;
+
+    KwmConfigRecording = false;
+    std::string CachePath = KwmGetConfigCachePath();
+    std::string TempPath = CachePath + ".tmp";
+    FILE *Handle = fopen(TempPath.c_str(), "wb");
+    if(!Handle)
+    {
+        DEBUG("KwmEndConfigRecording() Could not write " << TempPath);
+        return;
+    }
+
+    KwmWriteCacheInt(Handle, KWM_CONFIG_CACHE_MAGIC);
+    KwmWriteCacheInt(Handle, KWM_CONFIG_CACHE_VERSION);
+    KwmWriteCacheInt(Handle, KwmGetCommandTableSignature(&KwmCommandTable));
+
+    KwmWriteCacheInt(Handle, KwmConfigSources.size());
+    for(std::size_t Index = 0; Index < KwmConfigSources.size(); ++Index)
+    {
+        config_source *Source = &KwmConfigSources[Index];
+        KwmWriteCacheString(Handle, Source->Path);
+        KwmWriteCacheInt(Handle, Source->Size);
+        KwmWriteCacheInt(Handle, Source->Hash);
+    }
+
+    KwmWriteCacheString(Handle, KwmGetKeyboardLayoutID());
+    std::vector<long long> Keycodes;
+    for(int Key = 0; Key < 128; ++Key)
+    {
+        CGKeyCode Keycode;
+        if(KwmGetCachedKeycode(Key, &Keycode))
+        {
+            Keycodes.push_back(Key);
+            Keycodes.push_back(Keycode);
+        }
+    }
+
+    KwmWriteCacheInt(Handle, Keycodes.size() / 2);
+    for(std::size_t Index = 0; Index < Keycodes.size(); ++Index)
+        KwmWriteCacheInt(Handle, Keycodes[Index]);
+
+    std::vector<config_line *> Lines;
+    std::vector<kwm_command *> Commands;
+    std::vector<std::vector<std::string> > Arguments;
+    for(std::size_t Index = 0; Index < KwmConfigLines.size(); ++Index)
+    {
+        std::string Error;
+        kwm_command *Command = NULL;
+        std::vector<std::string> Args;
+        if(KwmConfigLines[Index].Type == ConfigLineSystem ||
+           KwmCompileCommand(KwmConfigLines[Index].Text, &Command, Args, Error))
+        {
+            Lines.push_back(&KwmConfigLines[Index]);
+            Commands.push_back(Command);
+            Arguments.push_back(Args);
+        }
+    }
+
+    KwmWriteCacheInt(Handle, Lines.size());
+    for(std::size_t Index = 0; Index < Lines.size(); ++Index)
+    {
+        KwmWriteCacheInt(Handle, Lines[Index]->Type);
+        if(Lines[Index]->Type == ConfigLineSystem)
+        {
+            KwmWriteCacheString(Handle, Lines[Index]->Text);
+        }
+        else
+        {
+            KwmWriteCacheInt(Handle, Commands[Index] - KwmCommandTable.Commands);
+            KwmWriteCacheInt(Handle, Arguments[Index].size());
+            for(std::size_t ArgIndex = 0; ArgIndex < Arguments[Index].size(); ++ArgIndex)
+                KwmWriteCacheString(Handle, Arguments[Index][ArgIndex]);
+        }
+    }
+
+    bool Failed = ferror(Handle);
+    fclose(Handle);
+
+    if(Failed || rename(TempPath.c_str(), CachePath.c_str()) != 0)
+        unlink(TempPath.c_str());
+
+    KwmConfigSources.clear();
+    KwmConfigLines.clear();
+}
+
+/* The content hash is always compared: mtime has a resolution of one second on
+ * HFS+, so an edit that keeps the size within the same second would otherwise
+ * look unchanged. Hashing a config file costs far less than expanding it. A source
+ * that was missing when the cache was written stays valid as long as it is still
+ * missing. */
+bool KwmIsConfigSourceValid(config_source *Source)
+{
+    config_source Current;
+    KwmGetConfigSource(Source->Path, &Current, false);
+    if(Current.Size != Source->Size)
+        return false;
+
+    return Current.Size == -1 || KwmHashConfigFile(Source->Path) == Source->Hash;
+}
+
+/* The whole cache is read and validated before anything is executed, so a cache
+ * that turns out to be stale or damaged never leaves a half applied config behind. */
+bool KwmExecuteConfigCache()
+{
+    if(KwmConfigBypass)
+    {
+        KwmConfigBypass = false;
+        return false;
+    }
+
+    FILE *Handle = fopen(KwmGetConfigCachePath().c_str(), "rb");
+    if(!Handle)
+        return false;
+
+    long long Magic, Version, Signature, Count;
+    bool Valid = KwmReadCacheInt(Handle, &Magic) && Magic == KWM_CONFIG_CACHE_MAGIC &&
+                 KwmReadCacheInt(Handle, &Version) && Version == KWM_CONFIG_CACHE_VERSION &&
+                 KwmReadCacheInt(Handle, &Signature) &&
+                 Signature == KwmGetCommandTableSignature(&KwmCommandTable) &&
+                 KwmReadCacheInt(Handle, &Count);
+
+    for(long long Index = 0; Valid && Index < Count; ++Index)
+    {
+        long long Size, Hash;
+        config_source Source;
+        Valid = KwmReadCacheString(Handle, Source.Path) &&
+                KwmReadCacheInt(Handle, &Size) &&
+                KwmReadCacheInt(Handle, &Hash);
+
+        Source.Size = Size;
+        Source.Hash = Hash;
+        Valid = Valid && KwmIsConfigSourceValid(&Source);
+    }
+
+    std::string Layout;
+    std::vector<long long> Keycodes;
+    Valid = Valid && KwmReadCacheString(Handle, Layout) && KwmReadCacheInt(Handle, &Count);
+    for(long long Index = 0; Valid && Index < Count * 2; ++Index)
+    {
+        long long Value;
+        Valid = KwmReadCacheInt(Handle, &Value);
+        Keycodes.push_back(Value);
+    }
+
+    std::vector<config_line_type> Types;
+    std::vector<long long> Commands;
+    std::vector<std::vector<std::string> > Arguments;
+    Valid = Valid && KwmReadCacheInt(Handle, &Count);
+    for(long long Index = 0; Valid && Index < Count; ++Index)
+    {
+        long long Type, Command = -1, ArgCount = 1;
+        Arguments.push_back(std::vector<std::string>());
+        Valid = KwmReadCacheInt(Handle, &Type) &&
+                (Type == ConfigLineSystem ||
+                 (KwmReadCacheInt(Handle, &Command) &&
+                  Command >= 0 && Command < KwmCommandTable.Count &&
+                  KwmReadCacheInt(Handle, &ArgCount)));
+
+        for(long long ArgIndex = 0; Valid && ArgIndex < ArgCount; ++ArgIndex)
+        {
+            Arguments.back().push_back(std::string());
+            Valid = KwmReadCacheString(Handle, Arguments.back().back());
+        }
+
+        Types.push_back((config_line_type) Type);
+        Commands.push_back(Command);
+    }
+
+    fclose(Handle);
+    if(!Valid)
+    {
+        DEBUG("KwmExecuteConfigCache() Cache is stale, executing config");
+        return false;
+    }
+
+    if(Layout == KwmGetKeyboardLayoutID())
+    {
+        for(std::size_t Index = 0; Index + 1 < Keycodes.size(); Index += 2)
+            KwmSetCachedKeycode(Keycodes[Index], Keycodes[Index + 1]);
+    }
+
+    for(std::size_t Index = 0; Index < Types.size(); ++Index)
+    {
+        if(Types[Index] == ConfigLineSystem)
+            KwmExecuteThreadedSystemCommand(Arguments[Index][0]);
+        else
+            KwmExecuteCommand(&KwmCommandTable.Commands[Commands[Index]], Arguments[Index], 0);
+    }
+
+    return true;
+}
+
+void KwmBypassConfigCache()
+{
+    KwmConfigBypass = true;
+}
+
+void KwmSetConfigLoadTime(double Milliseconds, bool FromCache)
+{
+    KwmConfigLoadTime = Milliseconds;
+    KwmConfigFromCache = FromCache;
+    DEBUG("Config loaded from " << (FromCache ? "cache" : "file") << " in " << Milliseconds << "ms");
+}
+
+std::string KwmGetConfigCacheStats()
+{
+    char Buffer[32];
+    snprintf(Buffer, sizeof(Buffer), "%.2fms", KwmConfigLoadTime);
+    return std::string("source: ") + (KwmConfigFromCache ? "cache" : "file") + ", load-time: " + Buffer;
+}
+
+/* A reload executes the new config into cleared settings, which act as the staging
+ * model, and then compares it against the settings saved here. Windows keep their
+ * enforcement state unless a rule that matches them was added or removed, so an
+ * unchanged rule set never moves existing windows between spaces again. */
+void KwmSaveConfigSettings(config_settings *Settings)
+{
+    Settings->Hotkeys = KWMHotkeys.List;
+    Settings->PrefixKey = KWMHotkeys.Prefix.Key;
+    Settings->PrefixEnabled = KWMHotkeys.Prefix.Enabled;
+    Settings->WindowRules = KWMTiling.WindowRules;
+    Settings->SpaceSettings = KWMTiling.SpaceSettings;
+    Settings->DisplaySettings = KWMTiling.DisplaySettings;
+    Settings->AllowedWindowRoles.swap(KWMTiling.AllowedWindowRoles);
+}
+
+int KwmCountMissingHotkeys(std::vector<hotkey> &From, std::vector<hotkey> &In)
+{
+    int Count = 0;
+    for(std::size_t Index = 0; Index < From.size(); ++Index)
+    {
+        bool Found = false;
+        for(std::size_t Other = 0; !Found && Other < In.size(); ++Other)
+            Found = HotkeyBindingsAreEqual(&From[Index], &In[Other]);
+
+        if(!Found)
+            ++Count;
+    }
+
+    return Count;
+}
+
+int KwmCountMissingRules(std::vector<window_rule> &From, std::vector<window_rule> &In, std::vector<window_rule> &Changed)
+{
+    int Count = 0;
+    for(std::size_t Index = 0; Index < From.size(); ++Index)
+    {
+        bool Found = false;
+        for(std::size_t Other = 0; !Found && Other < In.size(); ++Other)
+            Found = WindowRulesAreEqual(&From[Index], &In[Other]);
+
+        if(!Found)
+        {
+            Changed.push_back(From[Index]);
+            ++Count;
+        }
+    }
+
+    return Count;
+}
+
+int KwmCountChangedSpaceSettings(std::map<space_identifier, space_settings> &From,
+                                 std::map<space_identifier, space_settings> &In)
+{
+    int Count = 0;
+    std::map<space_identifier, space_settings>::iterator It;
+    for(It = From.begin(); It != From.end(); ++It)
+    {
+        std::map<space_identifier, space_settings>::iterator Match = In.find(It->first);
+        if(Match == In.end() || !SpaceSettingsAreEqual(&It->second, &Match->second))
+            ++Count;
+    }
+
+    return Count;
+}
+
+int KwmCountChangedDisplaySettings(std::map<unsigned int, space_settings> &From,
+                                   std::map<unsigned int, space_settings> &In)
+{
+    int Count = 0;
+    std::map<unsigned int, space_settings>::iterator It;
+    for(It = From.begin(); It != From.end(); ++It)
+    {
+        std::map<unsigned int, space_settings>::iterator Match = In.find(It->first);
+        if(Match == In.end() || !SpaceSettingsAreEqual(&It->second, &Match->second))
+            ++Count;
+    }
+
+    return Count;
+}
+
+int KwmCountChangedRoles(std::map<std::string, std::vector<CFTypeRef> > &From,
+                         std::map<std::string, std::vector<CFTypeRef> > &In)
+{
+    int Count = 0;
+    std::map<std::string, std::vector<CFTypeRef> >::iterator It;
+    for(It = From.begin(); It != From.end(); ++It)
+    {
+        std::map<std::string, std::vector<CFTypeRef> >::iterator Match = In.find(It->first);
+        bool Equal = Match != In.end() && Match->second.size() == It->second.size();
+        for(std::size_t Index = 0; Equal && Index < It->second.size(); ++Index)
+            Equal = CFEqual(It->second[Index], Match->second[Index]);
+
+        if(!Equal)
+            ++Count;
+    }
+
+    return Count;
+}
+
+void KwmDiffConfigSettings(config_settings *Previous, std::string &Report)
+{
+    std::vector<window_rule> ChangedRules;
+    int HotkeysAdded = KwmCountMissingHotkeys(KWMHotkeys.List, Previous->Hotkeys);
+    int HotkeysRemoved = KwmCountMissingHotkeys(Previous->Hotkeys, KWMHotkeys.List);
+    int RulesAdded = KwmCountMissingRules(KWMTiling.WindowRules, Previous->WindowRules, ChangedRules);
+    int RulesRemoved = KwmCountMissingRules(Previous->WindowRules, KWMTiling.WindowRules, ChangedRules);
+
+    int Prefix = Previous->PrefixEnabled != KWMHotkeys.Prefix.Enabled ||
+                 (KWMHotkeys.Prefix.Enabled && !HotkeysAreEqual(&Previous->PrefixKey, &KWMHotkeys.Prefix.Key));
+
+    int Spaces = KwmCountChangedSpaceSettings(KWMTiling.SpaceSettings, Previous->SpaceSettings);
+    std::map<space_identifier, space_settings>::iterator SpaceIt;
+    for(SpaceIt = Previous->SpaceSettings.begin(); SpaceIt != Previous->SpaceSettings.end(); ++SpaceIt)
+        Spaces += KWMTiling.SpaceSettings.find(SpaceIt->first) == KWMTiling.SpaceSettings.end();
+
+    int Displays = KwmCountChangedDisplaySettings(KWMTiling.DisplaySettings, Previous->DisplaySettings);
+    std::map<unsigned int, space_settings>::iterator DisplayIt;
+    for(DisplayIt = Previous->DisplaySettings.begin(); DisplayIt != Previous->DisplaySettings.end(); ++DisplayIt)
+        Displays += KWMTiling.DisplaySettings.find(DisplayIt->first) == KWMTiling.DisplaySettings.end();
+
+    int Roles = KwmCountChangedRoles(KWMTiling.AllowedWindowRoles, Previous->AllowedWindowRoles);
+    std::map<std::string, std::vector<CFTypeRef> >::iterator RoleIt;
+    for(RoleIt = Previous->AllowedWindowRoles.begin(); RoleIt != Previous->AllowedWindowRoles.end(); ++RoleIt)
+    {
+        Roles += KWMTiling.AllowedWindowRoles.find(RoleIt->first) == KWMTiling.AllowedWindowRoles.end();
+        for(std::size_t Index = 0; Index < RoleIt->second.size(); ++Index)
+            CFRelease(RoleIt->second[Index]);
+    }
+
+    int Enforced = 0;
+    std::map<int, bool>::iterator It = KWMTiling.EnforcedWindows.begin();
+    while(It != KWMTiling.EnforcedWindows.end())
+    {
+        window_info *Window = GetWindowByID(It->first);
+        bool Affected = false;
+        for(std::size_t Index = 0; Window && !Affected && Index < ChangedRules.size(); ++Index)
+            Affected = MatchWindowRule(&ChangedRules[Index], Window);
+
+        if(Affected)
+        {
+            KWMTiling.EnforcedWindows.erase(It++);
+            ++Enforced;
+        }
+        else
+        {
+            ++It;
+        }
+    }
+
+    int Changes = HotkeysAdded + HotkeysRemoved + RulesAdded + RulesRemoved + Prefix + Spaces + Displays + Roles;
+    Report = "changes: " + std::to_string(Changes) +
+             " (hotkeys: +" + std::to_string(HotkeysAdded) + " -" + std::to_string(HotkeysRemoved) +
+             ", prefix: " + std::to_string(Prefix) +
+             ", rules: +" + std::to_string(RulesAdded) + " -" + std::to_string(RulesRemoved) +
+             ", spaces: " + std::to_string(Spaces) +
+             ", displays: " + std::to_string(Displays) +
+             ", roles: " + std::to_string(Roles) +
+             "), windows re-evaluated: " + std::to_string(Enforced);
+}
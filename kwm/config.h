@@ -0,0 +1,19 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "types.h"
+
+void KwmBeginConfigRecording();
+void KwmRecordConfigSource(const std::string &Path);
+void KwmRecordConfigLine(config_line_type Type, const std::string &Line);
+void KwmEndConfigRecording();
+
+bool KwmExecuteConfigCache();
+void KwmBypassConfigCache();
+void KwmSetConfigLoadTime(double Milliseconds, bool FromCache);
+std::string KwmGetConfigCacheStats();
+
+void KwmSaveConfigSettings(config_settings *Settings);
+void KwmDiffConfigSettings(config_settings *Previous, std::string &Report);
+
+#endif
@@ -1,9 +1,33 @@
 #include "daemon.h"
+#include "space.h"
+#include "window.h"
+#include "state.h"
+#include "cache.h"
+
+#include <cstring>
+
+extern kwm_screen KWMScreen;
+extern kwm_focus KWMFocus;
+extern kwm_mode KWMMode;
+extern kwm_toggles KWMToggles;
+extern kwm_hotkeys KWMHotkeys;
+
+#define KWM_DAEMON_THREADS 4
 
 int KwmSockFD;
 bool KwmDaemonIsRunning;
 int KwmDaemonPort = 3020;
 
+/* Subscribers are only ever written to with non-blocking sends. A subscriber
+ * that can not keep up is shut down and marked dead; only the daemon threads close
+ * the descriptor, which they do in KwmReapSubscribers while holding
+ * KwmSubscriberLock, the lock every send to a subscriber is made under. */
+std::vector<kwm_subscriber> KwmSubscribers;
+pthread_mutex_t KwmSubscriberLock = PTHREAD_MUTEX_INITIALIZER;
+unsigned int KwmSubscribedEvents = 0;
+unsigned int KwmPendingEvents = 0;
+std::string KwmLastEvent[5];
+
 std::string KwmReadFromSocket(int ClientSockFD)
 {
     char Cur;
@@ -22,7 +46,7 @@ void KwmWriteToSocket(int ClientSockFD, std::string Msg)
     send(ClientSockFD, Msg.c_str(), Msg.size(), 0);
 }
 
-void * KwmDaemonHandleConnectionBG(void *)
+void * KwmDaemonAcceptConnections(void *)
 {
     while(KwmDaemonIsRunning)
         KwmDaemonHandleConnection();
@@ -30,6 +54,22 @@ void * KwmDaemonHandleConnectionBG(void *)
     return NULL;
 }
 
+/* Several threads accept connections on the same socket, so a client that is slow
+ * to send its message holds up only one of them, and queries answered from the
+ * query snapshot are served in parallel. Mutating commands are still serialized
+ * through KWMThread.Lock. */
+void * KwmDaemonHandleConnectionBG(void *)
+{
+    for(int Thread = 1; Thread < KWM_DAEMON_THREADS; ++Thread)
+    {
+        pthread_t Worker;
+        if(pthread_create(&Worker, NULL, &KwmDaemonAcceptConnections, NULL) == 0)
+            pthread_detach(Worker);
+    }
+
+    return KwmDaemonAcceptConnections(NULL);
+}
+
 void KwmDaemonHandleConnection()
 {
     int ClientSockFD;
@@ -41,9 +81,14 @@ void KwmDaemonHandleConnection()
     {
         std::string Message = KwmReadFromSocket(ClientSockFD);
         KwmInterpretCommand(Message, ClientSockFD);
-        shutdown(ClientSockFD, SHUT_RDWR);
-        close(ClientSockFD);
+        if(!KwmIsSubscriber(ClientSockFD))
+        {
+            shutdown(ClientSockFD, SHUT_RDWR);
+            close(ClientSockFD);
+        }
     }
+
+    KwmReapSubscribers();
 }
 
 void KwmTerminateDaemon()
@@ -78,3 +123,217 @@ bool KwmStartDaemon()
     DEBUG("Local Daemon is now running..");
     return true;
 }
+
+bool KwmParseEventType(std::string Name, unsigned int *Events)
+{
+    if(Name == "focus")
+        *Events |= EventTypeFocus;
+    else if(Name == "space")
+        *Events |= EventTypeSpace;
+    else if(Name == "tree")
+        *Events |= EventTypeTree;
+    else if(Name == "mode")
+        *Events |= EventTypeMode;
+    else if(Name == "prefix")
+        *Events |= EventTypePrefix;
+    else if(Name == "all")
+        *Events |= EventTypeAll;
+    else
+        return false;
+
+    return true;
+}
+
+int GetEventSlot(event_type Event)
+{
+    int Slot = 0;
+    while(!(Event & (1 << Slot)))
+        ++Slot;
+
+    return Slot;
+}
+
+bool KwmSendEvent(kwm_subscriber *Subscriber, std::string &Message)
+{
+    ssize_t Sent = send(Subscriber->SockFD, Message.c_str(), Message.size(), MSG_DONTWAIT);
+    return Sent == (ssize_t)Message.size();
+}
+
+void KwmDropSubscriber(kwm_subscriber *Subscriber)
+{
+    DEBUG("KwmDropSubscriber() Dropping subscriber " << Subscriber->SockFD);
+    shutdown(Subscriber->SockFD, SHUT_RDWR);
+    Subscriber->Alive = false;
+}
+
+void UpdateSubscribedEvents()
+{
+    unsigned int Events = 0;
+    for(std::size_t Index = 0; Index < KwmSubscribers.size(); ++Index)
+    {
+        if(KwmSubscribers[Index].Alive)
+            Events |= KwmSubscribers[Index].Events;
+    }
+
+    KwmSubscribedEvents = Events;
+}
+
+void KwmAddSubscriber(int ClientSockFD, unsigned int Events)
+{
+#ifdef SO_NOSIGPIPE
+    int _True = 1;
+    setsockopt(ClientSockFD, SOL_SOCKET, SO_NOSIGPIPE, &_True, sizeof(int));
+#endif
+
+    kwm_subscriber Subscriber = { ClientSockFD, Events, true };
+    for(int Slot = 0; Slot < 5; ++Slot)
+    {
+        event_type Event = (event_type)(1 << Slot);
+        if((Events & Event) && Event != EventTypeTree)
+        {
+            std::string Message;
+            KwmCreateEventMessage(Event, Message);
+            if(!KwmSendEvent(&Subscriber, Message))
+                return;
+        }
+    }
+
+    pthread_mutex_lock(&KwmSubscriberLock);
+    KwmSubscribers.push_back(Subscriber);
+    UpdateSubscribedEvents();
+    pthread_mutex_unlock(&KwmSubscriberLock);
+}
+
+bool KwmIsSubscriber(int ClientSockFD)
+{
+    bool Result = false;
+
+    pthread_mutex_lock(&KwmSubscriberLock);
+    for(std::size_t Index = 0; Index < KwmSubscribers.size(); ++Index)
+    {
+        if(KwmSubscribers[Index].SockFD == ClientSockFD)
+        {
+            Result = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&KwmSubscriberLock);
+
+    return Result;
+}
+
+void KwmReapSubscribers()
+{
+    pthread_mutex_lock(&KwmSubscriberLock);
+    for(std::size_t Index = 0; Index < KwmSubscribers.size();)
+    {
+        if(!KwmSubscribers[Index].Alive)
+        {
+            close(KwmSubscribers[Index].SockFD);
+            KwmSubscribers.erase(KwmSubscribers.begin() + Index);
+        }
+        else
+        {
+            ++Index;
+        }
+    }
+    pthread_mutex_unlock(&KwmSubscriberLock);
+}
+
+void KwmCreateEventMessage(event_type Event, std::string &Message)
+{
+    switch(Event)
+    {
+        case EventTypeFocus:
+        {
+            Message = "focus ";
+            if(KWMFocus.Window)
+                Message += std::to_string(KWMFocus.Window->WID) + " " + KWMFocus.Window->Owner +
+                           (KWMFocus.Window->Name.empty() ? "" : " - " + KWMFocus.Window->Name);
+            else
+                Message += "-1";
+        } break;
+        case EventTypeSpace:
+        case EventTypeTree:
+        {
+            Message = Event == EventTypeSpace ? "space " : "tree ";
+            if(KWMScreen.Current)
+                Message += std::to_string(KWMScreen.Current->ID) + " " +
+                           std::to_string(GetSpaceNumberFromCGSpaceID(KWMScreen.Current, KWMScreen.Current->ActiveSpace));
+            else
+                Message += "-1 -1";
+        } break;
+        case EventTypeMode:
+        {
+            space_tiling_option Mode = KWMMode.Space;
+            if(IsSpaceInitializedForScreen(KWMScreen.Current))
+                Mode = GetActiveSpaceOfScreen(KWMScreen.Current)->Settings.Mode;
+
+            Message = "mode ";
+            if(!KWMToggles.EnableTilingMode)
+                Message += "off";
+            else if(Mode == SpaceModeBSP)
+                Message += "bsp";
+            else if(Mode == SpaceModeMonocle)
+                Message += "monocle";
+            else
+                Message += "float";
+        } break;
+        case EventTypePrefix:
+        {
+            Message = KWMHotkeys.Prefix.Active ? "prefix active" : "prefix inactive";
+        } break;
+        default: {} break;
+    }
+
+    Message += "\n";
+}
+
+void KwmEmitEvent(event_type Event)
+{
+    KwmUpdateStatePage();
+    if(!(KwmSubscribedEvents & Event))
+        return;
+
+    std::string Message;
+    KwmCreateEventMessage(Event, Message);
+
+    pthread_mutex_lock(&KwmSubscriberLock);
+    int Slot = GetEventSlot(Event);
+    if(Event == EventTypeTree || KwmLastEvent[Slot] != Message)
+    {
+        KwmLastEvent[Slot] = Message;
+        for(std::size_t Index = 0; Index < KwmSubscribers.size(); ++Index)
+        {
+            kwm_subscriber *Subscriber = &KwmSubscribers[Index];
+            if(Subscriber->Alive &&
+               (Subscriber->Events & Event) &&
+               !KwmSendEvent(Subscriber, Message))
+                KwmDropSubscriber(Subscriber);
+        }
+
+        UpdateSubscribedEvents();
+    }
+    pthread_mutex_unlock(&KwmSubscriberLock);
+}
+
+void KwmMarkEventPending(event_type Event)
+{
+    KwmBumpGeneration();
+    if(KwmSubscribedEvents & Event)
+        __sync_fetch_and_or(&KwmPendingEvents, Event);
+}
+
+void KwmFlushPendingEvents()
+{
+    unsigned int Events = __sync_fetch_and_and(&KwmPendingEvents, 0);
+    for(int Slot = 0; Events; ++Slot)
+    {
+        event_type Event = (event_type)(1 << Slot);
+        if(Events & Event)
+        {
+            KwmEmitEvent(Event);
+            Events &= ~Event;
+        }
+    }
+}
@@ -15,4 +15,13 @@ void KwmDaemonHandleConnection();
 void KwmTerminateDaemon();
 bool KwmStartDaemon();
 
+bool KwmParseEventType(std::string Name, unsigned int *Events);
+void KwmAddSubscriber(int ClientSockFD, unsigned int Events);
+bool KwmIsSubscriber(int ClientSockFD);
+void KwmReapSubscribers();
+void KwmCreateEventMessage(event_type Event, std::string &Message);
+void KwmEmitEvent(event_type Event);
+void KwmMarkEventPending(event_type Event);
+void KwmFlushPendingEvents();
+
 #endif
@@ -0,0 +1,117 @@
+#include "define.h"
+
+#include <string.h>
+
+void KwmInitDefines(kwm_defines *Defines)
+{
+    define_node Root = { 0, -1, -1, -1 };
+    Defines->Nodes.clear();
+    Defines->Values.clear();
+    Defines->Nodes.push_back(Root);
+    memset(Defines->First, 0, sizeof(Defines->First));
+}
+
+int KwmFindDefineChild(kwm_defines *Defines, int Node, char Key)
+{
+    int Child = Defines->Nodes[Node].Child;
+    while(Child != -1 && Defines->Nodes[Child].Key != Key)
+        Child = Defines->Nodes[Child].Sibling;
+
+    return Child;
+}
+
+/* Returns the length of the longest define name that starts at Text and the index
+ * of its value, or 0 if no define starts there. */
+std::size_t KwmMatchDefine(kwm_defines *Defines, const char *Text, std::size_t Length, int *Value)
+{
+    std::size_t Match = 0;
+    int Node = 0;
+    for(std::size_t Index = 0; Index < Length; ++Index)
+    {
+        Node = KwmFindDefineChild(Defines, Node, Text[Index]);
+        if(Node == -1)
+            break;
+
+        if(Defines->Nodes[Node].Value != -1)
+        {
+            Match = Index + 1;
+            *Value = Defines->Nodes[Node].Value;
+        }
+    }
+
+    return Match;
+}
+
+void KwmAddDefine(kwm_defines *Defines, const std::string &Name, const std::string &Value)
+{
+    if(Name.empty())
+        return;
+
+    std::string Expanded = Value;
+    KwmSubstituteDefines(Defines, Expanded);
+
+    int Node = 0;
+    for(std::size_t Index = 0; Index < Name.size(); ++Index)
+    {
+        int Child = KwmFindDefineChild(Defines, Node, Name[Index]);
+        if(Child == -1)
+        {
+            define_node NewNode = { Name[Index], -1, Defines->Nodes[Node].Child, -1 };
+            Child = Defines->Nodes.size();
+            Defines->Nodes.push_back(NewNode);
+            Defines->Nodes[Node].Child = Child;
+        }
+
+        Node = Child;
+    }
+
+    if(Defines->Nodes[Node].Value == -1)
+    {
+        Defines->Nodes[Node].Value = Defines->Values.size();
+        Defines->Values.push_back(Expanded);
+    }
+    else
+    {
+        Defines->Values[Defines->Nodes[Node].Value] = Expanded;
+    }
+
+    Defines->First[(unsigned char) Name[0]] = true;
+}
+
+bool KwmSubstituteDefines(kwm_defines *Defines, std::string &Line)
+{
+    const char *Text = Line.c_str();
+    std::size_t Length = Line.size();
+    std::size_t Index = 0;
+
+    while(Index < Length && !Defines->First[(unsigned char) Text[Index]])
+        ++Index;
+
+    if(Index == Length)
+        return false;
+
+    std::string Result;
+    std::size_t Copied = 0;
+    for(; Index < Length; ++Index)
+    {
+        if(!Defines->First[(unsigned char) Text[Index]])
+            continue;
+
+        int Value;
+        std::size_t Match = KwmMatchDefine(Defines, Text + Index, Length - Index, &Value);
+        if(Match)
+        {
+            Result.append(Text + Copied, Index - Copied);
+            Result += Defines->Values[Value];
+            Index += Match - 1;
+            Copied = Index + 1;
+        }
+    }
+
+    if(Copied == 0)
+        return false;
+
+    Result.append(Text + Copied, Length - Copied);
+    Line.swap(Result);
+    return true;
+}
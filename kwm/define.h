@@ -0,0 +1,33 @@
+#ifndef DEFINE_H
+#define DEFINE_H
+
+#include <string>
+#include <vector>
+
+/* Defines of a config file are kept in a trie over their names. A line is scanned
+ * once from left to right; at every position the longest define name that starts
+ * there is replaced and scanning continues after it, so every occurrence is replaced
+ * and '$mod' can never clobber the start of '$mod2'. The value of a define is expanded
+ * with the defines that exist when it is defined, which makes nested defines work
+ * without rescanning the output. */
+
+struct define_node
+{
+    char Key;
+    int Child;
+    int Sibling;
+    int Value;
+};
+
+struct kwm_defines
+{
+    std::vector<define_node> Nodes;
+    std::vector<std::string> Values;
+    bool First[256];
+};
+
+void KwmInitDefines(kwm_defines *Defines);
+void KwmAddDefine(kwm_defines *Defines, const std::string &Name, const std::string &Value);
+bool KwmSubstituteDefines(kwm_defines *Defines, std::string &Line);
+
+#endif
@@ -5,6 +5,7 @@
 #include "application.h"
 #include "window.h"
 #include "helpers.h"
+#include "cache.h"
 
 extern kwm_screen KWMScreen;
 extern kwm_focus KWMFocus;
@@ -131,12 +132,13 @@ void DisplayReconfigurationCallBack(CGDirectDisplayID Display, CGDisplayChangeSu
         DEBUG("Display " << Display << " disabled");
     }
 
+    KwmBumpGeneration();
     DEBUG("[" << idx << "] END DISPLAY CONFIGURATION CALLBACK\n");
     idx++;
     pthread_mutex_unlock(&KWMThread.Lock);
 }
 
-screen_info CreateDefaultScreenInfo(int DisplayIndex, int ScreenIndex)
+screen_info CreateScreenInfo(int DisplayIndex, int ScreenIndex)
 {
     CGRect DisplayRect = CGDisplayBounds(DisplayIndex);
     screen_info Screen;
@@ -151,7 +153,6 @@ screen_info CreateDefaultScreenInfo(int DisplayIndex, int ScreenIndex)
     Screen.Width = DisplayRect.size.width;
     Screen.Height = DisplayRect.size.height;
 
-    Screen.Settings.Offset = KWMScreen.DefaultOffset;
     Screen.Settings.Mode = SpaceModeDefault;
 
     DEBUG("Creating screen info for display ID: " << DisplayIndex << " Resolution: " << Screen.Width << "x" << Screen.Height << " Origin: (" << Screen.X << "," << Screen.Y << ")");
@@ -159,6 +160,13 @@ screen_info CreateDefaultScreenInfo(int DisplayIndex, int ScreenIndex)
     return Screen;
 }
 
+screen_info CreateDefaultScreenInfo(int DisplayIndex, int ScreenIndex)
+{
+    screen_info Screen = CreateScreenInfo(DisplayIndex, ScreenIndex);
+    Screen.Settings.Offset = KWMScreen.DefaultOffset;
+    return Screen;
+}
+
 void UpdateExistingScreenInfo(screen_info *Screen, int DisplayIndex, int ScreenIndex)
 {
     CGRect DisplayRect = CGDisplayBounds(DisplayIndex);
@@ -183,14 +191,33 @@ CFStringRef GetDisplayIdentifier(int DisplayID)
     return Identifier;
 }
 
-void GetActiveDisplays()
+/* EnumerateActiveDisplays runs on its own thread while the config is executed,
+ * so it only writes to the list it is given and never to KWMScreen. The list is
+ * published by GetActiveDisplays after the join, which also applies the default
+ * offset set by the config. */
+void EnumerateActiveDisplays(display_list *List)
 {
+    unsigned int ActiveCount = 0;
+    List->Displays.resize(KWMScreen.MaxCount);
+    CGGetActiveDisplayList(List->Displays.size(), &List->Displays[0], &ActiveCount);
+    List->Displays.resize(ActiveCount);
+    for(std::size_t DisplayIndex = 0; DisplayIndex < ActiveCount; ++DisplayIndex)
+        List->Screens.push_back(CreateScreenInfo(List->Displays[DisplayIndex], DisplayIndex));
+}
+
+void GetActiveDisplays(display_list *List)
+{
+    if(KWMScreen.Displays)
+        free(KWMScreen.Displays);
+
     KWMScreen.Displays = (CGDirectDisplayID*) malloc(sizeof(CGDirectDisplayID) * KWMScreen.MaxCount);
-    CGGetActiveDisplayList(KWMScreen.MaxCount, KWMScreen.Displays, &KWMScreen.ActiveCount);
-    for(std::size_t DisplayIndex = 0; DisplayIndex < KWMScreen.ActiveCount; ++DisplayIndex)
+    KWMScreen.ActiveCount = List->Displays.size();
+    for(std::size_t DisplayIndex = 0; DisplayIndex < List->Screens.size(); ++DisplayIndex)
     {
-        unsigned int DisplayID = KWMScreen.Displays[DisplayIndex];
-        KWMTiling.DisplayMap[DisplayID] = CreateDefaultScreenInfo(DisplayID, DisplayIndex);;
+        unsigned int DisplayID = List->Displays[DisplayIndex];
+        KWMScreen.Displays[DisplayIndex] = DisplayID;
+        KWMTiling.DisplayMap[DisplayID] = List->Screens[DisplayIndex];
+        KWMTiling.DisplayMap[DisplayID].Settings.Offset = KWMScreen.DefaultOffset;
 
         DEBUG("DisplayID " << DisplayID << " has index " << DisplayIndex << " and Identifier " << CFStringGetCStringPtr(KWMTiling.DisplayMap[DisplayID].Identifier,kCFStringEncodingUTF8));
     }
@@ -423,6 +450,7 @@ void GiveFocusToScreen(unsigned int ScreenIndex, tree_node *FocusNode, bool Mous
 
         Screen->ActiveSpace = GetActiveSpaceOfDisplay(Screen);
         ShouldActiveSpaceBeManaged();
+        KwmBumpGeneration();
         space_info *Space = GetActiveSpaceOfScreen(Screen);
 
         DEBUG("GiveFocusToScreen() " << ScreenIndex << \
@@ -6,7 +6,8 @@
 extern int GetActiveSpaceOfDisplay(screen_info *Screen);
 
 void DisplayReconfigurationCallBack(CGDirectDisplayID Display, CGDisplayChangeSummaryFlags Flags, void *UserInfo);
-void GetActiveDisplays();
+void EnumerateActiveDisplays(display_list *List);
+void GetActiveDisplays(display_list *List);
 void RefreshActiveDisplays(bool shouldFocusScreen);
 
 int GetIndexOfNextScreen();
@@ -23,6 +24,7 @@ void GiveFocusToScreen(unsigned int ScreenIndex, tree_node *Focus, bool Mouse, b
 void UpdateActiveScreen();
 
 container_offset CreateDefaultScreenOffset();
+screen_info CreateScreenInfo(int DisplayIndex, int ScreenIndex);
 screen_info CreateDefaultScreenInfo(int DisplayIndex, int ScreenIndex);
 void UpdateExistingScreenInfo(screen_info *Screen, int DisplayIndex, int ScreenIndex);
 
@@ -3,38 +3,35 @@
 
 #include "types.h"
 
-#define ConvertStringTo_(name, type) \
-inline type \
-ConvertStringTo##name(std::string Value) \
-{ \
-    type Result = 0; \
-    std::stringstream Stream; \
-    Stream << Value; \
-    Stream >> Result; \
-    return Result; \
+/* These helpers sit on every command, config line and rule, so they work on the
+ * caller's string in place instead of going through a std::stringstream. */
+inline int
+ConvertStringToInt(const std::string &Value)
+{
+    return (int) strtol(Value.c_str(), NULL, 10);
 }
 
-ConvertStringTo_(Int, int);
-ConvertStringTo_(Double, double);
+inline double
+ConvertStringToDouble(const std::string &Value)
+{
+    return strtod(Value.c_str(), NULL);
+}
 
 inline unsigned int
-ConvertHexStringToInt(std::string HexString)
+ConvertHexStringToInt(const std::string &HexString)
 {
-    unsigned int HexResult = 0xffffff;
-    std::stringstream Stream;
-    Stream << std::hex << HexString;
-    Stream >> HexResult;
-    return HexResult;
+    return (unsigned int) strtoul(HexString.c_str(), NULL, 16);
 }
 
 inline bool
-IsPrefixOfString(std::string &Line, std::string Prefix)
+IsPrefixOfString(std::string &Line, const char *Prefix)
 {
+    std::size_t Length = strlen(Prefix);
     bool Result = false;
 
-    if(Line.substr(0, Prefix.size()) == Prefix)
+    if(Line.compare(0, Length, Prefix) == 0)
     {
-        Line = Line.substr(Prefix.size()+1);
+        Line.erase(0, Length + 1);
         Result = true;
     }
 
@@ -42,9 +39,14 @@ IsPrefixOfString(std::string &Line, std::string Prefix)
 }
 
 inline std::string
-CreateStringFromTokens(std::vector<std::string> Tokens, int StartIndex)
+CreateStringFromTokens(const std::vector<std::string> &Tokens, int StartIndex)
 {
-    std::string Text = "";
+    std::size_t Length = 0;
+    for(std::size_t TokenIndex = StartIndex; TokenIndex < Tokens.size(); ++TokenIndex)
+        Length += Tokens[TokenIndex].size() + 1;
+
+    std::string Text;
+    Text.reserve(Length);
     for(std::size_t TokenIndex = StartIndex; TokenIndex < Tokens.size(); ++TokenIndex)
     {
         Text += Tokens[TokenIndex];
@@ -55,15 +57,22 @@ CreateStringFromTokens(std::vector<std::string> Tokens, int StartIndex)
     return Text;
 }
 
+/* Same splitting rules as std::getline: empty fields between two delimiters are
+ * kept, a trailing delimiter does not produce an empty field. */
 inline std::vector<std::string>
-SplitString(std::string Line, char Delim)
+SplitString(const std::string &Line, char Delim)
 {
     std::vector<std::string> Elements;
-    std::stringstream Stream(Line);
-    std::string Temp;
+    std::size_t Start = 0;
+    while(Start < Line.size())
+    {
+        std::size_t End = Line.find(Delim, Start);
+        if(End == std::string::npos)
+            End = Line.size();
 
-    while(std::getline(Stream, Temp, Delim))
-        Elements.push_back(Temp);
+        Elements.push_back(Line.substr(Start, End - Start));
+        Start = End + 1;
+    }
 
     return Elements;
 }
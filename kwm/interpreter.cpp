@@ -14,6 +14,10 @@
 #include "serializer.h"
 #include "helpers.h"
 #include "rules.h"
+#include "json.h"
+#include "cache.h"
+#include "condition.h"
+#include "config.h"
 
 extern kwm_screen KWMScreen;
 extern kwm_toggles KWMToggles;
@@ -24,847 +28,1079 @@ extern kwm_border FocusedBorder;
 extern kwm_border MarkedBorder;
 extern kwm_border PrefixBorder;
 extern kwm_hotkeys KWMHotkeys;
+extern kwm_thread KWMThread;
 
 void MoveFocusedWindowToSpace(std::string SpaceID);
 void ActivateSpaceWithoutTransition(std::string SpaceID);
 
-void KwmConfigCommand(std::vector<std::string> &Tokens)
+kwm_command_table KwmCommandTable;
+
+int KwmGetDirectionDegrees(const std::string &Direction)
 {
-    if(Tokens[1] == "reload")
-    {
-        KwmReloadConfig();
-    }
-    else if(Tokens[1] == "spaces-key")
-    {
-        KwmSetSpacesKey(Tokens[2]);
-    }
-    else if(Tokens[1] == "optimal-ratio")
-    {
-        KWMTiling.OptimalRatio = ConvertStringToDouble(Tokens[2]);
-    }
-    else if(Tokens[1] == "prefix-key")
-    {
-        KwmSetPrefix(Tokens[2]);
-    }
-    else if(Tokens[1] == "prefix-global")
-    {
-        if(Tokens[2] == "off")
-            KwmSetPrefixGlobal(false);
-        else if(Tokens[2] == "on")
-            KwmSetPrefixGlobal(true);
-    }
-    else if(Tokens[1] == "prefix-timeout")
-    {
-        KwmSetPrefixTimeout(ConvertStringToDouble(Tokens[2]));
-    }
-    else if(Tokens[1] == "focused-border")
-    {
-        if(Tokens[2] == "on")
-        {
-            FocusedBorder.Enabled = true;
-            UpdateBorder("focused");
-        }
-        else if(Tokens[2] == "off")
-        {
-            FocusedBorder.Enabled = false;
-            UpdateBorder("focused");
-        }
-        else if(Tokens[2] == "size")
-        {
-            FocusedBorder.Width = ConvertStringToInt(Tokens[3]);
-        }
-        else if(Tokens[2] == "color")
-        {
-            FocusedBorder.Color = ConvertHexRGBAToColor(ConvertHexStringToInt(Tokens[3]));
-            CreateColorFormat(&FocusedBorder.Color);
-        }
-        else if(Tokens[2] == "radius")
-        {
-            FocusedBorder.Radius = ConvertStringToDouble(Tokens[3]);
-        }
-    }
-    else if(Tokens[1] == "marked-border")
-    {
-        if(Tokens[2] == "on")
-        {
-            MarkedBorder.Enabled = true;
-        }
-        else if(Tokens[2] == "off")
-        {
-            MarkedBorder.Enabled = false;
-            UpdateBorder("marked");
-        }
-        else if(Tokens[2] == "size")
-        {
-            MarkedBorder.Width = ConvertStringToInt(Tokens[3]);
-        }
-        else if(Tokens[2] == "color")
-        {
-            MarkedBorder.Color = ConvertHexRGBAToColor(ConvertHexStringToInt(Tokens[3]));
-            CreateColorFormat(&MarkedBorder.Color);
-        }
-        else if(Tokens[2] == "radius")
-        {
-            MarkedBorder.Radius = ConvertStringToDouble(Tokens[3]);
-        }
-    }
-    else if(Tokens[1] == "prefix-border")
-    {
-        if(Tokens[2] == "on")
-        {
-            PrefixBorder.Enabled = true;
-        }
-        else if(Tokens[2] == "off")
-        {
-            PrefixBorder.Enabled = false;
-            UpdateBorder("focused");
-        }
-        else if(Tokens[2] == "size")
-        {
-            PrefixBorder.Width = ConvertStringToInt(Tokens[3]);
-        }
-        else if(Tokens[2] == "color")
-        {
-            PrefixBorder.Color = ConvertHexRGBAToColor(ConvertHexStringToInt(Tokens[3]));
-            CreateColorFormat(&PrefixBorder.Color);
-        }
-        else if(Tokens[2] == "radius")
-        {
-            PrefixBorder.Radius = ConvertStringToDouble(Tokens[3]);
-        }
-    }
-    else if(Tokens[1] == "float-non-resizable")
+    if(Direction == "east")
+        return 90;
+    else if(Direction == "south")
+        return 180;
+    else if(Direction == "west")
+        return 270;
+
+    return 0;
+}
+
+bool KwmIsDirection(const std::string &Direction)
+{
+    return Direction == "north" || Direction == "east" ||
+           Direction == "south" || Direction == "west";
+}
+
+space_tiling_option KwmGetSpaceMode(const std::string &Mode)
+{
+    if(Mode == "bsp")
+        return SpaceModeBSP;
+    else if(Mode == "monocle")
+        return SpaceModeMonocle;
+
+    return SpaceModeFloating;
+}
+
+void KwmSetOffsetPadding(container_offset *Offset, std::vector<std::string> &Args, std::size_t Index)
+{
+    Offset->PaddingTop = ConvertStringToDouble(Args[Index]);
+    Offset->PaddingBottom = ConvertStringToDouble(Args[Index + 1]);
+    Offset->PaddingLeft = ConvertStringToDouble(Args[Index + 2]);
+    Offset->PaddingRight = ConvertStringToDouble(Args[Index + 3]);
+}
+
+void KwmSetOffsetGap(container_offset *Offset, std::vector<std::string> &Args, std::size_t Index)
+{
+    Offset->VerticalGap = ConvertStringToDouble(Args[Index]);
+    Offset->HorizontalGap = ConvertStringToDouble(Args[Index + 1]);
+}
+
+KWM_COMMAND_HANDLER(KwmQuitCommand)
+{
+    KwmQuit();
+}
+
+KWM_COMMAND_HANDLER(KwmToggleCommand)
+{
+    bool *Toggle = (bool *) Data;
+    *Toggle = Args[0] == "on";
+}
+
+KWM_COMMAND_HANDLER(KwmConfigReloadCommand)
+{
+    if(!Args.empty())
+        KwmBypassConfigCache();
+
+    std::string Report;
+    KwmReloadConfig(Report);
+    if(ClientSockFD)
+        KwmWriteToSocket(ClientSockFD, Report);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigSpacesKeyCommand)
+{
+    KwmSetSpacesKey(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigOptimalRatioCommand)
+{
+    KWMTiling.OptimalRatio = ConvertStringToDouble(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigPrefixKeyCommand)
+{
+    KwmSetPrefix(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigPrefixGlobalCommand)
+{
+    KwmSetPrefixGlobal(Args[0] == "on");
+}
+
+KWM_COMMAND_HANDLER(KwmConfigPrefixTimeoutCommand)
+{
+    KwmSetPrefixTimeout(ConvertStringToDouble(Args[0]));
+}
+
+KWM_COMMAND_HANDLER(KwmConfigSequenceTimeoutCommand)
+{
+    KwmSetSequenceTimeout(ConvertStringToDouble(Args[0]));
+}
+
+KWM_COMMAND_HANDLER(KwmConfigBorderCommand)
+{
+    kwm_border *Border = (kwm_border *) Data;
+    Border->Enabled = Args[0] == "on";
+
+    if(Border == &FocusedBorder)
+        UpdateBorder(BorderTypeFocused);
+    else if(Border == &MarkedBorder && !Border->Enabled)
+        UpdateBorder(BorderTypeMarked);
+    else if(Border == &PrefixBorder && !Border->Enabled)
+        UpdateBorder(BorderTypeFocused);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigBorderSizeCommand)
+{
+    kwm_border *Border = (kwm_border *) Data;
+    Border->Width = ConvertStringToInt(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigBorderColorCommand)
+{
+    kwm_border *Border = (kwm_border *) Data;
+    Border->Color = ConvertHexRGBAToColor(ConvertHexStringToInt(Args[0]));
+    CreateColorFormat(&Border->Color);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigBorderRadiusCommand)
+{
+    kwm_border *Border = (kwm_border *) Data;
+    Border->Radius = ConvertStringToDouble(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigSpawnCommand)
+{
+    KWMTiling.SpawnAsLeftChild = Args[0] == "left";
+}
+
+KWM_COMMAND_HANDLER(KwmConfigTilingCommand)
+{
+    if(Args[0] == "off")
     {
-        if(Tokens[2] == "off")
-            KWMTiling.FloatNonResizable = false;
-        else if(Tokens[2] == "on")
-            KWMTiling.FloatNonResizable = true;
+        KWMToggles.EnableTilingMode = false;
     }
-    else if(Tokens[1] == "lock-to-container")
+    else
     {
-        if(Tokens[2] == "off")
-            KWMTiling.LockToContainer = false;
-        else if(Tokens[2] == "on")
-            KWMTiling.LockToContainer = true;
+        KWMMode.Space = KwmGetSpaceMode(Args[0]);
+        KWMToggles.EnableTilingMode = true;
     }
-    else if(Tokens[1] == "spawn")
+
+    KwmEmitEvent(EventTypeMode);
+}
+
+space_settings *KwmGetSpaceSettingsCommandTarget(std::vector<std::string> &Args)
+{
+    int ScreenID = ConvertStringToInt(Args[0]);
+    int DesktopID = ConvertStringToInt(Args[1]);
+    space_settings *SpaceSettings = GetSpaceSettingsForDesktopID(ScreenID, DesktopID);
+    if(!SpaceSettings)
     {
-        if(Tokens[2] == "left")
-            KWMTiling.SpawnAsLeftChild = true;
-        else if(Tokens[2] == "right")
-            KWMTiling.SpawnAsLeftChild = false;
+        space_identifier Lookup = { ScreenID, DesktopID };
+        space_settings NULLSpaceSettings = { KWMScreen.DefaultOffset, SpaceModeDefault };
+
+        space_settings *ScreenSettings = GetSpaceSettingsForDisplay(ScreenID);
+        if(ScreenSettings)
+            NULLSpaceSettings = *ScreenSettings;
+
+        KWMTiling.SpaceSettings[Lookup] = NULLSpaceSettings;
+        SpaceSettings = &KWMTiling.SpaceSettings[Lookup];
     }
-    else if(Tokens[1] == "tiling")
+
+    return SpaceSettings;
+}
+
+space_settings *KwmGetDisplaySettingsCommandTarget(std::vector<std::string> &Args)
+{
+    int ScreenID = ConvertStringToInt(Args[0]);
+    space_settings *DisplaySettings = GetSpaceSettingsForDisplay(ScreenID);
+    if(!DisplaySettings)
     {
-        if(Tokens[2] == "off")
-            KWMToggles.EnableTilingMode = false;
-        else if(Tokens[2] == "bsp")
-        {
-            KWMMode.Space = SpaceModeBSP;
-            KWMToggles.EnableTilingMode = true;
-        }
-        else if(Tokens[2] == "monocle")
-        {
-            KWMMode.Space = SpaceModeMonocle;
-            KWMToggles.EnableTilingMode = true;
-        }
-        else if(Tokens[2] == "float")
-        {
-            KWMMode.Space = SpaceModeFloating;
-            KWMToggles.EnableTilingMode = true;
-        }
+        space_settings NULLSpaceSettings = { KWMScreen.DefaultOffset, SpaceModeDefault };
+        KWMTiling.DisplaySettings[ScreenID] = NULLSpaceSettings;
+        DisplaySettings = &KWMTiling.DisplaySettings[ScreenID];
     }
-    else if(Tokens[1] == "space")
-    {
-        int ScreenID = ConvertStringToInt(Tokens[2]);
-        int DesktopID = ConvertStringToInt(Tokens[3]);
-        space_settings *SpaceSettings = GetSpaceSettingsForDesktopID(ScreenID, DesktopID);
-        if(!SpaceSettings)
-        {
-            space_identifier Lookup = { ScreenID, DesktopID };
-            space_settings NULLSpaceSettings = { KWMScreen.DefaultOffset, SpaceModeDefault };
 
-            space_settings *ScreenSettings = GetSpaceSettingsForDisplay(ScreenID);
-            if(ScreenSettings)
-                NULLSpaceSettings = *ScreenSettings;
+    return DisplaySettings;
+}
 
-            KWMTiling.SpaceSettings[Lookup] = NULLSpaceSettings;
-            SpaceSettings = &KWMTiling.SpaceSettings[Lookup];
-        }
+KWM_COMMAND_HANDLER(KwmConfigSpaceModeCommand)
+{
+    KwmGetSpaceSettingsCommandTarget(Args)->Mode = KwmGetSpaceMode(Args[3]);
+}
 
-        if(Tokens[4] == "mode")
-        {
-            if(Tokens[5] == "bsp")
-                SpaceSettings->Mode = SpaceModeBSP;
-            else if(Tokens[5] == "monocle")
-                SpaceSettings->Mode = SpaceModeMonocle;
-            else if(Tokens[5] == "float")
-                SpaceSettings->Mode = SpaceModeFloating;
-        }
-        else if(Tokens[4] == "padding")
-        {
-            SpaceSettings->Offset.PaddingTop = ConvertStringToDouble(Tokens[5]);
-            SpaceSettings->Offset.PaddingBottom = ConvertStringToDouble(Tokens[6]);
-            SpaceSettings->Offset.PaddingLeft = ConvertStringToDouble(Tokens[7]);
-            SpaceSettings->Offset.PaddingRight = ConvertStringToDouble(Tokens[8]);
-        }
-        else if(Tokens[4] == "gap")
-        {
-            SpaceSettings->Offset.VerticalGap = ConvertStringToDouble(Tokens[5]);
-            SpaceSettings->Offset.HorizontalGap = ConvertStringToDouble(Tokens[6]);
-        }
-    }
-    else if(Tokens[1] == "display")
-    {
-        int ScreenID = ConvertStringToInt(Tokens[2]);
-        space_settings *DisplaySettings = GetSpaceSettingsForDisplay(ScreenID);
-        if(!DisplaySettings)
-        {
-            space_settings NULLSpaceSettings = { KWMScreen.DefaultOffset, SpaceModeDefault };
-            KWMTiling.DisplaySettings[ScreenID] = NULLSpaceSettings;
-            DisplaySettings = &KWMTiling.DisplaySettings[ScreenID];
-        }
+KWM_COMMAND_HANDLER(KwmConfigSpacePaddingCommand)
+{
+    KwmSetOffsetPadding(&KwmGetSpaceSettingsCommandTarget(Args)->Offset, Args, 3);
+}
 
-        if(Tokens[3] == "mode")
-        {
-            if(Tokens[4] == "bsp")
-                DisplaySettings->Mode = SpaceModeBSP;
-            else if(Tokens[4] == "monocle")
-                DisplaySettings->Mode = SpaceModeMonocle;
-            else if(Tokens[4] == "float")
-                DisplaySettings->Mode = SpaceModeFloating;
-        }
-        else if(Tokens[3] == "padding")
-        {
-            DisplaySettings->Offset.PaddingTop = ConvertStringToDouble(Tokens[4]);
-            DisplaySettings->Offset.PaddingBottom = ConvertStringToDouble(Tokens[5]);
-            DisplaySettings->Offset.PaddingLeft = ConvertStringToDouble(Tokens[6]);
-            DisplaySettings->Offset.PaddingRight = ConvertStringToDouble(Tokens[7]);
-        }
-        else if(Tokens[3] == "gap")
-        {
-            DisplaySettings->Offset.VerticalGap = ConvertStringToDouble(Tokens[4]);
-            DisplaySettings->Offset.HorizontalGap = ConvertStringToDouble(Tokens[5]);
-        }
-    }
-    else if(Tokens[1] == "focus-follows-mouse")
+KWM_COMMAND_HANDLER(KwmConfigSpaceGapCommand)
+{
+    KwmSetOffsetGap(&KwmGetSpaceSettingsCommandTarget(Args)->Offset, Args, 3);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigDisplayModeCommand)
+{
+    KwmGetDisplaySettingsCommandTarget(Args)->Mode = KwmGetSpaceMode(Args[2]);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigDisplayPaddingCommand)
+{
+    KwmSetOffsetPadding(&KwmGetDisplaySettingsCommandTarget(Args)->Offset, Args, 2);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigDisplayGapCommand)
+{
+    KwmSetOffsetGap(&KwmGetDisplaySettingsCommandTarget(Args)->Offset, Args, 2);
+}
+
+KWM_COMMAND_HANDLER(KwmConfigFocusFollowsMouseCommand)
+{
+    if(Args[0] == "toggle")
     {
-        if(Tokens[2] == "toggle")
-        {
-            if(KWMMode.Focus == FocusModeDisabled)
-                KWMMode.Focus = FocusModeAutofocus;
-            else if(KWMMode.Focus == FocusModeAutofocus)
-                KWMMode.Focus = FocusModeAutoraise;
-            else if(KWMMode.Focus == FocusModeAutoraise)
-                KWMMode.Focus = FocusModeDisabled;
-        }
-        else if(Tokens[2] == "autofocus")
+        if(KWMMode.Focus == FocusModeDisabled)
             KWMMode.Focus = FocusModeAutofocus;
-        else if(Tokens[2] == "autoraise")
+        else if(KWMMode.Focus == FocusModeAutofocus)
             KWMMode.Focus = FocusModeAutoraise;
-        else if(Tokens[2] == "off")
+        else if(KWMMode.Focus == FocusModeAutoraise)
             KWMMode.Focus = FocusModeDisabled;
     }
-    else if(Tokens[1] == "mouse-follows-focus")
-    {
-        if(Tokens[2] == "off")
-            KWMToggles.UseMouseFollowsFocus = false;
-        else if(Tokens[2] == "on")
-            KWMToggles.UseMouseFollowsFocus = true;
-    }
-    else if(Tokens[1] == "standby-on-float")
-    {
-        if(Tokens[2] == "off")
-            KWMToggles.StandbyOnFloat = false;
-        else if(Tokens[2] == "on")
-            KWMToggles.StandbyOnFloat = true;
-    }
-    else if(Tokens[1] == "cycle-focus")
-    {
-        if(Tokens[2] == "screen")
-            KWMMode.Cycle = CycleModeScreen;
-        else if(Tokens[2] == "off")
-            KWMMode.Cycle = CycleModeDisabled;;
-    }
-    else if(Tokens[1] == "hotkeys")
-    {
-        if(Tokens[2] == "off")
-            KWMToggles.UseBuiltinHotkeys = false;
-        else if(Tokens[2] == "on")
-            KWMToggles.UseBuiltinHotkeys = true;
-    }
-    else if(Tokens[1] == "add-role")
-    {
-        AllowRoleForApplication(CreateStringFromTokens(Tokens, 3), Tokens[2]);
-    }
-    else if(Tokens[1] == "padding")
-    {
-        container_offset Offset = { ConvertStringToDouble(Tokens[2]),
-                                    ConvertStringToDouble(Tokens[3]),
-                                    ConvertStringToDouble(Tokens[4]),
-                                    ConvertStringToDouble(Tokens[5]),
-                                    0,
-                                    0
-                                  };
-
-        SetDefaultPaddingOfDisplay(Offset);
-    }
-    else if(Tokens[1] == "gap")
-    {
-        container_offset Offset = { 0,
-                                    0,
-                                    0,
-                                    0,
-                                    ConvertStringToDouble(Tokens[2]),
-                                    ConvertStringToDouble(Tokens[3])
-                                  };
-
-        SetDefaultGapOfDisplay(Offset);
-    }
-    else if(Tokens[1] == "split-ratio")
-    {
-        ChangeSplitRatio(ConvertStringToDouble(Tokens[2]));
-    }
+    else if(Args[0] == "autofocus")
+        KWMMode.Focus = FocusModeAutofocus;
+    else if(Args[0] == "autoraise")
+        KWMMode.Focus = FocusModeAutoraise;
+    else if(Args[0] == "off")
+        KWMMode.Focus = FocusModeDisabled;
 }
 
-void KwmQueryCommand(std::vector<std::string> &Tokens, int ClientSockFD)
+KWM_COMMAND_HANDLER(KwmConfigCycleFocusCommand)
 {
-    if(Tokens[1] == "focused")
-    {
-        std::string Output;
-        GetTagForCurrentSpace(Output);
+    KWMMode.Cycle = Args[0] == "screen" ? CycleModeScreen : CycleModeDisabled;
+}
 
-        if(KWMFocus.Window)
-            Output += " " + KWMFocus.Window->Owner + (KWMFocus.Window->Name.empty() ? "" : " - " + KWMFocus.Window->Name);
+KWM_COMMAND_HANDLER(KwmConfigAddRoleCommand)
+{
+    AllowRoleForApplication(CreateStringFromTokens(Args, 1), Args[0]);
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "current")
-    {
-        std::string Output = KWMFocus.Window ? std::to_string(KWMFocus.Window->WID) : "-1";
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "marked")
-    {
-        std::string Output = std::to_string(KWMScreen.MarkedWindow);;
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "tag")
-    {
-        std::string Output;
-        GetTagForCurrentSpace(Output);
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "spawn")
-    {
-        std::string Output = KWMTiling.SpawnAsLeftChild ? "left" : "right";
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "prefix")
-    {
-        std::string Output = KWMHotkeys.Prefix.Active ? "active" : "inactive";
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "split-ratio")
-    {
-        std::string Output = std::to_string(KWMScreen.SplitRatio);
-        Output.erase(Output.find_last_not_of('0') + 1, std::string::npos);
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "split-mode")
-    {
-        std::string Output;
-        if(Tokens[2] == "global")
-        {
-            if(KWMScreen.SplitMode == SPLIT_OPTIMAL)
-                Output = "Optimal";
-            else if(KWMScreen.SplitMode == SPLIT_VERTICAL)
-                Output = "Vertical";
-            else if(KWMScreen.SplitMode == SPLIT_HORIZONTAL)
-                Output = "Horizontal";
-        }
-        else
-        {
-            if(DoesSpaceExistInMapOfScreen(KWMScreen.Current))
-            {
-                int WindowID = ConvertStringToInt(Tokens[2]);
-                space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
-                tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, WindowID);
-                if(Node)
-                {
-                    if(Node->SplitMode == SPLIT_VERTICAL)
-                        Output = "Vertical";
-                    else if(Node->SplitMode == SPLIT_HORIZONTAL)
-                        Output = "Horizontal";
-                }
-            }
-        }
+KWM_COMMAND_HANDLER(KwmConfigPaddingCommand)
+{
+    container_offset Offset = {};
+    KwmSetOffsetPadding(&Offset, Args, 0);
+    SetDefaultPaddingOfDisplay(Offset);
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "focus")
-    {
-        std::string Output;
-        if(KWMMode.Focus == FocusModeAutofocus)
-            Output = "autofocus";
-        else if(KWMMode.Focus == FocusModeAutoraise)
-            Output = "autoraise";
-        else if(KWMMode.Focus == FocusModeDisabled)
-            Output = "off";
+KWM_COMMAND_HANDLER(KwmConfigGapCommand)
+{
+    container_offset Offset = {};
+    KwmSetOffsetGap(&Offset, Args, 0);
+    SetDefaultGapOfDisplay(Offset);
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "mouse-follows")
-    {
-        std::string Output;
-        if(KWMToggles.UseMouseFollowsFocus)
-            Output = "on";
-        else
-            Output = "off";
+KWM_COMMAND_HANDLER(KwmConfigSplitRatioCommand)
+{
+    ChangeSplitRatio(ConvertStringToDouble(Args[0]));
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "space")
-    {
-        std::string Output;
-        if(KWMMode.Space == SpaceModeBSP)
-            Output = "bsp";
-        else if(KWMMode.Space == SpaceModeMonocle)
-            Output = "monocle";
-        else
-            Output = "float";
+KWM_QUERY_HANDLER(KwmQueryFocusedCommand)
+{
+    GetTagForCurrentSpace(Output);
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "cycle-focus")
-    {
-        std::string Output;
-        if(KWMMode.Cycle == CycleModeScreen)
-            Output = "screen";
-        else
-            Output = "off";
+    if(KWMFocus.Window)
+        Output += " " + KWMFocus.Window->Owner + (KWMFocus.Window->Name.empty() ? "" : " - " + KWMFocus.Window->Name);
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "border")
-    {
-        std::string Output = "0";
-        if(Tokens[2] == "focused")
-            Output = FocusedBorder.Enabled ? "1" : "0";
-        else if(Tokens[2] == "marked")
-            Output = MarkedBorder.Enabled ? "1" : "0";
-        else if(Tokens[2] == "prefix")
-            Output = PrefixBorder.Enabled ? "1" : "0";
+KWM_QUERY_HANDLER(KwmQueryCurrentCommand)
+{
+    Output = KWMFocus.Window ? std::to_string(KWMFocus.Window->WID) : "-1";
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "dir")
-    {
-        window_info Window = {};
-        std::string Output = "-1";
-        int Degrees = 0;
-
-        if(Tokens[2] == "north")
-            Degrees = 0;
-        else if(Tokens[2] == "east")
-            Degrees = 90;
-        else if(Tokens[2] == "south")
-            Degrees = 180;
-        else if(Tokens[2] == "west")
-            Degrees = 270;
-
-        bool Wrap = Tokens[3] == "wrap" ? true : false;
-        if(FindClosestWindow(Degrees, &Window, Wrap))
-            Output = std::to_string(Window.WID);
+KWM_QUERY_HANDLER(KwmQueryMarkedCommand)
+{
+    Output = std::to_string(KWMScreen.MarkedWindow);
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "parent")
-    {
-        std::string Output = "0";
-        if(DoesSpaceExistInMapOfScreen(KWMScreen.Current) && KWMFocus.Window)
-        {
-            int WindowID = ConvertStringToInt(Tokens[2]);
-            space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
-            tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, WindowID);
-            tree_node *FocusedNode = GetTreeNodeFromWindowID(Space->RootNode, KWMFocus.Window->WID);
+KWM_QUERY_HANDLER(KwmQueryTagCommand)
+{
+    GetTagForCurrentSpace(Output);
+}
 
-            if(Node && FocusedNode)
-                Output = FocusedNode->Parent == Node->Parent ? "1" : "0";
-        }
+KWM_QUERY_HANDLER(KwmQuerySpawnCommand)
+{
+    Output = KWMTiling.SpawnAsLeftChild ? "left" : "right";
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
-    else if(Tokens[1] == "child")
-    {
-        std::string Output;
-        if(DoesSpaceExistInMapOfScreen(KWMScreen.Current) && KWMFocus.Window)
-        {
-            int WindowID = ConvertStringToInt(Tokens[2]);
-            space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
-            tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, WindowID);
+KWM_QUERY_HANDLER(KwmQueryPrefixCommand)
+{
+    Output = KWMHotkeys.Prefix.Active ? "active" : "inactive";
+}
 
-            if(Node)
-                Output = IsLeftChild(Node) ? "left" : "right";
-        }
+KWM_QUERY_HANDLER(KwmQuerySplitRatioCommand)
+{
+    Output = std::to_string(KWMScreen.SplitRatio);
+    Output.erase(Output.find_last_not_of('0') + 1, std::string::npos);
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
+KWM_QUERY_HANDLER(KwmQuerySplitModeCommand)
+{
+    if(Args[0] == "global")
+    {
+        if(KWMScreen.SplitMode == SPLIT_OPTIMAL)
+            Output = "Optimal";
+        else if(KWMScreen.SplitMode == SPLIT_VERTICAL)
+            Output = "Vertical";
+        else if(KWMScreen.SplitMode == SPLIT_HORIZONTAL)
+            Output = "Horizontal";
     }
-    else if(Tokens[1] == "windows")
+    else if(DoesSpaceExistInMapOfScreen(KWMScreen.Current))
     {
-        std::string Output;
-        std::vector<window_info> Windows = FilterWindowListAllDisplays();
-        for(int Index = 0; Index < Windows.size(); ++Index)
+        int WindowID = ConvertStringToInt(Args[0]);
+        space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
+        tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, WindowID);
+        if(Node)
         {
-            Output += std::to_string(Windows[Index].WID) + ", " + Windows[Index].Owner + ", " + Windows[Index].Name;
-            if(Index < Windows.size() - 1)
-                Output += "\n";
+            if(Node->SplitMode == SPLIT_VERTICAL)
+                Output = "Vertical";
+            else if(Node->SplitMode == SPLIT_HORIZONTAL)
+                Output = "Horizontal";
         }
-
-        KwmWriteToSocket(ClientSockFD, Output);
     }
-    else if(Tokens[1] == "prev-space")
-    {
-        std::string Output = "-1";
-        if(KWMScreen.Current && !KWMScreen.Current->History.empty())
-            Output = std::to_string(GetSpaceNumberFromCGSpaceID(KWMScreen.Current, KWMScreen.Current->History.top()));
+}
 
-        KwmWriteToSocket(ClientSockFD, Output);
-    }
+KWM_QUERY_HANDLER(KwmQueryFocusCommand)
+{
+    if(KWMMode.Focus == FocusModeAutofocus)
+        Output = "autofocus";
+    else if(KWMMode.Focus == FocusModeAutoraise)
+        Output = "autoraise";
+    else if(KWMMode.Focus == FocusModeDisabled)
+        Output = "off";
+}
+
+KWM_QUERY_HANDLER(KwmQueryMouseFollowsCommand)
+{
+    Output = KWMToggles.UseMouseFollowsFocus ? "on" : "off";
 }
 
-void KwmBindCommand(std::vector<std::string> &Tokens, bool Passthrough)
+KWM_QUERY_HANDLER(KwmQuerySpaceCommand)
 {
-    if(Tokens.size() > 2)
-        KwmAddHotkey(Tokens[1], CreateStringFromTokens(Tokens, 2), Passthrough);
+    if(KWMMode.Space == SpaceModeBSP)
+        Output = "bsp";
+    else if(KWMMode.Space == SpaceModeMonocle)
+        Output = "monocle";
     else
-        KwmAddHotkey(Tokens[1], "", Passthrough);
+        Output = "float";
 }
 
-void KwmWindowCommand(std::vector<std::string> &Tokens)
+KWM_QUERY_HANDLER(KwmQueryCycleFocusCommand)
 {
-    if(Tokens[1] == "-f")
-    {
-        if(Tokens[2] == "north")
-            ShiftWindowFocusDirected(0);
-        else if(Tokens[2] == "east")
-            ShiftWindowFocusDirected(90);
-        else if(Tokens[2] == "south")
-            ShiftWindowFocusDirected(180);
-        else if(Tokens[2] == "west")
-            ShiftWindowFocusDirected(270);
-        else if(Tokens[2] == "prev")
-            ShiftWindowFocus(-1);
-        else if(Tokens[2] == "next")
-            ShiftWindowFocus(1);
-        else if(Tokens[2] == "curr")
-            FocusWindowBelowCursor();
-        else
-            FocusWindowByID(ConvertStringToInt(Tokens[2]));
-    }
-    else if(Tokens[1] == "-fm")
-    {
-        if(Tokens[2] == "prev")
-            ShiftSubTreeWindowFocus(-1);
-        else if(Tokens[2] == "next")
-            ShiftSubTreeWindowFocus(1);
-    }
-    else if(Tokens[1] == "-s")
-    {
-        if(Tokens[2] == "north")
-            SwapFocusedWindowDirected(0);
-        else if(Tokens[2] == "east")
-            SwapFocusedWindowDirected(90);
-        else if(Tokens[2] == "south")
-            SwapFocusedWindowDirected(180);
-        else if(Tokens[2] == "west")
-            SwapFocusedWindowDirected(270);
-        else if(Tokens[2] == "prev")
-            SwapFocusedWindowWithNearest(-1);
-        else if(Tokens[2] == "next")
-            SwapFocusedWindowWithNearest(1);
-        else if(Tokens[2] == "mark")
-            SwapFocusedWindowWithMarked();
-    }
-    else if(Tokens[1] == "-z")
+    Output = KWMMode.Cycle == CycleModeScreen ? "screen" : "off";
+}
+
+KWM_QUERY_HANDLER(KwmQueryBorderCommand)
+{
+    if(Args[0] == "focused")
+        Output = FocusedBorder.Enabled ? "1" : "0";
+    else if(Args[0] == "marked")
+        Output = MarkedBorder.Enabled ? "1" : "0";
+    else if(Args[0] == "prefix")
+        Output = PrefixBorder.Enabled ? "1" : "0";
+}
+
+KWM_QUERY_HANDLER(KwmQueryDirCommand)
+{
+    window_info *Window = NULL;
+    Output = "-1";
+
+    bool Wrap = Args.size() > 1 && Args[1] == "wrap";
+    if(FindClosestWindow(KwmGetDirectionDegrees(Args[0]), &Window, Wrap))
+        Output = std::to_string(Window->WID);
+}
+
+KWM_QUERY_HANDLER(KwmQueryParentCommand)
+{
+    Output = "0";
+    if(DoesSpaceExistInMapOfScreen(KWMScreen.Current) && KWMFocus.Window)
     {
-        if(Tokens[2] == "fullscreen")
-            ToggleFocusedWindowFullscreen();
-        else if(Tokens[2] == "parent")
-            ToggleFocusedWindowParentContainer();
+        int WindowID = ConvertStringToInt(Args[0]);
+        space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
+        tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, WindowID);
+        tree_node *FocusedNode = GetTreeNodeFromWindowID(Space->RootNode, KWMFocus.Window->WID);
+
+        if(Node && FocusedNode)
+            Output = FocusedNode->Parent == Node->Parent ? "1" : "0";
     }
-    else if(Tokens[1] == "-t")
+}
+
+KWM_QUERY_HANDLER(KwmQueryChildCommand)
+{
+    if(DoesSpaceExistInMapOfScreen(KWMScreen.Current) && KWMFocus.Window)
     {
-        if(Tokens[2] == "focused")
-            ToggleFocusedWindowFloating();
+        int WindowID = ConvertStringToInt(Args[0]);
+        space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
+        tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, WindowID);
+
+        if(Node)
+            Output = IsLeftChild(Node) ? "left" : "right";
     }
-    else if(Tokens[1] == "-r")
+}
+
+KWM_QUERY_HANDLER(KwmQueryWindowsCommand)
+{
+    std::vector<window_info> Windows = FilterWindowListAllDisplays();
+    for(int Index = 0; Index < Windows.size(); ++Index)
     {
-        if(Tokens[2] == "focused")
-            ResizeWindowToContainerSize();
+        Output += std::to_string(Windows[Index].WID) + ", " + Windows[Index].Owner + ", " + Windows[Index].Name;
+        if(Index < Windows.size() - 1)
+            Output += "\n";
     }
-    else if(Tokens[1] == "-c")
+}
+
+KWM_QUERY_HANDLER(KwmQueryPrevSpaceCommand)
+{
+    Output = "-1";
+    if(KWMScreen.Current && !KWMScreen.Current->History.empty())
+        Output = std::to_string(GetSpaceNumberFromCGSpaceID(KWMScreen.Current, KWMScreen.Current->History.top()));
+}
+
+/* The dump can be large and changes with every window event, so it is not kept
+ * in the query response cache. It is serialized in memory while KWMThread.Lock is
+ * held and only written to the client after the lock is released, so a client that
+ * reads slowly never holds up the threads that wait for the lock. */
+KWM_COMMAND_HANDLER(KwmQueryStateCommand)
+{
+    if(!ClientSockFD)
+        return;
+
+    bool Json = false, Displays = false, Windows = false, Focus = false, Settings = false;
+    for(std::size_t ArgIndex = 0; ArgIndex < Args.size(); ++ArgIndex)
     {
-        if(Tokens[2] == "split-mode")
-        {
-            if(Tokens[3] == "toggle")
-            {
-                space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
-                tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, KWMFocus.Window->WID);
-
-                if(Node)
-                    ToggleNodeSplitMode(KWMScreen.Current, Node->Parent);
-            }
-        }
-        else if(Tokens[2] == "type")
-        {
-            if(Tokens[3] == "monocle")
-                ChangeTypeOfFocusedNode(NodeTypeLink);
-            else if(Tokens[3] == "bsp")
-                ChangeTypeOfFocusedNode(NodeTypeTree);
-            else if(Tokens[3] == "toggle")
-                ToggleTypeOfFocusedNode();
-        }
-        else if(Tokens[2] == "reduce" || Tokens[2] == "expand")
+        if(Args[ArgIndex] == "--json")
+            Json = true;
+        else if(Args[ArgIndex] == "displays")
+            Displays = true;
+        else if(Args[ArgIndex] == "windows")
+            Windows = true;
+        else if(Args[ArgIndex] == "focus")
+            Focus = true;
+        else if(Args[ArgIndex] == "settings")
+            Settings = true;
+        else
         {
-            double Ratio = ConvertStringToDouble(Tokens[3]);
-            Ratio = Tokens[2] == "reduce" ? -Ratio : Ratio;
-
-            if(Tokens.size() == 5)
-            {
-                if(Tokens[4] == "north")
-                    ModifyContainerSplitRatio(Ratio, 0);
-                else if(Tokens[4] == "east")
-                    ModifyContainerSplitRatio(Ratio, 90);
-                else if(Tokens[4] == "south")
-                    ModifyContainerSplitRatio(Ratio, 180);
-                else if(Tokens[4] == "west")
-                    ModifyContainerSplitRatio(Ratio, 270);
-            }
-            else
-            {
-                ModifyContainerSplitRatio(Ratio);
-            }
+            KwmWriteToSocket(ClientSockFD, "error: invalid argument '" + Args[ArgIndex] + "', expected 'displays|windows|focus|settings'");
+            return;
         }
     }
-    else if(Tokens[1] == "-m")
+
+    if(!Json)
     {
-        if(!KWMFocus.Window)
-            return;
+        KwmWriteToSocket(ClientSockFD, "error: missing argument '--json'");
+        return;
+    }
 
-        if(Tokens[2] == "space")
-        {
-            if(Tokens[3] == "previous")
-                GoToPreviousSpace(true);
-            else
-                MoveFocusedWindowToSpace(Tokens[3]);
-        }
-        else if(Tokens[2] == "display")
-        {
-            if(Tokens[3] == "prev")
-                MoveWindowToDisplay(KWMFocus.Window, -1, true);
-            else if(Tokens[3] == "next")
-                MoveWindowToDisplay(KWMFocus.Window, 1, true);
-            else
-                MoveWindowToDisplay(KWMFocus.Window, ConvertStringToInt(Tokens[3]), false);
-        }
-        else if(Tokens[2] == "north")
-        {
-            DetachAndReinsertWindow(KWMFocus.Window->WID, 0);
-        }
-        else if(Tokens[2] == "east")
+    if(!Displays && !Windows && !Focus && !Settings)
+        Displays = Windows = Focus = Settings = true;
+
+    std::string Output;
+    json_writer Writer;
+    JsonBeginWriter(&Writer, &Output);
+
+    pthread_mutex_lock(&KWMThread.Lock);
+    JsonBeginObject(&Writer, NULL);
+    if(Focus)
+        SerializeFocusToJson(&Writer);
+    if(Settings)
+        SerializeSettingsToJson(&Writer);
+    if(Displays)
+        SerializeDisplaysToJson(&Writer);
+    if(Windows)
+        SerializeWindowsToJson(&Writer);
+    JsonEndObject(&Writer);
+    JsonEndWriter(&Writer);
+    pthread_mutex_unlock(&KWMThread.Lock);
+
+    KwmWriteToSocket(ClientSockFD, Output);
+}
+
+KWM_QUERY_HANDLER(KwmQueryBindingsCommand)
+{
+    for(std::size_t HotkeyIndex = 0; HotkeyIndex < KWMHotkeys.List.size(); ++HotkeyIndex)
+    {
+        hotkey *Hotkey = &KWMHotkeys.List[HotkeyIndex];
+        if(!Output.empty())
+            Output += "\n";
+
+        Output += Hotkey->KeySym;
+        if(Hotkey->Passthrough)
+            Output += " passthrough";
+
+        if(Hotkey->State != HotkeyStateNone)
         {
-            DetachAndReinsertWindow(KWMFocus.Window->WID, 90);
+            Output += Hotkey->State == HotkeyStateInclude ? " include {" : " exclude {";
+            Output += CreateStringFromTokens(Hotkey->List, 0) + "}";
         }
-        else if(Tokens[2] == "south")
+
+        if(Hotkey->IsSystemCommand)
         {
-            DetachAndReinsertWindow(KWMFocus.Window->WID, 180);
+            Output += " -> sys [" + Hotkey->Command + "]";
         }
-        else if(Tokens[2] == "west")
+        else if(!Hotkey->Conditions.empty())
         {
-            DetachAndReinsertWindow(KWMFocus.Window->WID, 270);
+            Output += " -> ";
+            KwmCreateConditionsString(Hotkey->Conditions, Output);
         }
-        else if(Tokens[2] == "mark")
+        else if(Hotkey->Compiled)
         {
-            DetachAndReinsertWindow(KWMScreen.MarkedWindow, 0);
+            Output += std::string(" -> ") + Hotkey->Compiled->Path + " [";
+            for(std::size_t ArgIndex = 0; ArgIndex < Hotkey->Args.size(); ++ArgIndex)
+                Output += (ArgIndex ? ", " : "") + Hotkey->Args[ArgIndex];
+            Output += "]";
         }
         else
         {
-            int XOff = ConvertStringToInt(Tokens[2]);
-            int YOff = ConvertStringToInt(Tokens[3]);
-            MoveFloatingWindow(XOff, YOff);
+            Output += " -> none";
         }
     }
-    else if(Tokens[1] == "-mk")
-    {
-        if(Tokens[2] == "focused")
-        {
-            MarkFocusedWindowContainer();
-            return;
-        }
+}
 
-        window_info Window = {};
-        std::string Output = "-1";
-        int Degrees = 0;
-
-        if(Tokens[2] == "north")
-            Degrees = 0;
-        else if(Tokens[2] == "east")
-            Degrees = 90;
-        else if(Tokens[2] == "south")
-            Degrees = 180;
-        else if(Tokens[2] == "west")
-            Degrees = 270;
-
-        bool Wrap = Tokens[3] == "wrap" ? true : false;
-        if(FindClosestWindow(Degrees, &Window, Wrap))
-            MarkWindowContainer(&Window);
+KWM_COMMAND_HANDLER(KwmIfCommand)
+{
+    std::string Error;
+    std::vector<kwm_condition> Conditions;
+    if(KwmCompileConditions("if " + CreateStringFromTokens(Args, 0), Conditions, Error))
+    {
+        KwmExecuteConditions(Conditions, ClientSockFD);
+    }
+    else
+    {
+        DEBUG("KwmIfCommand() " << Error);
+        if(ClientSockFD)
+            KwmWriteToSocket(ClientSockFD, Error);
     }
 }
 
-void KwmSpaceCommand(std::vector<std::string> &Tokens)
+KWM_COMMAND_HANDLER(KwmQueryCacheCommand)
 {
-    if(Tokens[1] == "-f")
+    if(ClientSockFD)
     {
-        if(Tokens[2] == "previous")
-            GoToPreviousSpace(false);
+        if(!Args.empty() && Args[0] == "commands")
+            KwmWriteToSocket(ClientSockFD, KwmGetCommandCacheStats());
+        else if(!Args.empty() && Args[0] == "config")
+            KwmWriteToSocket(ClientSockFD, KwmGetConfigCacheStats());
+        else if(!Args.empty() && Args[0] == "rules")
+            KwmWriteToSocket(ClientSockFD, KwmGetRuleCacheStats());
         else
-            KwmEmitKeystroke(KWMHotkeys.SpacesKey, Tokens[2]);
+            KwmWriteToSocket(ClientSockFD, KwmGetQueryCacheStats());
+    }
+}
+
+KWM_COMMAND_HANDLER(KwmQueryRulesCommand)
+{
+    if(ClientSockFD)
+    {
+        std::string Output;
+        pthread_mutex_lock(&KWMThread.Lock);
+        KwmCreateRulesString(!Args.empty(), Output);
+        pthread_mutex_unlock(&KWMThread.Lock);
+        KwmWriteToSocket(ClientSockFD, Output);
+    }
+}
+
+KWM_COMMAND_HANDLER(KwmConfigCommandCacheCommand)
+{
+    KwmSetCommandCacheSize(ConvertStringToInt(Args[0]));
+}
+
+KWM_COMMAND_HANDLER(KwmWindowFocusCommand)
+{
+    if(KwmIsDirection(Args[0]))
+        ShiftWindowFocusDirected(KwmGetDirectionDegrees(Args[0]));
+    else if(Args[0] == "prev")
+        ShiftWindowFocus(-1);
+    else if(Args[0] == "next")
+        ShiftWindowFocus(1);
+    else if(Args[0] == "curr")
+        FocusWindowBelowCursor();
+    else
+        FocusWindowByID(ConvertStringToInt(Args[0]));
+}
+
+KWM_COMMAND_HANDLER(KwmWindowFocusMonocleCommand)
+{
+    ShiftSubTreeWindowFocus(Args[0] == "prev" ? -1 : 1);
+}
+
+KWM_COMMAND_HANDLER(KwmWindowSwapCommand)
+{
+    if(KwmIsDirection(Args[0]))
+        SwapFocusedWindowDirected(KwmGetDirectionDegrees(Args[0]));
+    else if(Args[0] == "prev")
+        SwapFocusedWindowWithNearest(-1);
+    else if(Args[0] == "next")
+        SwapFocusedWindowWithNearest(1);
+    else if(Args[0] == "mark")
+        SwapFocusedWindowWithMarked();
+}
+
+KWM_COMMAND_HANDLER(KwmWindowZoomCommand)
+{
+    if(Args[0] == "fullscreen")
+        ToggleFocusedWindowFullscreen();
+    else if(Args[0] == "parent")
+        ToggleFocusedWindowParentContainer();
+}
+
+KWM_COMMAND_HANDLER(KwmWindowToggleFloatCommand)
+{
+    ToggleFocusedWindowFloating();
+}
+
+KWM_COMMAND_HANDLER(KwmWindowResizeCommand)
+{
+    ResizeWindowToContainerSize();
+}
+
+KWM_COMMAND_HANDLER(KwmWindowSplitModeCommand)
+{
+    if(!KWMFocus.Window || !DoesSpaceExistInMapOfScreen(KWMScreen.Current))
+        return;
+
+    space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
+    tree_node *Node = GetTreeNodeFromWindowID(Space->RootNode, KWMFocus.Window->WID);
+
+    if(Node)
+        ToggleNodeSplitMode(KWMScreen.Current, Node->Parent);
+}
+
+KWM_COMMAND_HANDLER(KwmWindowContainerTypeCommand)
+{
+    if(Args[0] == "monocle")
+        ChangeTypeOfFocusedNode(NodeTypeLink);
+    else if(Args[0] == "bsp")
+        ChangeTypeOfFocusedNode(NodeTypeTree);
+    else if(Args[0] == "toggle")
+        ToggleTypeOfFocusedNode();
+}
+
+KWM_COMMAND_HANDLER(KwmWindowContainerRatioCommand)
+{
+    double Ratio = ConvertStringToDouble(Args[0]);
+    Ratio = Data ? -Ratio : Ratio;
+
+    if(Args.size() == 2)
+        ModifyContainerSplitRatio(Ratio, KwmGetDirectionDegrees(Args[1]));
+    else
+        ModifyContainerSplitRatio(Ratio);
+}
+
+KWM_COMMAND_HANDLER(KwmWindowMoveToSpaceCommand)
+{
+    if(!KWMFocus.Window)
+        return;
+
+    if(Args[0] == "previous")
+        GoToPreviousSpace(true);
+    else
+        MoveFocusedWindowToSpace(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmWindowMoveToDisplayCommand)
+{
+    if(!KWMFocus.Window)
+        return;
+
+    if(Args[0] == "prev")
+        MoveWindowToDisplay(KWMFocus.Window, -1, true);
+    else if(Args[0] == "next")
+        MoveWindowToDisplay(KWMFocus.Window, 1, true);
+    else
+        MoveWindowToDisplay(KWMFocus.Window, ConvertStringToInt(Args[0]), false);
+}
+
+KWM_COMMAND_HANDLER(KwmWindowMoveCommand)
+{
+    if(!KWMFocus.Window)
+        return;
+
+    if(Args[0] == "mark")
+        DetachAndReinsertWindow(KWMScreen.MarkedWindow, 0);
+    else
+        DetachAndReinsertWindow(KWMFocus.Window->WID, KwmGetDirectionDegrees(Args[0]));
+}
+
+KWM_COMMAND_HANDLER(KwmWindowMoveFloatingCommand)
+{
+    if(!KWMFocus.Window)
+        return;
+
+    MoveFloatingWindow(ConvertStringToInt(Args[0]), ConvertStringToInt(Args[1]));
+}
+
+KWM_COMMAND_HANDLER(KwmWindowMarkFocusedCommand)
+{
+    MarkFocusedWindowContainer();
+}
+
+KWM_COMMAND_HANDLER(KwmWindowMarkCommand)
+{
+    window_info *Window = NULL;
+    bool Wrap = Args.size() > 1 && Args[1] == "wrap";
+    if(FindClosestWindow(KwmGetDirectionDegrees(Args[0]), &Window, Wrap))
+        MarkWindowContainer(Window);
+}
+
+KWM_COMMAND_HANDLER(KwmSpaceFocusCommand)
+{
+    if(Args[0] == "previous")
+        GoToPreviousSpace(false);
+    else
+        KwmEmitKeystroke(KWMHotkeys.SpacesKey, Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmSpaceFocusExperimentalCommand)
+{
+    ActivateSpaceWithoutTransition(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmSpaceTileCommand)
+{
+    if(Args[0] == "float")
+        FloatFocusedSpace();
+    else
+        TileFocusedSpace(KwmGetSpaceMode(Args[0]));
+}
+
+KWM_COMMAND_HANDLER(KwmSpaceResizeCommand)
+{
+    space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
+    ApplyTreeNodeContainer(Space->RootNode);
+}
+
+KWM_COMMAND_HANDLER(KwmSpacePaddingCommand)
+{
+    ChangePaddingOfDisplay(Args[1], Args[0] == "increase" ? 10 : -10);
+}
+
+KWM_COMMAND_HANDLER(KwmSpaceGapCommand)
+{
+    ChangeGapOfDisplay(Args[1], Args[0] == "increase" ? 10 : -10);
+}
+
+KWM_COMMAND_HANDLER(KwmDisplayFocusCommand)
+{
+    if(Args[0] == "prev")
+        GiveFocusToScreen(GetIndexOfPrevScreen(), NULL, false, true);
+    else if(Args[0] == "next")
+        GiveFocusToScreen(GetIndexOfNextScreen(), NULL, false, true);
+    else
+        GiveFocusToScreen(ConvertStringToInt(Args[0]), NULL, false, true);
+}
+
+KWM_COMMAND_HANDLER(KwmDisplaySplitModeCommand)
+{
+    if(Args[0] == "optimal")
+        KWMScreen.SplitMode = SPLIT_OPTIMAL;
+    else if(Args[0] == "vertical")
+        KWMScreen.SplitMode = SPLIT_VERTICAL;
+    else if(Args[0] == "horizontal")
+        KWMScreen.SplitMode = SPLIT_HORIZONTAL;
+}
+
+KWM_COMMAND_HANDLER(KwmTreePseudoCommand)
+{
+    if(Args[0] == "create")
+        CreatePseudoNode();
+    else if(Args[0] == "destroy")
+        RemovePseudoNode();
+}
+
+KWM_COMMAND_HANDLER(KwmTreeRotateCommand)
+{
+    space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
+    if(Space->Settings.Mode == SpaceModeBSP)
+    {
+        RotateTree(Space->RootNode, ConvertStringToInt(Args[0]));
+        CreateNodeContainers(KWMScreen.Current, Space->RootNode, false);
+        ApplyTreeNodeContainer(Space->RootNode);
     }
-    else if(Tokens[1] == "-fExperimental")
+}
+
+KWM_COMMAND_HANDLER(KwmTreeSaveCommand)
+{
+    SaveBSPTreeToFile(KWMScreen.Current, Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmTreeRestoreCommand)
+{
+    LoadBSPTreeFromFile(KWMScreen.Current, Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmWriteCommand)
+{
+    KwmEmitKeystrokes(CreateStringFromTokens(Args, 0));
+}
+
+KWM_COMMAND_HANDLER(KwmPressCommand)
+{
+    KwmEmitKeystroke(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmBindCommand)
+{
+    std::string Error;
+    bool Passthrough = Data != NULL;
+    if(!KwmAddHotkey(Args[0], CreateStringFromTokens(Args, 1), Passthrough, Error))
     {
-        ActivateSpaceWithoutTransition(Tokens[2]);
+        DEBUG("KwmBindCommand() " << Error);
+        if(ClientSockFD)
+            KwmWriteToSocket(ClientSockFD, Error);
     }
-    else if(Tokens[1] == "-t")
+}
+
+KWM_COMMAND_HANDLER(KwmUnbindCommand)
+{
+    KwmRemoveHotkey(Args[0]);
+}
+
+KWM_COMMAND_HANDLER(KwmRuleCommand)
+{
+    KwmAddRule(CreateStringFromTokens(Args, 0));
+}
+
+KWM_COMMAND_HANDLER(KwmSubscribeCommand)
+{
+    unsigned int Events = 0;
+    for(std::size_t ArgIndex = 0; ArgIndex < Args.size(); ++ArgIndex)
+        KwmParseEventType(Args[ArgIndex], &Events);
+
+    if(Events && ClientSockFD)
+        KwmAddSubscriber(ClientSockFD, Events);
+}
+
+KWM_COMMAND_HANDLER(KwmHelpCommand)
+{
+    std::string Output;
+    KwmCreateCommandHelp(&KwmCommandTable, CreateStringFromTokens(Args, 0), Output);
+    if(ClientSockFD)
+        KwmWriteToSocket(ClientSockFD, Output);
+}
+
+#define KWM_DIRECTIONS "north|east|south|west"
+#define KWM_ON_OFF "on|off"
+
+kwm_command KwmCommands[] =
+{
+    { "quit", "", "Quit kwm", KwmQuitCommand, NULL, NULL, false },
+    { "help", "[<text>]", "List commands, optionally only those starting with the given verb path", KwmHelpCommand, NULL, NULL, true },
+    { "if", "<text>", "Run a command when a condition holds: <field> ==|!= <value> then <command> [else <command>]", KwmIfCommand, NULL, NULL, true },
+
+    { "config reload", "[--no-cache]", "Reload config ($HOME/.kwm/kwmrc), optionally ignoring the compiled config cache", KwmConfigReloadCommand, NULL, NULL, false },
+    { "config command-cache", "<int>", "Set number of parsed client commands to keep, 0 disables the cache", KwmConfigCommandCacheCommand, NULL, NULL, true },
+    { "config spaces-key", "<word>", "Set modifier used by OSX space-hotkeys", KwmConfigSpacesKeyCommand, NULL, NULL, false },
+    { "config optimal-ratio", "<float>", "Set ratio used by the optimal split-mode", KwmConfigOptimalRatioCommand, NULL, NULL, false },
+    { "config prefix-key", "<word>", "Set a prefix for kwms hotkeys", KwmConfigPrefixKeyCommand, NULL, NULL, false },
+    { "config prefix-global", KWM_ON_OFF, "Make prefix apply globally", KwmConfigPrefixGlobalCommand, NULL, NULL, false },
+    { "config prefix-timeout", "<float>", "Set prefix timeout in seconds", KwmConfigPrefixTimeoutCommand, NULL, NULL, false },
+    { "config sequence-timeout", "<float>", "Set how long a key sequence waits for its next key, in seconds", KwmConfigSequenceTimeoutCommand, NULL, NULL, false },
+    { "config focused-border", KWM_ON_OFF, "Enable or disable the border of the focused window", KwmConfigBorderCommand, NULL, &FocusedBorder, false },
+    { "config focused-border size", "<int>", "Set width of the focused border", KwmConfigBorderSizeCommand, NULL, &FocusedBorder, false },
+    { "config focused-border color", "<hex>", "Set color of the focused border (0xAARRGGBB)", KwmConfigBorderColorCommand, NULL, &FocusedBorder, false },
+    { "config focused-border radius", "<float>", "Set corner radius of the focused border", KwmConfigBorderRadiusCommand, NULL, &FocusedBorder, false },
+    { "config marked-border", KWM_ON_OFF, "Enable or disable the border of the marked window", KwmConfigBorderCommand, NULL, &MarkedBorder, false },
+    { "config marked-border size", "<int>", "Set width of the marked border", KwmConfigBorderSizeCommand, NULL, &MarkedBorder, false },
+    { "config marked-border color", "<hex>", "Set color of the marked border (0xAARRGGBB)", KwmConfigBorderColorCommand, NULL, &MarkedBorder, false },
+    { "config marked-border radius", "<float>", "Set corner radius of the marked border", KwmConfigBorderRadiusCommand, NULL, &MarkedBorder, false },
+    { "config prefix-border", KWM_ON_OFF, "Enable or disable the border shown while the prefix is active", KwmConfigBorderCommand, NULL, &PrefixBorder, false },
+    { "config prefix-border size", "<int>", "Set width of the prefix border", KwmConfigBorderSizeCommand, NULL, &PrefixBorder, false },
+    { "config prefix-border color", "<hex>", "Set color of the prefix border (0xAARRGGBB)", KwmConfigBorderColorCommand, NULL, &PrefixBorder, false },
+    { "config prefix-border radius", "<float>", "Set corner radius of the prefix border", KwmConfigBorderRadiusCommand, NULL, &PrefixBorder, false },
+    { "config float-non-resizable", KWM_ON_OFF, "Automatically float windows that can not be resized", KwmToggleCommand, NULL, &KWMTiling.FloatNonResizable, false },
+    { "config lock-to-container", KWM_ON_OFF, "Lock windows to the size of their container", KwmToggleCommand, NULL, &KWMTiling.LockToContainer, false },
+    { "config spawn", "left|right", "Set position of new windows in a container", KwmConfigSpawnCommand, NULL, NULL, false },
+    { "config tiling", "bsp|monocle|float|off", "Set default tiling mode for new spaces", KwmConfigTilingCommand, NULL, NULL, false },
+    { "config space", "<int> <int> mode bsp|monocle|float", "Set tiling mode of a space on a display", KwmConfigSpaceModeCommand, NULL, NULL, false },
+    { "config space", "<int> <int> padding <float> <float> <float> <float>", "Set padding (top bottom left right) of a space on a display", KwmConfigSpacePaddingCommand, NULL, NULL, false },
+    { "config space", "<int> <int> gap <float> <float>", "Set gaps (vertical horizontal) of a space on a display", KwmConfigSpaceGapCommand, NULL, NULL, false },
+    { "config display", "<int> mode bsp|monocle|float", "Set default tiling mode of a display", KwmConfigDisplayModeCommand, NULL, NULL, false },
+    { "config display", "<int> padding <float> <float> <float> <float>", "Set default padding (top bottom left right) of a display", KwmConfigDisplayPaddingCommand, NULL, NULL, false },
+    { "config display", "<int> gap <float> <float>", "Set default gaps (vertical horizontal) of a display", KwmConfigDisplayGapCommand, NULL, NULL, false },
+    { "config focus-follows-mouse", "toggle|autofocus|autoraise|off", "Set state of focus-follows-mouse", KwmConfigFocusFollowsMouseCommand, NULL, NULL, false },
+    { "config mouse-follows-focus", KWM_ON_OFF, "Set state of mouse-follows-focus", KwmToggleCommand, NULL, &KWMToggles.UseMouseFollowsFocus, false },
+    { "config standby-on-float", KWM_ON_OFF, "Disable focus-follows-mouse while a floating window is focused", KwmToggleCommand, NULL, &KWMToggles.StandbyOnFloat, false },
+    { "config cycle-focus", "screen|off", "Set focus-cycling mode", KwmConfigCycleFocusCommand, NULL, NULL, false },
+    { "config hotkeys", KWM_ON_OFF, "Enable or disable the builtin hotkeys", KwmToggleCommand, NULL, &KWMToggles.UseBuiltinHotkeys, false },
+    { "config add-role", "<word> <text>", "Allow an additional window role for an application", KwmConfigAddRoleCommand, NULL, NULL, false },
+    { "config padding", "<float> <float> <float> <float>", "Set default padding (top bottom left right)", KwmConfigPaddingCommand, NULL, NULL, false },
+    { "config gap", "<float> <float>", "Set default gaps (vertical horizontal)", KwmConfigGapCommand, NULL, NULL, false },
+    { "config split-ratio", "<float>", "Set ratio used for binary splits", KwmConfigSplitRatioCommand, NULL, NULL, false },
+
+    { "query focused", "", "Get owner and title of focused window", NULL, KwmQueryFocusedCommand, NULL, true },
+    { "query current", "", "Get id of focused window (-1 == none)", NULL, KwmQueryCurrentCommand, NULL, true },
+    { "query marked", "", "Get id of marked window (-1 == none)", NULL, KwmQueryMarkedCommand, NULL, true },
+    { "query tag", "", "Get tag for current space", NULL, KwmQueryTagCommand, NULL, true },
+    { "query spawn", "", "Get state of 'kwmc config spawn'", NULL, KwmQuerySpawnCommand, NULL, true },
+    { "query prefix", "", "Get state of the prefix-key", NULL, KwmQueryPrefixCommand, NULL, true },
+    { "query split-ratio", "", "Get the current ratio used for binary splits", NULL, KwmQuerySplitRatioCommand, NULL, true },
+    { "query split-mode", "global|<int>", "Get the split-mode of a window or the mode used for binary splits", NULL, KwmQuerySplitModeCommand, NULL, true },
+    { "query focus", "", "Get state of focus-follows-mouse", NULL, KwmQueryFocusCommand, NULL, true },
+    { "query mouse-follows", "", "Get state of mouse-follows-focus", NULL, KwmQueryMouseFollowsCommand, NULL, true },
+    { "query space", "", "Get tiling mode used for new spaces", NULL, KwmQuerySpaceCommand, NULL, true },
+    { "query cycle-focus", "", "Get active cycle-focus mode", NULL, KwmQueryCycleFocusCommand, NULL, true },
+    { "query border", "focused|marked|prefix", "Check if a border is enabled", NULL, KwmQueryBorderCommand, NULL, true },
+    { "query dir", KWM_DIRECTIONS " [wrap|nowrap]", "Get id of the window in direction of focused window", NULL, KwmQueryDirCommand, NULL, true },
+    { "query parent", "<int>", "Check if the focused window and a window have the same parent node", NULL, KwmQueryParentCommand, NULL, true },
+    { "query child", "<int>", "Get child position of window from parent (left or right child)", NULL, KwmQueryChildCommand, NULL, true },
+    { "query windows", "", "Get list of visible windows on active space", NULL, KwmQueryWindowsCommand, NULL, true },
+    { "query prev-space", "", "Get id of previous active space for the focused display", NULL, KwmQueryPrevSpaceCommand, NULL, true },
+    { "query state", "<text>", "Get displays, windows, focus and settings as json: [displays|windows|focus|settings ..] --json", KwmQueryStateCommand, NULL, NULL, true },
+    { "query bindings", "", "Get all hotkeys and the command each one was compiled to", NULL, KwmQueryBindingsCommand, NULL, true },
+    { "query rules", "[--stats]", "Get all window rules, with hit counters and evaluation and enforcement timings", KwmQueryRulesCommand, NULL, NULL, true },
+    { "query cache", "[queries|commands|config|rules]", "Get counters of the query response cache, the parsed command cache or the window rule memo, or how the config was loaded", KwmQueryCacheCommand, NULL, NULL, true },
+
+    { "window -f", KWM_DIRECTIONS "|prev|next|curr|<int>", "Set focus to a window", KwmWindowFocusCommand, NULL, NULL, false },
+    { "window -fm", "prev|next", "Set focus to a window in the current monocle subtree", KwmWindowFocusMonocleCommand, NULL, NULL, false },
+    { "window -s", KWM_DIRECTIONS "|prev|next|mark", "Swap the focused window with another window", KwmWindowSwapCommand, NULL, NULL, false },
+    { "window -z", "fullscreen|parent", "Toggle zoom of the focused window", KwmWindowZoomCommand, NULL, NULL, false },
+    { "window -t", "focused", "Toggle floating state of the focused window", KwmWindowToggleFloatCommand, NULL, NULL, false },
+    { "window -r", "focused", "Resize the focused window to its container", KwmWindowResizeCommand, NULL, NULL, false },
+    { "window -c split-mode", "toggle", "Toggle split-mode of the focused container", KwmWindowSplitModeCommand, NULL, NULL, false },
+    { "window -c type", "monocle|bsp|toggle", "Change type of the focused container", KwmWindowContainerTypeCommand, NULL, NULL, false },
+    { "window -c reduce", "<float> [" KWM_DIRECTIONS "]", "Reduce split-ratio of the focused container", KwmWindowContainerRatioCommand, NULL, (void *) 1, false },
+    { "window -c expand", "<float> [" KWM_DIRECTIONS "]", "Expand split-ratio of the focused container", KwmWindowContainerRatioCommand, NULL, NULL, false },
+    { "window -m space", "previous|<int>", "Move the focused window to a space", KwmWindowMoveToSpaceCommand, NULL, NULL, false },
+    { "window -m display", "prev|next|<int>", "Move the focused window to a display", KwmWindowMoveToDisplayCommand, NULL, NULL, false },
+    { "window -m", KWM_DIRECTIONS "|mark", "Detach the focused window and reinsert it in a direction or at the marked window", KwmWindowMoveCommand, NULL, NULL, false },
+    { "window -m", "<int> <int>", "Move a floating window by x and y pixels", KwmWindowMoveFloatingCommand, NULL, NULL, false },
+    { "window -mk focused", "", "Mark the focused window", KwmWindowMarkFocusedCommand, NULL, NULL, false },
+    { "window -mk", KWM_DIRECTIONS " [wrap|nowrap]", "Mark the window in direction of the focused window", KwmWindowMarkCommand, NULL, NULL, false },
+
+    { "space -f", "previous|<word>", "Switch to a space", KwmSpaceFocusCommand, NULL, NULL, false },
+    { "space -fExperimental", "<int>", "Switch to a space without the OSX transition", KwmSpaceFocusExperimentalCommand, NULL, NULL, false },
+    { "space -t", "bsp|monocle|float", "Set tiling mode of the current space", KwmSpaceTileCommand, NULL, NULL, false },
+    { "space -r", "focused", "Reapply the containers of the current space", KwmSpaceResizeCommand, NULL, NULL, false },
+    { "space -p", "increase|decrease left|right|top|bottom|all", "Change padding of the current space", KwmSpacePaddingCommand, NULL, NULL, false },
+    { "space -g", "increase|decrease vertical|horizontal|all", "Change gaps of the current space", KwmSpaceGapCommand, NULL, NULL, false },
+
+    { "display -f", "prev|next|<int>", "Set focus to a display", KwmDisplayFocusCommand, NULL, NULL, false },
+    { "display -c", "optimal|vertical|horizontal", "Set the mode used for binary splits", KwmDisplaySplitModeCommand, NULL, NULL, false },
+
+    { "tree -pseudo", "create|destroy", "Create or remove a pseudo-container", KwmTreePseudoCommand, NULL, NULL, false },
+    { "tree rotate", "90|180|270", "Rotate the window-tree of the current space", KwmTreeRotateCommand, NULL, NULL, false },
+    { "tree save", "<word>", "Save bsp-layout of the window-tree of the current space", KwmTreeSaveCommand, NULL, NULL, false },
+    { "tree restore", "<word>", "Restore bsp-layout of the window-tree of the current space", KwmTreeRestoreCommand, NULL, NULL, false },
+
+    { "write", "<text>", "Emit keystrokes for the given text", KwmWriteCommand, NULL, NULL, false },
+    { "press", "<word>", "Emit a keystroke", KwmPressCommand, NULL, NULL, false },
+    { "bind", "<word> [<text>]", "Bind a hotkey to a command", KwmBindCommand, NULL, NULL, false },
+    { "bind-passthrough", "<word> [<text>]", "Bind a hotkey to a command and pass the key through", KwmBindCommand, NULL, (void *) 1, false },
+    { "unbind", "<word>", "Remove a hotkey", KwmUnbindCommand, NULL, NULL, false },
+    { "rule", "<text>", "Add a window rule", KwmRuleCommand, NULL, NULL, false },
+    { "subscribe", "<text>", "Keep the connection open and receive events", KwmSubscribeCommand, NULL, NULL, false },
+};
+
+void KwmInitInterpreter()
+{
+    KwmInitCommandTable(&KwmCommandTable, KwmCommands, sizeof(KwmCommands) / sizeof(KwmCommands[0]));
+}
+
+/* Queries are read-only and are answered from the published query snapshot of the
+ * current state generation (see cache.cpp), never from live state. */
+void KwmRunQueryCommand(kwm_command *Command, std::vector<std::string> &Args, int ClientSockFD)
+{
+    if(!ClientSockFD)
+        return;
+
+    std::string Output;
+    KwmGetQueryResponse(Command, Args, Output);
+    KwmWriteToSocket(ClientSockFD, Output);
+}
+
+/* Mutating commands that arrive from a client are serialized with the other kwm
+ * threads through KWMThread.Lock. Commands without a client (ClientSockFD == 0)
+ * come from the config file or from the hotkey thread, which already holds it. */
+void KwmExecuteCommand(kwm_command *Command, std::vector<std::string> &Args, int ClientSockFD)
+{
+    if(Command->Query)
     {
-        if(Tokens[2] == "bsp")
-            TileFocusedSpace(SpaceModeBSP);
-        else if(Tokens[2] == "monocle")
-            TileFocusedSpace(SpaceModeMonocle);
-        else if(Tokens[2] == "float")
-            FloatFocusedSpace();
+        KwmRunQueryCommand(Command, Args, ClientSockFD);
     }
-    else if(Tokens[1] == "-r")
+    else if(Command->ReadOnly)
     {
-        if(Tokens[2] == "focused")
-        {
-            space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
-            ApplyTreeNodeContainer(Space->RootNode);
-        }
+        Command->Handler(Args, Command->Data, ClientSockFD);
     }
-    else if(Tokens[1] == "-p")
+    else if(ClientSockFD)
     {
-        if(Tokens[3] == "left" || Tokens[3] == "right" ||
-           Tokens[3] == "top" || Tokens[3] == "bottom" ||
-           Tokens[3] == "all")
-        {
-            int Value = 0;
-            if(Tokens[2] == "increase")
-                Value = 10;
-            else if(Tokens[2] == "decrease")
-                Value = -10;
-
-            ChangePaddingOfDisplay(Tokens[3], Value);
-        }
+        pthread_mutex_lock(&KWMThread.Lock);
+        Command->Handler(Args, Command->Data, ClientSockFD);
+        KwmBumpGeneration();
+        KwmFlushPendingEvents();
+        pthread_mutex_unlock(&KWMThread.Lock);
     }
-    else if(Tokens[1] == "-g")
+    else
     {
-        if(Tokens[3] == "vertical" || Tokens[3] == "horizontal" ||
-           Tokens[3] == "all")
-        {
-            int Value = 0;
-            if(Tokens[2] == "increase")
-                Value = 10;
-            else if(Tokens[2] == "decrease")
-                Value = -10;
-
-            ChangeGapOfDisplay(Tokens[3], Value);
-        }
+        Command->Handler(Args, Command->Data, ClientSockFD);
+        KwmBumpGeneration();
     }
 }
 
-void KwmDisplayCommand(std::vector<std::string> &Tokens)
+/* The condition and the branch it selects are evaluated and executed under the same
+ * acquisition of KWMThread.Lock, so the state a mutating branch acts upon is the
+ * state the condition was tested against. Queries and read-only branches take
+ * their own path once the lock is released. */
+void KwmExecuteConditions(std::vector<kwm_condition> &Conditions, int ClientSockFD)
 {
-    if(Tokens[1] == "-f")
+    if(!ClientSockFD)
     {
-        if(Tokens[2] == "prev")
-            GiveFocusToScreen(GetIndexOfPrevScreen(), NULL, false, true);
-        else if(Tokens[2] == "next")
-            GiveFocusToScreen(GetIndexOfNextScreen(), NULL, false, true);
-        else
-            GiveFocusToScreen(ConvertStringToInt(Tokens[2]), NULL, false, true);
+        kwm_condition *Condition = KwmEvaluateConditions(Conditions);
+        if(Condition)
+            KwmExecuteCommand(Condition->Command, Condition->Args, ClientSockFD);
+
+        return;
+    }
+
+    pthread_mutex_lock(&KWMThread.Lock);
+    kwm_condition *Condition = KwmEvaluateConditions(Conditions);
+    if(Condition && !Condition->Command->Query && !Condition->Command->ReadOnly)
+    {
+        Condition->Command->Handler(Condition->Args, Condition->Command->Data, ClientSockFD);
+        KwmBumpGeneration();
+        KwmFlushPendingEvents();
+        pthread_mutex_unlock(&KWMThread.Lock);
     }
-    else if(Tokens[1] == "-c")
+    else
     {
-        if(Tokens[2] == "optimal")
-            KWMScreen.SplitMode = SPLIT_OPTIMAL;
-        else if(Tokens[2] == "vertical")
-            KWMScreen.SplitMode = SPLIT_VERTICAL;
-        else if(Tokens[2] == "horizontal")
-            KWMScreen.SplitMode = SPLIT_HORIZONTAL;
+        pthread_mutex_unlock(&KWMThread.Lock);
+        if(Condition)
+            KwmExecuteCommand(Condition->Command, Condition->Args, ClientSockFD);
     }
 }
 
-void KwmTreeCommand(std::vector<std::string> &Tokens)
+bool KwmCompileCommand(const std::string &Message, kwm_command **Command, std::vector<std::string> &Args, std::string &Error)
 {
-    if(Tokens[1] == "-pseudo")
+    if(Message.empty())
     {
-        if(Tokens[2] == "create")
-            CreatePseudoNode();
-        else if(Tokens[2] == "destroy")
-            RemovePseudoNode();
+        Error = "error: empty command";
+        return false;
     }
-    else if(Tokens[1] == "rotate")
+
+    *Command = KwmResolveCommand(&KwmCommandTable, Message, Args, Error);
+    return *Command != NULL;
+}
+
+/* Only messages from clients go through the parsed command cache; config lines are
+ * executed once and would only push out the commands that clients keep repeating. */
+void KwmInterpretCommand(const std::string &Message, int ClientSockFD)
+{
+    std::string Error;
+    kwm_command *Command = NULL;
+    std::vector<std::string> Args;
+    if(ClientSockFD && KwmGetCachedCommand(Message, &Command, Args))
     {
-        if(Tokens[2] == "90" || Tokens[2] == "270" || Tokens[2] == "180")
-        {
-            space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
-            if(Space->Settings.Mode == SpaceModeBSP)
-            {
-                RotateTree(Space->RootNode, ConvertStringToInt(Tokens[2]));
-                CreateNodeContainers(KWMScreen.Current, Space->RootNode, false);
-                ApplyTreeNodeContainer(Space->RootNode);
-            }
-        }
+        KwmExecuteCommand(Command, Args, ClientSockFD);
     }
-    else if(Tokens[1] == "save")
+    else if(KwmCompileCommand(Message, &Command, Args, Error))
     {
-        SaveBSPTreeToFile(KWMScreen.Current, Tokens[2]);
+        if(ClientSockFD)
+            KwmCacheCommand(Message, Command, Args);
+
+        KwmExecuteCommand(Command, Args, ClientSockFD);
     }
-    else if(Tokens[1] == "restore")
+    else if(!Message.empty())
     {
-        LoadBSPTreeFromFile(KWMScreen.Current, Tokens[2]);
+        DEBUG("KwmInterpretCommand() " << Error);
+        if(ClientSockFD)
+            KwmWriteToSocket(ClientSockFD, Error);
     }
 }
-
-void KwmInterpretCommand(std::string Message, int ClientSockFD)
-{
-    std::vector<std::string> Tokens = SplitString(Message, ' ');
-
-    if(Tokens[0] == "quit")
-        KwmQuit();
-    else if(Tokens[0] == "config")
-        KwmConfigCommand(Tokens);
-    else if(Tokens[0] == "query")
-        KwmQueryCommand(Tokens, ClientSockFD);
-    else if(Tokens[0] == "window")
-        KwmWindowCommand(Tokens);
-    else if(Tokens[0] == "space")
-        KwmSpaceCommand(Tokens);
-    else if(Tokens[0] == "display")
-        KwmDisplayCommand(Tokens);
-    else if(Tokens[0] == "tree")
-        KwmTreeCommand(Tokens);
-    else if(Tokens[0] == "write")
-        KwmEmitKeystrokes(CreateStringFromTokens(Tokens, 1));
-    else if(Tokens[0] == "press")
-        KwmEmitKeystroke(Tokens[1]);
-    else if(Tokens[0] == "bind")
-        KwmBindCommand(Tokens, false);
-    else if(Tokens[0] == "bind-passthrough")
-        KwmBindCommand(Tokens, true);
-    else if(Tokens[0] == "unbind")
-        KwmRemoveHotkey(Tokens[1]);
-    else if(Tokens[0] == "rule")
-        KwmAddRule(CreateStringFromTokens(Tokens, 1));
-}
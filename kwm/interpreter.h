@@ -2,15 +2,13 @@
 #define INTERPRETER_H
 
 #include "types.h"
-
-void KwmConfigCommand(std::vector<std::string> &Tokens);
-void KwmQueryCommand(std::vector<std::string> &Tokens, int ClientSockFD);
-void KwmBindCommand(std::vector<std::string> &Tokens, bool Passthrough);
-void KwmWindowCommand(std::vector<std::string> &Tokens);
-void KwmSpaceCommand(std::vector<std::string> &Tokens);
-void KwmDisplayCommand(std::vector<std::string> &Tokens);
-void KwmTreeCommand(std::vector<std::string> &Tokens);
-
-void KwmInterpretCommand(std::string Message, int ClientSockFD);
+#include "command.h"
+
+void KwmInitInterpreter();
+void KwmRunQueryCommand(kwm_command *Command, std::vector<std::string> &Args, int ClientSockFD);
+void KwmExecuteCommand(kwm_command *Command, std::vector<std::string> &Args, int ClientSockFD);
+bool KwmCompileCommand(const std::string &Message, kwm_command **Command, std::vector<std::string> &Args, std::string &Error);
+void KwmExecuteConditions(std::vector<kwm_condition> &Conditions, int ClientSockFD);
+void KwmInterpretCommand(const std::string &Message, int ClientSockFD);
 
 #endif
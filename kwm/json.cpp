@@ -0,0 +1,183 @@
+#include "json.h"
+
+#include <cmath>
+
+/* The json_writer emits a document in a single pass into a fixed buffer that is
+ * appended to the output string whenever it fills up, so a large document is built
+ * without concatenating intermediate strings. Keys are passed as NULL for array
+ * elements and for the root value. */
+
+void JsonFlush(json_writer *Writer)
+{
+    Writer->Output->append(Writer->Buffer, Writer->Used);
+    Writer->Used = 0;
+}
+
+void JsonWriteRaw(json_writer *Writer, const char *Text, std::size_t Length)
+{
+    for(std::size_t Index = 0; Index < Length; ++Index)
+    {
+        if(Writer->Used == sizeof(Writer->Buffer))
+            JsonFlush(Writer);
+
+        Writer->Buffer[Writer->Used++] = Text[Index];
+    }
+}
+
+void JsonWriteChar(json_writer *Writer, char C)
+{
+    if(Writer->Used == sizeof(Writer->Buffer))
+        JsonFlush(Writer);
+
+    Writer->Buffer[Writer->Used++] = C;
+}
+
+void JsonWriteEscaped(json_writer *Writer, const char *Text, std::size_t Length)
+{
+    JsonWriteChar(Writer, '"');
+    for(std::size_t Index = 0; Index < Length; ++Index)
+    {
+        unsigned char C = Text[Index];
+        switch(C)
+        {
+            case '"': { JsonWriteRaw(Writer, "\\\"", 2); } break;
+            case '\\': { JsonWriteRaw(Writer, "\\\\", 2); } break;
+            case '\n': { JsonWriteRaw(Writer, "\\n", 2); } break;
+            case '\r': { JsonWriteRaw(Writer, "\\r", 2); } break;
+            case '\t': { JsonWriteRaw(Writer, "\\t", 2); } break;
+            default:
+            {
+                if(C < 0x20)
+                {
+                    char Escape[8];
+                    int EscapeLength = snprintf(Escape, sizeof(Escape), "\\u%04x", C);
+                    JsonWriteRaw(Writer, Escape, EscapeLength);
+                }
+                else
+                {
+                    JsonWriteChar(Writer, C);
+                }
+            } break;
+        }
+    }
+    JsonWriteChar(Writer, '"');
+}
+
+void JsonWriteKey(json_writer *Writer, const char *Key)
+{
+    if(Writer->NeedsSeparator[Writer->Depth])
+        JsonWriteChar(Writer, ',');
+
+    Writer->NeedsSeparator[Writer->Depth] = true;
+    if(Key)
+    {
+        JsonWriteEscaped(Writer, Key, strlen(Key));
+        JsonWriteChar(Writer, ':');
+    }
+}
+
+void JsonBeginWriter(json_writer *Writer, std::string *Output)
+{
+    Writer->Output = Output;
+    Writer->Depth = 0;
+    Writer->NeedsSeparator[0] = false;
+    Writer->Used = 0;
+}
+
+void JsonEndWriter(json_writer *Writer)
+{
+    Assert(Writer->Depth == 0);
+    JsonFlush(Writer);
+}
+
+void JsonBeginScope(json_writer *Writer, const char *Key, char Open)
+{
+    Assert(Writer->Depth + 1 < (int)(sizeof(Writer->NeedsSeparator) / sizeof(bool)));
+
+    JsonWriteKey(Writer, Key);
+    JsonWriteChar(Writer, Open);
+    Writer->NeedsSeparator[++Writer->Depth] = false;
+}
+
+void JsonEndScope(json_writer *Writer, char Close)
+{
+    Assert(Writer->Depth > 0);
+
+    --Writer->Depth;
+    JsonWriteChar(Writer, Close);
+}
+
+void JsonBeginObject(json_writer *Writer, const char *Key)
+{
+    JsonBeginScope(Writer, Key, '{');
+}
+
+void JsonEndObject(json_writer *Writer)
+{
+    JsonEndScope(Writer, '}');
+}
+
+void JsonBeginArray(json_writer *Writer, const char *Key)
+{
+    JsonBeginScope(Writer, Key, '[');
+}
+
+void JsonEndArray(json_writer *Writer)
+{
+    JsonEndScope(Writer, ']');
+}
+
+void JsonWriteString(json_writer *Writer, const char *Key, const char *Value, std::size_t Length)
+{
+    JsonWriteKey(Writer, Key);
+    JsonWriteEscaped(Writer, Value, Length);
+}
+
+void JsonWriteString(json_writer *Writer, const char *Key, const std::string &Value)
+{
+    JsonWriteString(Writer, Key, Value.c_str(), Value.size());
+}
+
+void JsonWriteString(json_writer *Writer, const char *Key, const char *Value)
+{
+    JsonWriteString(Writer, Key, Value, strlen(Value));
+}
+
+void JsonWriteInt(json_writer *Writer, const char *Key, long long Value)
+{
+    char Number[32];
+    int Length = snprintf(Number, sizeof(Number), "%lld", Value);
+
+    JsonWriteKey(Writer, Key);
+    JsonWriteRaw(Writer, Number, Length);
+}
+
+void JsonWriteDouble(json_writer *Writer, const char *Key, double Value)
+{
+    if(!std::isfinite(Value))
+    {
+        JsonWriteNull(Writer, Key);
+        return;
+    }
+
+    char Number[32];
+    int Length = snprintf(Number, sizeof(Number), "%.10g", Value);
+
+    JsonWriteKey(Writer, Key);
+    JsonWriteRaw(Writer, Number, Length);
+}
+
+void JsonWriteBool(json_writer *Writer, const char *Key, bool Value)
+{
+    JsonWriteKey(Writer, Key);
+    if(Value)
+        JsonWriteRaw(Writer, "true", 4);
+    else
+        JsonWriteRaw(Writer, "false", 5);
+}
+
+void JsonWriteNull(json_writer *Writer, const char *Key)
+{
+    JsonWriteKey(Writer, Key);
+    JsonWriteRaw(Writer, "null", 4);
+}
@@ -0,0 +1,23 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include "types.h"
+
+void JsonBeginWriter(json_writer *Writer, std::string *Output);
+void JsonEndWriter(json_writer *Writer);
+void JsonFlush(json_writer *Writer);
+
+void JsonBeginObject(json_writer *Writer, const char *Key);
+void JsonEndObject(json_writer *Writer);
+void JsonBeginArray(json_writer *Writer, const char *Key);
+void JsonEndArray(json_writer *Writer);
+
+void JsonWriteString(json_writer *Writer, const char *Key, const char *Value, std::size_t Length);
+void JsonWriteString(json_writer *Writer, const char *Key, const std::string &Value);
+void JsonWriteString(json_writer *Writer, const char *Key, const char *Value);
+void JsonWriteInt(json_writer *Writer, const char *Key, long long Value);
+void JsonWriteDouble(json_writer *Writer, const char *Key, double Value);
+void JsonWriteBool(json_writer *Writer, const char *Key, bool Value);
+void JsonWriteNull(json_writer *Writer, const char *Key);
+
+#endif
@@ -3,6 +3,11 @@
 #include "helpers.h"
 #include "interpreter.h"
 #include "border.h"
+#include "daemon.h"
+#include "condition.h"
+#include "rules.h"
+
+#include <sched.h>
 
 extern kwm_focus KWMFocus;
 extern kwm_hotkeys KWMHotkeys;
@@ -24,6 +29,18 @@ bool HotkeysAreEqual(hotkey *A, hotkey *B)
     return false;
 }
 
+bool HotkeyBindingsAreEqual(hotkey *A, hotkey *B)
+{
+    return HotkeysAreEqual(A, B) &&
+           A->Prefixed == B->Prefixed &&
+           A->Sequence == B->Sequence &&
+           A->Passthrough == B->Passthrough &&
+           A->IsSystemCommand == B->IsSystemCommand &&
+           A->State == B->State &&
+           A->List == B->List &&
+           A->Command == B->Command;
+}
+
 void CreateHotkeyFromCGEvent(CGEventRef Event, hotkey *Hotkey)
 {
     CGEventFlags Flags = CGEventGetFlags(Event);
@@ -38,136 +55,411 @@ void *KwmMainHotkeyTrigger(void *HotkeyPtr)
 {
     while(true)
     {
-        while(!KWMHotkeys.Queue.empty())
+        kwm_key_event Event;
+        while(KwmPopKeyEvent(&KWMHotkeys.Queue, &Event))
         {
-            hotkey Hotkey = KWMHotkeys.Queue.front();
-            KWMHotkeys.Queue.pop();
-
             pthread_mutex_lock(&KWMThread.Lock);
-            if(ShouldKeyBeProcessed(&Hotkey))
-                KwmExecuteHotkey(&Hotkey);
+            if(!Event.Transition)
+            {
+                hotkey *Hotkey = KwmFindHotkey(Event.Node, Event.Mod, Event.Key);
+                if(Hotkey && IsHotkeyStateReqFulfilled(Hotkey))
+                    KwmExecuteHotkey(Hotkey);
+            }
+
+            KwmUpdatePrefixState();
+            KwmFlushPendingEvents();
             pthread_mutex_unlock(&KWMThread.Lock);
         }
 
-        usleep(10000);
+        if(!KwmWaitForKeyEvent(&KWMHotkeys.Queue, KwmGetKeySequenceTimeout()))
+        {
+            pthread_mutex_lock(&KWMThread.Lock);
+            KwmExpireKeySequence();
+            KwmFlushPendingEvents();
+            pthread_mutex_unlock(&KWMThread.Lock);
+        }
     }
 
     return NULL;
 }
 
-bool KwmIsPrefixKey(hotkey *PrefixKey, modifiers *Mod, CGKeyCode Keycode)
+/* The event tap owns the position in the key trie; the hotkey thread only resets it
+ * when the pending sequence times out. State packs a stamp above the node so that a
+ * reset never overwrites a step the event tap took in the meantime. */
+long long KwmGetKeyTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int KwmGetKeyStateNode(unsigned long long State)
+{
+    return (int) (State & 0xFFFFFFFF);
+}
+
+unsigned long long KwmCreateKeyState(unsigned long long State, int Node)
 {
-    hotkey TempHotkey;
-    TempHotkey.Mod = *Mod;
-    TempHotkey.Key = Keycode;
+    return (((State >> 32) + 1) << 32) | (unsigned int) Node;
+}
+
+void KwmResetKeySequence()
+{
+    unsigned long long State = KWMHotkeys.State.load();
+    while(!KWMHotkeys.State.compare_exchange_weak(State, KwmCreateKeyState(State, KWM_HOTKEY_ROOT)));
+}
+
+double KwmGetKeySequenceTimeout()
+{
+    if(KwmGetKeyStateNode(KWMHotkeys.State.load()) == KWM_HOTKEY_ROOT)
+        return -1;
+
+    long long Remaining = KWMHotkeys.Deadline.load() - KwmGetKeyTime();
+    return Remaining > 0 ? Remaining / 1000000000.0 : 0;
+}
+
+void KwmExpireKeySequence()
+{
+    unsigned long long State = KWMHotkeys.State.load();
+    if(KwmGetKeyStateNode(State) != KWM_HOTKEY_ROOT &&
+       KwmGetKeyTime() >= KWMHotkeys.Deadline.load())
+        KWMHotkeys.State.compare_exchange_strong(State, KwmCreateKeyState(State, KWM_HOTKEY_ROOT));
 
-    return HotkeysAreEqual(PrefixKey, &TempHotkey);
+    KwmUpdatePrefixState();
 }
 
-void CheckPrefixTimeout()
+/* The prefix counts as active for as long as the event tap is anywhere below the
+ * root of the trie, be it after the prefix key or halfway through a sequence. */
+void KwmUpdatePrefixState()
 {
-    if(KWMHotkeys.Prefix.Active)
+    bool Active = KwmGetKeyStateNode(KWMHotkeys.State.load()) != KWM_HOTKEY_ROOT;
+    if(Active != KWMHotkeys.Prefix.Active)
     {
-        kwm_time_point NewPrefixTime = std::chrono::steady_clock::now();
-        std::chrono::duration<double> Diff = NewPrefixTime - KWMHotkeys.Prefix.Time;
-        if(Diff.count() > KWMHotkeys.Prefix.Timeout)
-        {
-            KWMHotkeys.Prefix.Active = false;
-            if(PrefixBorder.Enabled)
-                UpdateBorder("focused");
-        }
+        KWMHotkeys.Prefix.Active = Active;
+        if(PrefixBorder.Enabled)
+            UpdateBorder(BorderTypeFocused);
+
+        KwmEmitEvent(EventTypePrefix);
+    }
+}
+
+/* The applications listed by a binding are interned when it is bound and kept as a
+ * bitset indexed by owner atom (the same atoms the window rules use). The atom of the
+ * focused window is interned when focus changes, so checking a binding against the
+ * focused application is a shift and a mask. */
+void KwmCompileHotkeyOwners(hotkey *Hotkey)
+{
+    Hotkey->Owners.clear();
+    for(std::size_t AppIndex = 0; AppIndex < Hotkey->List.size(); ++AppIndex)
+    {
+        unsigned int Atom = KwmGetOwnerAtom(Hotkey->List[AppIndex]);
+        if(Atom / 64 >= Hotkey->Owners.size())
+            Hotkey->Owners.resize(Atom / 64 + 1, 0);
+
+        Hotkey->Owners[Atom / 64] |= 1ULL << (Atom % 64);
     }
 }
 
+bool KwmHotkeyListsOwner(hotkey *Hotkey, unsigned int Atom)
+{
+    return Atom / 64 < Hotkey->Owners.size() &&
+           (Hotkey->Owners[Atom / 64] >> (Atom % 64)) & 1;
+}
+
 bool IsHotkeyStateReqFulfilled(hotkey *Hotkey)
 {
-    if(Hotkey->State == HotkeyStateInclude && KWMFocus.Window)
+    if(Hotkey->State == HotkeyStateNone || !KWMFocus.Window)
+        return true;
+
+    bool Listed = KwmHotkeyListsOwner(Hotkey, KWMFocus.OwnerAtom);
+    return Hotkey->State == HotkeyStateInclude ? Listed : !Listed;
+}
+
+/* The command of a binding was resolved when it was bound, so executing it
+ * does not parse anything. Executing the command may reload the config or
+ * unbind keys, which invalidates Hotkey, so nothing is read from it afterwards. */
+void KwmExecuteHotkey(hotkey *Hotkey)
+{
+    if(Hotkey->Command.empty())
+        return;
+
+    DEBUG("KwmExecuteHotkey() " << Hotkey->Command);
+    if(Hotkey->IsSystemCommand)
+        KwmExecuteThreadedSystemCommand(Hotkey->Command);
+    else if(!Hotkey->Conditions.empty())
+        KwmExecuteConditions(Hotkey->Conditions, 0);
+    else if(Hotkey->Compiled)
+        KwmExecuteCommand(Hotkey->Compiled, Hotkey->Args, 0);
+}
+
+unsigned int KwmGetModifierMask(modifiers *Mod)
+{
+    return (Mod->CmdKey ? 1 : 0) |
+           (Mod->AltKey ? 2 : 0) |
+           (Mod->CtrlKey ? 4 : 0) |
+           (Mod->ShiftKey ? 8 : 0);
+}
+
+void KwmSetModifierMask(modifiers *Mod, unsigned int Mask)
+{
+    Mod->CmdKey = Mask & 1;
+    Mod->AltKey = Mask & 2;
+    Mod->CtrlKey = Mask & 4;
+    Mod->ShiftKey = Mask & 8;
+}
+
+/* Bindings form a trie of keystrokes. Node 0 is the root and node 1 is entered by
+ * the prefix key; every multi-key sequence adds a node per intermediate step. The
+ * edges of all nodes share one open addressing table keyed by node, modifiers and
+ * keycode, so every keystroke is one hash lookup no matter how deep the sequence
+ * is. The home slot is taken from the high bits of a multiplicative hash, which
+ * depend on every bit of the key; the low bits only see the modifiers and keycode,
+ * so the same key bound below different nodes would pile up on one slot.
+ *
+ * The event tap probes the table without taking a lock, so a published table is
+ * never written to. Every change is made to the other of the two tables, which is
+ * then published through KWMHotkeys.Table. The event tap counts itself in
+ * KWMHotkeys.Readers while it holds a table; once that drops to zero after a
+ * publish, no one can still see the old table and it becomes the next one to
+ * write. Changes are made with KWMThread.Lock held, as is every lookup from the
+ * hotkey thread.
+ *
+ * A slot that leads to a node shadows a binding on the same key, the same way the
+ * prefix key always took precedence over a binding of that key. */
+unsigned int KwmGetHotkeySlotKey(int Node, unsigned int Mask, CGKeyCode Keycode)
+{
+    return ((unsigned int) Node << 12) | (Mask << 8) | Keycode;
+}
+
+unsigned int KwmGetHotkeyHomeSlot(unsigned int Key)
+{
+    return (Key * 2654435761u) >> (32 - KWM_HOTKEY_SLOT_BITS);
+}
+
+hotkey_slot *KwmFindHotkeySlot(hotkey_table *Table, int Node, unsigned int Mask, CGKeyCode Keycode)
+{
+    if(Keycode >= KWM_HOTKEY_KEYCODES)
+        return NULL;
+
+    unsigned int Key = KwmGetHotkeySlotKey(Node, Mask, Keycode);
+    unsigned int Slot = KwmGetHotkeyHomeSlot(Key);
+    while(Table->Slots[Slot].Bound)
     {
-        for(std::size_t AppIndex = 0; AppIndex < Hotkey->List.size(); ++AppIndex)
-        {
-            if(KWMFocus.Window->Owner == Hotkey->List[AppIndex])
-                return true;
-        }
+        if(Table->Slots[Slot].Key == Key)
+            return &Table->Slots[Slot];
 
-        return false;
+        Slot = (Slot + 1) & (KWM_HOTKEY_SLOTS - 1);
     }
-    else if(Hotkey->State == HotkeyStateExclude && KWMFocus.Window)
+
+    return NULL;
+}
+
+hotkey_slot *KwmClaimHotkeySlot(hotkey_table *Table, int Node, unsigned int Mask, CGKeyCode Keycode)
+{
+    hotkey_slot *Existing = KwmFindHotkeySlot(Table, Node, Mask, Keycode);
+    if(Existing || Keycode >= KWM_HOTKEY_KEYCODES)
+        return Existing;
+
+    unsigned int Key = KwmGetHotkeySlotKey(Node, Mask, Keycode);
+    unsigned int Slot = KwmGetHotkeyHomeSlot(Key);
+    for(int Probe = 0; Probe < KWM_HOTKEY_SLOTS; ++Probe)
     {
-        for(std::size_t AppIndex = 0; AppIndex < Hotkey->List.size(); ++AppIndex)
+        hotkey_slot *Candidate = &Table->Slots[Slot];
+        if(!Candidate->Bound)
         {
-            if(KWMFocus.Window->Owner == Hotkey->List[AppIndex])
-                return false;
+            Candidate->Key = Key;
+            Candidate->Index = -1;
+            Candidate->Child = -1;
+            Candidate->Passthrough = false;
+            Candidate->Bound = true;
+            return Candidate;
         }
+
+        Slot = (Slot + 1) & (KWM_HOTKEY_SLOTS - 1);
     }
 
-    return true;
+    return NULL;
 }
 
-bool ShouldKeyBeProcessed(hotkey *Hotkey)
+int KwmCreateHotkeyNode(hotkey_table *Table, double Timeout, bool Sticky)
 {
-    if(KWMHotkeys.Prefix.Enabled &&
-       KwmIsPrefixKey(&KWMHotkeys.Prefix.Key, &Hotkey->Mod, Hotkey->Key))
+    if(Table->NodeCount == KWM_HOTKEY_NODES)
+        return -1;
+
+    hotkey_node *Node = &Table->Nodes[Table->NodeCount];
+    Node->Timeout = Timeout;
+    Node->Sticky = Sticky;
+    return Table->NodeCount++;
+}
+
+/* Returns false if the key is already bound; the first binding of a key wins. */
+bool KwmInsertHotkey(hotkey_table *Table, hotkey *Hotkey, int Index, std::string &Error)
+{
+    int Node = Hotkey->Prefixed ? KWM_HOTKEY_PREFIX : KWM_HOTKEY_ROOT;
+    for(std::size_t Step = 0; Step < Hotkey->Sequence.size(); ++Step)
     {
-        KWMHotkeys.Prefix.Active = true;
-        KWMHotkeys.Prefix.Time = std::chrono::steady_clock::now();
-        if(PrefixBorder.Enabled)
-            UpdateBorder("focused");
+        unsigned int Stroke = Hotkey->Sequence[Step];
+        hotkey_slot *Slot = KwmClaimHotkeySlot(Table, Node, Stroke >> 8, Stroke & 0xFF);
+        if(Slot && Slot->Child == -1)
+            Slot->Child = KwmCreateHotkeyNode(Table, KWMHotkeys.SequenceTimeout, false);
+
+        if(!Slot || Slot->Child == -1)
+        {
+            Error = "error: too many key sequences, could not bind '" + Hotkey->KeySym + "'";
+            return false;
+        }
 
+        Node = Slot->Child;
+    }
+
+    hotkey_slot *Slot = KwmClaimHotkeySlot(Table, Node, KwmGetModifierMask(&Hotkey->Mod), Hotkey->Key);
+    if(!Slot)
+    {
+        Error = "error: too many hotkeys, could not bind '" + Hotkey->KeySym + "'";
         return false;
     }
 
-    if(!IsHotkeyStateReqFulfilled(Hotkey))
+    if(Slot->Index != -1)
         return false;
 
+    Slot->Passthrough = Hotkey->Passthrough;
+    Slot->Index = Index;
     return true;
 }
 
-void KwmExecuteHotkey(hotkey *Hotkey)
+hotkey_table *KwmGetHotkeyTable()
 {
-    if(Hotkey->Command.empty())
-        return;
+    return KWMHotkeys.Table.load();
+}
 
-    DEBUG("KwmExecuteHotkey() " << Hotkey->Command);
-    if(Hotkey->IsSystemCommand)
-        KwmExecuteThreadedSystemCommand(Hotkey->Command);
+/* Returns the table that is not published, either empty or as a copy of the
+ * published one. */
+hotkey_table *KwmBeginHotkeyTableUpdate(bool Copy)
+{
+    hotkey_table *Live = KWMHotkeys.Table.load();
+    hotkey_table *Table = Live == &KWMHotkeys.Tables[0] ? &KWMHotkeys.Tables[1] : &KWMHotkeys.Tables[0];
+    if(Copy && Live)
+        memcpy(Table, Live, sizeof(hotkey_table));
     else
-        KwmInterpretCommand(Hotkey->Command, 0);
+        memset(Table, 0, sizeof(hotkey_table));
 
-    if((Hotkey->Prefixed || KWMHotkeys.Prefix.Global) && KWMHotkeys.Prefix.Active)
-        KWMHotkeys.Prefix.Time = std::chrono::steady_clock::now();
+    return Table;
 }
 
-bool HotkeyExists(modifiers Mod, CGKeyCode Keycode, hotkey *Hotkey)
+void KwmPublishHotkeyTable(hotkey_table *Table)
 {
-    hotkey TempHotkey = {};
-    TempHotkey.Mod = Mod;
-    TempHotkey.Key = Keycode;
+    KWMHotkeys.Table.store(Table);
+    while(KWMHotkeys.Readers.load() != 0)
+        sched_yield();
+}
 
-    if(KWMHotkeys.Prefix.Enabled &&
-       KwmIsPrefixKey(&KWMHotkeys.Prefix.Key, &TempHotkey.Mod, TempHotkey.Key))
-    {
-        if(Hotkey)
-            *Hotkey = KWMHotkeys.Prefix.Key;
+void KwmRebuildHotkeyTable()
+{
+    hotkey_table *Table = KwmBeginHotkeyTableUpdate(false);
+    KwmCreateHotkeyNode(Table, 0, false);
+    KwmCreateHotkeyNode(Table, KWMHotkeys.Prefix.Timeout, true);
 
-        return true;
+    if(KWMHotkeys.Prefix.Enabled)
+    {
+        hotkey *Prefix = &KWMHotkeys.Prefix.Key;
+        hotkey_slot *Slot = KwmClaimHotkeySlot(Table, KWM_HOTKEY_ROOT, KwmGetModifierMask(&Prefix->Mod), Prefix->Key);
+        if(Slot)
+            Slot->Child = KWM_HOTKEY_PREFIX;
     }
 
+    std::string Error;
     for(std::size_t HotkeyIndex = 0; HotkeyIndex < KWMHotkeys.List.size(); ++HotkeyIndex)
+        KwmInsertHotkey(Table, &KWMHotkeys.List[HotkeyIndex], HotkeyIndex, Error);
+
+    KwmPublishHotkeyTable(Table);
+    KwmResetKeySequence();
+}
+
+void KwmClearHotkeys()
+{
+    KWMHotkeys.List.clear();
+    KwmRebuildHotkeyTable();
+}
+
+/* Called from the event tap for every key press; decides whether kwm consumes the key.
+ *
+ * A key is looked up below the current node first and then at the root, so while the
+ * prefix is active unprefixed bindings keep working, as they always have. A sticky
+ * node (the prefix) stays active after a binding below it runs and its timeout starts
+ * over; any other node returns to the root once the sequence completes or a key does
+ * not continue it. With a global prefix, bindings at the root are only live while the
+ * prefix is active. */
+bool KwmProcessKeyEvent(hotkey_table *Table, modifiers Mod, CGKeyCode Keycode, bool *Passthrough)
+{
+    unsigned int Mask = KwmGetModifierMask(&Mod);
+    long long Now = KwmGetKeyTime();
+
+    unsigned long long State = KWMHotkeys.State.load();
+    while(true)
     {
-        hotkey *CheckHotkey = &KWMHotkeys.List[HotkeyIndex];
-        if(HotkeysAreEqual(CheckHotkey, &TempHotkey))
+        int Current = KwmGetKeyStateNode(State);
+        int Node = Current;
+        if(Node != KWM_HOTKEY_ROOT && Now >= KWMHotkeys.Deadline.load())
+            Node = KWM_HOTKEY_ROOT;
+
+        int From = Node;
+        hotkey_slot *Slot = KwmFindHotkeySlot(Table, Node, Mask, Keycode);
+        if(!Slot && Node != KWM_HOTKEY_ROOT)
         {
-            if(Hotkey)
-                *Hotkey = *CheckHotkey;
+            From = KWM_HOTKEY_ROOT;
+            Slot = KwmFindHotkeySlot(Table, KWM_HOTKEY_ROOT, Mask, Keycode);
+        }
 
-            if((CheckHotkey->Prefixed || KWMHotkeys.Prefix.Global) && KWMHotkeys.Prefix.Active)
-                return true;
-            else if(!CheckHotkey->Prefixed && !KWMHotkeys.Prefix.Global)
-                return true;
+        if(Slot && Slot->Child == -1 &&
+           (Slot->Index == -1 || (Node == KWM_HOTKEY_ROOT && KWMHotkeys.Prefix.Global)))
+            Slot = NULL;
+
+        hotkey_node *Info = &Table->Nodes[Node];
+        kwm_key_event Event = { Mask, Keycode, From, !Slot || Slot->Child != -1 };
+        int Next = Node;
+        if(Slot && Slot->Child != -1)
+        {
+            Next = Slot->Child;
+            KWMHotkeys.Deadline.store(Now + (long long) (Table->Nodes[Next].Timeout * 1000000000.0));
+        }
+        else if(!Info->Sticky)
+        {
+            Next = KWM_HOTKEY_ROOT;
+        }
+        else if(Slot && (From == Node || KWMHotkeys.Prefix.Global))
+        {
+            KWMHotkeys.Deadline.store(Now + (long long) (Info->Timeout * 1000000000.0));
         }
+
+        if(Next != Current &&
+           !KWMHotkeys.State.compare_exchange_weak(State, KwmCreateKeyState(State, Next)))
+            continue;
+
+        if(Slot || Next != Current)
+            KwmPushKeyEvent(&KWMHotkeys.Queue, &Event);
+
+        if(!Slot)
+            return false;
+
+        *Passthrough = !Event.Transition && Slot->Passthrough;
+        return true;
     }
+}
 
-    return false;
+bool KwmProcessKeyEvent(modifiers Mod, CGKeyCode Keycode, bool *Passthrough)
+{
+    KWMHotkeys.Readers.fetch_add(1);
+    bool Result = KwmProcessKeyEvent(KWMHotkeys.Table.load(), Mod, Keycode, Passthrough);
+    KWMHotkeys.Readers.fetch_sub(1);
+    return Result;
+}
+
+/* The event tap only queues the identity of a key (modifiers, keycode and the node
+ * it was found below), or a transition when the key only moved through the trie so
+ * that the hotkey thread updates the prefix state. The hotkey thread looks up the live
+ * binding, so no strings or arguments are copied per keypress. */
+hotkey *KwmFindHotkey(int Node, unsigned int Mask, CGKeyCode Keycode)
+{
+    hotkey_slot *Slot = KwmFindHotkeySlot(KwmGetHotkeyTable(), Node, Mask, Keycode);
+    return Slot && Slot->Index != -1 ? &KWMHotkeys.List[Slot->Index] : NULL;
 }
 
 void DetermineHotkeyState(hotkey *Hotkey, std::string &Command)
@@ -183,6 +475,7 @@ void DetermineHotkeyState(hotkey *Hotkey, std::string &Command)
     {
         std::string Applications = Command.substr(StartOfList + 1, EndOfList - (StartOfList + 1));
         Hotkey->List = SplitString(Applications, ',');
+        KwmCompileHotkeyOwners(Hotkey);
 
         if(Command[Command.size()-2] == '-')
         {
@@ -201,39 +494,101 @@ void DetermineHotkeyState(hotkey *Hotkey, std::string &Command)
         Hotkey->State = HotkeyStateNone;
 }
 
-bool KwmParseHotkey(std::string KeySym, std::string Command, hotkey *Hotkey, bool Passthrough)
+/* The steps of a sequence are separated by ',' (ctrl-a,w,h). A ',' that directly
+ * follows the '-' of a step, or starts a step, is the comma key itself. */
+std::vector<std::string> KwmSplitKeySequence(const std::string &KeySym)
 {
-    std::vector<std::string> KeyTokens = SplitString(KeySym, '-');
-    if(KeyTokens.size() != 2)
+    std::vector<std::string> Steps;
+    std::string Step;
+    for(std::size_t Index = 0; Index < KeySym.size(); ++Index)
+    {
+        if(KeySym[Index] == ',' && !Step.empty() && Step[Step.size() - 1] != '-')
+        {
+            Steps.push_back(Step);
+            Step.clear();
+        }
+        else
+        {
+            Step += KeySym[Index];
+        }
+    }
+
+    Steps.push_back(Step);
+    return Steps;
+}
+
+/* A step is mod+mod-key; steps after the first may also be a bare key. */
+bool KwmParseKeyStep(std::string Step, bool First, modifiers *Mod, CGKeyCode *Keycode, bool *Prefixed)
+{
+    std::vector<std::string> KeyTokens = SplitString(Step, '-');
+    std::string Key;
+    if(KeyTokens.size() == 2)
+    {
+        Key = KeyTokens[1];
+        std::vector<std::string> Modifiers = SplitString(KeyTokens[0], '+');
+        for(std::size_t ModIndex = 0; ModIndex < Modifiers.size(); ++ModIndex)
+        {
+            if(Modifiers[ModIndex] == "cmd")
+                Mod->CmdKey = true;
+            else if(Modifiers[ModIndex] == "alt")
+                Mod->AltKey = true;
+            else if(Modifiers[ModIndex] == "ctrl")
+                Mod->CtrlKey = true;
+            else if(Modifiers[ModIndex] == "shift")
+                Mod->ShiftKey = true;
+            else if(Modifiers[ModIndex] == "prefix" && First)
+                *Prefixed = true;
+        }
+    }
+    else if(!First && KeyTokens.size() == 1 && Step.find('-') == std::string::npos)
+    {
+        Key = KeyTokens[0];
+    }
+    else
+    {
         return false;
+    }
 
-    std::vector<std::string> Modifiers = SplitString(KeyTokens[0], '+');
-    for(std::size_t ModIndex = 0; ModIndex < Modifiers.size(); ++ModIndex)
+    if(GetLayoutIndependentKeycode(Key, Keycode))
+        return true;
+
+    return KeycodeForChar(Key[0], Keycode);
+}
+
+bool KwmParseHotkey(std::string KeySym, std::string Command, hotkey *Hotkey, bool Passthrough)
+{
+    std::vector<std::string> Steps = KwmSplitKeySequence(KeySym);
+    for(std::size_t Step = 0; Step < Steps.size(); ++Step)
     {
-        if(Modifiers[ModIndex] == "cmd")
-            Hotkey->Mod.CmdKey = true;
-        else if(Modifiers[ModIndex] == "alt")
-            Hotkey->Mod.AltKey = true;
-        else if(Modifiers[ModIndex] == "ctrl")
-            Hotkey->Mod.CtrlKey = true;
-        else if(Modifiers[ModIndex] == "shift")
-            Hotkey->Mod.ShiftKey = true;
-        else if(Modifiers[ModIndex] == "prefix")
-            Hotkey->Prefixed = true;
+        modifiers Mod = {};
+        CGKeyCode Keycode;
+        bool Prefixed = false;
+        if(!KwmParseKeyStep(Steps[Step], Step == 0, &Mod, &Keycode, &Prefixed))
+            return false;
+
+        if(Step == 0)
+            Hotkey->Prefixed = Prefixed;
+
+        if(Step + 1 < Steps.size())
+        {
+            if(Keycode >= KWM_HOTKEY_KEYCODES)
+                return false;
+
+            Hotkey->Sequence.push_back((KwmGetModifierMask(&Mod) << 8) | Keycode);
+        }
+        else
+        {
+            Hotkey->Mod = Mod;
+            Hotkey->Key = Keycode;
+        }
     }
 
     DetermineHotkeyState(Hotkey, Command);
     Hotkey->IsSystemCommand = IsPrefixOfString(Command, "sys");
     Hotkey->Passthrough = Passthrough;
     Hotkey->Command = Command;
-
-    CGKeyCode Keycode;
-    bool Result = GetLayoutIndependentKeycode(KeyTokens[1], &Keycode);
-    if(!Result)
-        Result = KeycodeForChar(KeyTokens[1][0], &Keycode);
-
-    Hotkey->Key = Keycode;
-    return Result;
+    Hotkey->KeySym = KeySym;
+    return true;
 }
 
 void KwmSetSpacesKey(std::string KeySym)
@@ -257,11 +612,12 @@ void KwmSetSpacesKey(std::string KeySym)
 void KwmSetPrefix(std::string KeySym)
 {
     hotkey Hotkey = {};
-    if(KwmParseHotkey(KeySym, "", &Hotkey, false))
+    if(KwmParseHotkey(KeySym, "", &Hotkey, false) && Hotkey.Sequence.empty())
     {
         KWMHotkeys.Prefix.Key = Hotkey;
         KWMHotkeys.Prefix.Active = false;
         KWMHotkeys.Prefix.Enabled = true;
+        KwmRebuildHotkeyTable();
     }
 }
 
@@ -273,14 +629,55 @@ void KwmSetPrefixGlobal(bool Global)
 void KwmSetPrefixTimeout(double Timeout)
 {
     KWMHotkeys.Prefix.Timeout = Timeout;
+    hotkey_table *Table = KwmBeginHotkeyTableUpdate(true);
+    Table->Nodes[KWM_HOTKEY_PREFIX].Timeout = Timeout;
+    KwmPublishHotkeyTable(Table);
 }
 
-void KwmAddHotkey(std::string KeySym, std::string Command, bool Passthrough)
+void KwmSetSequenceTimeout(double Timeout)
+{
+    KWMHotkeys.SequenceTimeout = Timeout;
+    hotkey_table *Table = KwmBeginHotkeyTableUpdate(true);
+    for(int Node = KWM_HOTKEY_PREFIX + 1; Node < Table->NodeCount; ++Node)
+        Table->Nodes[Node].Timeout = Timeout;
+    KwmPublishHotkeyTable(Table);
+}
+
+bool KwmAddHotkey(std::string KeySym, std::string Command, bool Passthrough, std::string &Error)
 {
     hotkey Hotkey = {};
-    if(KwmParseHotkey(KeySym, Command, &Hotkey, Passthrough) &&
-       !HotkeyExists(Hotkey.Mod, Hotkey.Key, NULL))
-            KWMHotkeys.List.push_back(Hotkey);
+    if(!KwmParseHotkey(KeySym, Command, &Hotkey, Passthrough))
+    {
+        Error = "error: invalid key '" + KeySym + "'";
+        return false;
+    }
+
+    if(!Hotkey.IsSystemCommand && KwmIsConditionalCommand(Hotkey.Command))
+    {
+        if(!KwmCompileConditions(Hotkey.Command, Hotkey.Conditions, Error))
+            return false;
+    }
+    else if(!Hotkey.IsSystemCommand && !Hotkey.Command.empty() &&
+            !KwmCompileCommand(Hotkey.Command, &Hotkey.Compiled, Hotkey.Args, Error))
+    {
+        return false;
+    }
+
+    if(Hotkey.Key >= KWM_HOTKEY_KEYCODES)
+    {
+        Error = "error: invalid key '" + KeySym + "'";
+        return false;
+    }
+
+    Error.clear();
+    hotkey_table *Table = KwmBeginHotkeyTableUpdate(true);
+    if(KwmInsertHotkey(Table, &Hotkey, KWMHotkeys.List.size(), Error))
+    {
+        KWMHotkeys.List.push_back(Hotkey);
+        KwmPublishHotkeyTable(Table);
+    }
+
+    return Error.empty();
 }
 
 void KwmRemoveHotkey(std::string KeySym)
@@ -288,158 +685,244 @@ void KwmRemoveHotkey(std::string KeySym)
     hotkey NewHotkey = {};
     if(KwmParseHotkey(KeySym, "", &NewHotkey, false))
     {
-        for(std::size_t HotkeyIndex = 0; HotkeyIndex < KWMHotkeys.List.size(); ++HotkeyIndex)
+        int Node = NewHotkey.Prefixed ? KWM_HOTKEY_PREFIX : KWM_HOTKEY_ROOT;
+        for(std::size_t Step = 0; Node != -1 && Step < NewHotkey.Sequence.size(); ++Step)
         {
-            if(HotkeysAreEqual(&KWMHotkeys.List[HotkeyIndex], &NewHotkey))
-            {
-                KWMHotkeys.List.erase(KWMHotkeys.List.begin() + HotkeyIndex);
-                break;
-            }
+            unsigned int Stroke = NewHotkey.Sequence[Step];
+            hotkey_slot *Slot = KwmFindHotkeySlot(KwmGetHotkeyTable(), Node, Stroke >> 8, Stroke & 0xFF);
+            Node = Slot ? Slot->Child : -1;
+        }
+
+        hotkey *Hotkey = Node != -1 ? KwmFindHotkey(Node, KwmGetModifierMask(&NewHotkey.Mod), NewHotkey.Key) : NULL;
+        if(Hotkey)
+        {
+            KWMHotkeys.List.erase(KWMHotkeys.List.begin() + (Hotkey - &KWMHotkeys.List[0]));
+            KwmRebuildHotkeyTable();
         }
     }
 }
 
+/* Named keys are laid out by a perfect hash of their name, so resolving one costs
+ * a single hash and one string compare. The seed was searched offline such that
+ * no two names share a slot; adding a name means searching for a new seed. */
+struct key_name
+{
+    const char *Name;
+    CGKeyCode Keycode;
+};
+
+#define KWM_KEY_NAME_SEED 697
+#define KWM_KEY_NAME_SHIFT 26
+
+static const key_name KwmKeyNames[1 << (32 - KWM_KEY_NAME_SHIFT)] =
+{
+    { NULL, 0 }, { NULL, 0 }, { "f12", kVK_F12 }, { "f13", kVK_F13 },
+    { NULL, 0 }, { "f20", kVK_F20 }, { NULL, 0 }, { NULL, 0 },
+    { "escape", kVK_Escape }, { "f10", kVK_F10 }, { NULL, 0 }, { NULL, 0 },
+    { NULL, 0 }, { NULL, 0 }, { "delete", kVK_ForwardDelete }, { NULL, 0 },
+    { "f8", kVK_F8 }, { NULL, 0 }, { "f2", kVK_F2 }, { "f3", kVK_F3 },
+    { "right", kVK_RightArrow }, { "down", kVK_DownArrow }, { NULL, 0 }, { NULL, 0 },
+    { NULL, 0 }, { NULL, 0 }, { "f9", kVK_F9 }, { NULL, 0 },
+    { NULL, 0 }, { NULL, 0 }, { NULL, 0 }, { "backspace", kVK_Delete },
+    { "tab", kVK_Tab }, { "f6", kVK_F6 }, { NULL, 0 }, { "left", kVK_LeftArrow },
+    { "space", kVK_Space }, { "f1", kVK_F1 }, { "f5", kVK_F5 }, { "f4", kVK_F4 },
+    { "f16", kVK_F16 }, { "f15", kVK_F15 }, { NULL, 0 }, { NULL, 0 },
+    { "f7", kVK_F7 }, { NULL, 0 }, { "up", kVK_UpArrow }, { NULL, 0 },
+    { NULL, 0 }, { "f18", kVK_F18 }, { NULL, 0 }, { "f11", kVK_F11 },
+    { NULL, 0 }, { "f14", kVK_F14 }, { "f19", kVK_F19 }, { NULL, 0 },
+    { NULL, 0 }, { NULL, 0 }, { NULL, 0 }, { NULL, 0 },
+    { NULL, 0 }, { NULL, 0 }, { "f17", kVK_F17 }, { "return", kVK_Return },
+};
+
+unsigned int KwmHashKeyName(const char *Name)
+{
+    unsigned int Hash = KWM_KEY_NAME_SEED;
+    for(; *Name; ++Name)
+    {
+        Hash ^= (unsigned char) *Name;
+        Hash *= 16777619u;
+    }
+
+    Hash ^= Hash >> 16;
+    Hash *= 0x85ebca6bu;
+    Hash ^= Hash >> 13;
+    return Hash;
+}
+
 bool GetLayoutIndependentKeycode(std::string Key, CGKeyCode *Keycode)
 {
-    bool Result = true;
-
-    if(Key == "return")
-        *Keycode = kVK_Return;
-    else if(Key == "tab")
-        *Keycode = kVK_Tab;
-    else if(Key == "space")
-        *Keycode = kVK_Space;
-    else if(Key == "backspace")
-        *Keycode = kVK_Delete;
-    else if(Key == "delete")
-        *Keycode = kVK_ForwardDelete;
-    else if(Key == "escape")
-        *Keycode =  kVK_Escape;
-    else if(Key == "left")
-        *Keycode =  kVK_LeftArrow;
-    else if(Key == "right")
-        *Keycode =  kVK_RightArrow;
-    else if(Key == "up")
-        *Keycode = kVK_UpArrow;
-    else if(Key == "down")
-        *Keycode = kVK_DownArrow;
-    else if(Key == "f1")
-        *Keycode = kVK_F1;
-    else if(Key == "f2")
-        *Keycode = kVK_F2;
-    else if(Key == "f3")
-        *Keycode = kVK_F3;
-    else if(Key == "f4")
-        *Keycode = kVK_F4;
-    else if(Key == "f5")
-        *Keycode = kVK_F5;
-    else if(Key == "f6")
-        *Keycode = kVK_F6;
-    else if(Key == "f7")
-        *Keycode = kVK_F7;
-    else if(Key == "f8")
-        *Keycode = kVK_F8;
-    else if(Key == "f9")
-        *Keycode = kVK_F9;
-    else if(Key == "f10")
-        *Keycode = kVK_F10;
-    else if(Key == "f11")
-        *Keycode = kVK_F11;
-    else if(Key == "f12")
-        *Keycode = kVK_F12;
-    else if(Key == "f13")
-        *Keycode = kVK_F13;
-    else if(Key == "f14")
-        *Keycode = kVK_F14;
-    else if(Key == "f15")
-        *Keycode = kVK_F15;
-    else if(Key == "f16")
-        *Keycode = kVK_F16;
-    else if(Key == "f17")
-        *Keycode = kVK_F17;
-    else if(Key == "f18")
-        *Keycode = kVK_F18;
-    else if(Key == "f19")
-        *Keycode = kVK_F19;
-    else if(Key == "f20")
-        *Keycode = kVK_F19;
-    else
-        Result = false;
+    const key_name *Entry = &KwmKeyNames[KwmHashKeyName(Key.c_str()) >> KWM_KEY_NAME_SHIFT];
+    if(!Entry->Name || strcmp(Entry->Name, Key.c_str()) != 0)
+        return false;
+
+    *Keycode = Entry->Keycode;
+    return true;
+}
+
+/* Characters are resolved through a table of the current ASCII-capable layout.
+ * It is filled in one pass over the first 128 keycodes the first time a character
+ * is looked up, and only rebuilt when the selected input source changes. A config
+ * loaded from the compiled cache hands back the characters it used up front, so
+ * the table does not have to be translated at all in that case. */
+bool KwmCharKeycodeValid[128];
+CGKeyCode KwmCharKeycodes[128];
+bool KwmKeyboardLayoutBuilt = false;
+std::string KwmKeyboardLayout;
+
+bool KwmGetCachedKeycode(char Key, CGKeyCode *Keycode)
+{
+    unsigned char Index = (unsigned char) Key;
+    if(Index >= 128 || !KwmCharKeycodeValid[Index])
+        return false;
+
+    *Keycode = KwmCharKeycodes[Index];
+    return true;
+}
+
+void KwmSetCachedKeycode(char Key, CGKeyCode Keycode)
+{
+    unsigned char Index = (unsigned char) Key;
+    if(Index < 128)
+    {
+        KwmCharKeycodes[Index] = Keycode;
+        KwmCharKeycodeValid[Index] = true;
+    }
+}
+
+std::string KwmGetInputSourceID(TISInputSourceRef Keyboard)
+{
+    std::string Result;
+    CFStringRef SourceID = (CFStringRef)TISGetInputSourceProperty(Keyboard, kTISPropertyInputSourceID);
+    char Buffer[256];
+    if(SourceID && CFStringGetCString(SourceID, Buffer, sizeof(Buffer), kCFStringEncodingUTF8))
+        Result = Buffer;
 
     return Result;
 }
 
-CFStringRef KeycodeToString(CGKeyCode Keycode)
+std::string KwmGetKeyboardLayoutID()
 {
+    std::string Result;
     TISInputSourceRef Keyboard = TISCopyCurrentASCIICapableKeyboardLayoutInputSource();
-    CFDataRef Uchr = (CFDataRef)TISGetInputSourceProperty(Keyboard, kTISPropertyUnicodeKeyLayoutData);
-    const UCKeyboardLayout *KeyboardLayout = (const UCKeyboardLayout*)CFDataGetBytePtr(Uchr);
-
-    if(KeyboardLayout)
+    if(Keyboard)
     {
-        UInt32 DeadKeyState = 0;
-        UniCharCount MaxStringLength = 255;
-        UniCharCount ActualStringLength = 0;
-        UniChar UnicodeString[MaxStringLength];
+        Result = KwmGetInputSourceID(Keyboard);
+        CFRelease(Keyboard);
+    }
 
-        OSStatus Status = UCKeyTranslate(KeyboardLayout, Keycode,
-                                         kUCKeyActionDown, 0,
-                                         LMGetKbdType(), 0,
-                                         &DeadKeyState,
-                                         MaxStringLength,
-                                         &ActualStringLength,
-                                         UnicodeString);
+    return Result;
+}
 
-        if (ActualStringLength == 0 && DeadKeyState)
+void KwmBuildKeyboardLayoutTable()
+{
+    memset(KwmCharKeycodeValid, 0, sizeof(KwmCharKeycodeValid));
+    KwmKeyboardLayoutBuilt = true;
+    KwmKeyboardLayout.clear();
+
+    TISInputSourceRef Keyboard = TISCopyCurrentASCIICapableKeyboardLayoutInputSource();
+    if(!Keyboard)
+        return;
+
+    KwmKeyboardLayout = KwmGetInputSourceID(Keyboard);
+    CFDataRef Uchr = (CFDataRef)TISGetInputSourceProperty(Keyboard, kTISPropertyUnicodeKeyLayoutData);
+    const UCKeyboardLayout *KeyboardLayout = Uchr ? (const UCKeyboardLayout*)CFDataGetBytePtr(Uchr) : NULL;
+    if(KeyboardLayout)
+    {
+        UInt32 KeyboardType = LMGetKbdType();
+        for(CGKeyCode Keycode = 0; Keycode < 128; ++Keycode)
         {
-            Status = UCKeyTranslate(KeyboardLayout, kVK_Space,
-                                    kUCKeyActionDown, 0,
-                                    LMGetKbdType(), 0,
-                                    &DeadKeyState,
-                                    MaxStringLength,
-                                    &ActualStringLength,
-                                    UnicodeString);
-        }
+            UInt32 DeadKeyState = 0;
+            UniCharCount MaxStringLength = 4;
+            UniCharCount ActualStringLength = 0;
+            UniChar UnicodeString[4];
+
+            OSStatus Status = UCKeyTranslate(KeyboardLayout, Keycode,
+                                             kUCKeyActionDown, 0,
+                                             KeyboardType, 0,
+                                             &DeadKeyState,
+                                             MaxStringLength,
+                                             &ActualStringLength,
+                                             UnicodeString);
+
+            if(ActualStringLength == 0 && DeadKeyState)
+            {
+                Status = UCKeyTranslate(KeyboardLayout, kVK_Space,
+                                        kUCKeyActionDown, 0,
+                                        KeyboardType, 0,
+                                        &DeadKeyState,
+                                        MaxStringLength,
+                                        &ActualStringLength,
+                                        UnicodeString);
+            }
 
-        if(ActualStringLength > 0 && Status == noErr)
-            return CFStringCreateWithCharacters(NULL, UnicodeString, ActualStringLength);
+            if(Status == noErr && ActualStringLength == 1 &&
+               UnicodeString[0] < 128 && !KwmCharKeycodeValid[UnicodeString[0]])
+                KwmSetCachedKeycode(UnicodeString[0], Keycode);
+        }
     }
 
-    return NULL;
+    CFRelease(Keyboard);
+    DEBUG("KwmBuildKeyboardLayoutTable() " << KwmKeyboardLayout);
 }
 
 bool KeycodeForChar(char Key, CGKeyCode *Keycode)
 {
-    static CFMutableDictionaryRef CharToCodeDict = NULL;
+    if(KwmGetCachedKeycode(Key, Keycode))
+        return true;
 
-    bool Result = true;
-    UniChar Character = Key;
-    CFStringRef CharStr;
+    if(KwmKeyboardLayoutBuilt)
+        return false;
 
-    if (!CharToCodeDict)
-    {
-        CharToCodeDict = CFDictionaryCreateMutable(kCFAllocatorDefault, 128,
-                                                   &kCFCopyStringDictionaryKeyCallBacks, NULL);
-        if (!CharToCodeDict)
-            return false;
+    KwmBuildKeyboardLayoutTable();
+    return KwmGetCachedKeycode(Key, Keycode);
+}
 
-        for(std::size_t KeyIndex = 0; KeyIndex < 128; ++KeyIndex)
+/* Characters bound to hotkeys were resolved against the layout that was active
+ * when they were added; re-parse every keysym so that they follow the new one. */
+void KwmRemapHotkeys()
+{
+    for(std::size_t Index = 0; Index < KWMHotkeys.List.size(); ++Index)
+    {
+        hotkey *Hotkey = &KWMHotkeys.List[Index];
+        hotkey Remapped = {};
+        if(KwmParseHotkey(Hotkey->KeySym, "", &Remapped, false))
         {
-            CFStringRef KeyString = KeycodeToString((CGKeyCode)KeyIndex);
-            if (KeyString != NULL)
-            {
-                CFDictionaryAddValue(CharToCodeDict, KeyString, (const void *)KeyIndex);
-                CFRelease(KeyString);
-            }
+            Hotkey->Mod = Remapped.Mod;
+            Hotkey->Key = Remapped.Key;
+            Hotkey->Sequence = Remapped.Sequence;
         }
     }
 
-    CharStr = CFStringCreateWithCharacters(kCFAllocatorDefault, &Character, 1);
-    if (!CFDictionaryGetValueIfPresent(CharToCodeDict, CharStr, (const void **)Keycode))
-        Result = false;
+    hotkey Prefix = {};
+    if(KWMHotkeys.Prefix.Enabled &&
+       KwmParseHotkey(KWMHotkeys.Prefix.Key.KeySym, "", &Prefix, false))
+    {
+        KWMHotkeys.Prefix.Key.Mod = Prefix.Mod;
+        KWMHotkeys.Prefix.Key.Key = Prefix.Key;
+    }
 
-    CFRelease(CharStr);
-    return Result;
+    KwmRebuildHotkeyTable();
+}
+
+void KwmKeyboardLayoutCallback(CFNotificationCenterRef Center, void *Observer, CFStringRef Name, const void *Object, CFDictionaryRef UserInfo)
+{
+    pthread_mutex_lock(&KWMThread.Lock);
+
+    if(!KwmKeyboardLayoutBuilt || KwmGetKeyboardLayoutID() != KwmKeyboardLayout)
+    {
+        KwmBuildKeyboardLayoutTable();
+        KwmRemapHotkeys();
+    }
+
+    pthread_mutex_unlock(&KWMThread.Lock);
+}
+
+void KwmObserveKeyboardLayout()
+{
+    CFNotificationCenterAddObserver(CFNotificationCenterGetDistributedCenter(), NULL,
+                                    KwmKeyboardLayoutCallback,
+                                    kTISNotifySelectedKeyboardInputSourceChanged, NULL,
+                                    CFNotificationSuspensionBehaviorDeliverImmediately);
 }
 
 void KwmEmitKeystrokes(std::string Text)
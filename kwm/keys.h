@@ -4,15 +4,37 @@
 #include "types.h"
 
 bool HotkeysAreEqual(hotkey *A, hotkey *B);
-bool KwmIsPrefixKey(hotkey *PrefixKey, modifiers *Mod, CGKeyCode Keycode);
-bool HotkeyExists(modifiers Mod, CGKeyCode Keycode, hotkey *Hotkey);
+bool HotkeyBindingsAreEqual(hotkey *A, hotkey *B);
+unsigned int KwmGetModifierMask(modifiers *Mod);
+void KwmSetModifierMask(modifiers *Mod, unsigned int Mask);
+hotkey_slot *KwmFindHotkeySlot(hotkey_table *Table, int Node, unsigned int Mask, CGKeyCode Keycode);
+hotkey_slot *KwmClaimHotkeySlot(hotkey_table *Table, int Node, unsigned int Mask, CGKeyCode Keycode);
+int KwmCreateHotkeyNode(hotkey_table *Table, double Timeout, bool Sticky);
+bool KwmInsertHotkey(hotkey_table *Table, hotkey *Hotkey, int Index, std::string &Error);
+hotkey_table *KwmGetHotkeyTable();
+hotkey_table *KwmBeginHotkeyTableUpdate(bool Copy);
+void KwmPublishHotkeyTable(hotkey_table *Table);
+void KwmRebuildHotkeyTable();
+void KwmClearHotkeys();
+bool KwmProcessKeyEvent(hotkey_table *Table, modifiers Mod, CGKeyCode Keycode, bool *Passthrough);
+bool KwmProcessKeyEvent(modifiers Mod, CGKeyCode Keycode, bool *Passthrough);
+hotkey *KwmFindHotkey(int Node, unsigned int Mask, CGKeyCode Keycode);
 void DetermineHotkeyState(hotkey *Hotkey, std::string &Command);
+void KwmCompileHotkeyOwners(hotkey *Hotkey);
+bool KwmHotkeyListsOwner(hotkey *Hotkey, unsigned int Atom);
 bool IsHotkeyStateReqFulfilled(hotkey *Hotkey);
 
-bool ShouldKeyBeProcessed(hotkey *Hotkey);
+long long KwmGetKeyTime();
+void KwmResetKeySequence();
+double KwmGetKeySequenceTimeout();
+void KwmExpireKeySequence();
+void KwmUpdatePrefixState();
+
 void CreateHotkeyFromCGEvent(CGEventRef Event, hotkey *Hotkey);
+std::vector<std::string> KwmSplitKeySequence(const std::string &KeySym);
+bool KwmParseKeyStep(std::string Step, bool First, modifiers *Mod, CGKeyCode *Keycode, bool *Prefixed);
 bool KwmParseHotkey(std::string KeySym, std::string Command, hotkey *Hotkey, bool Passthrough);
-void KwmAddHotkey(std::string KeySym, std::string Command, bool Passthrough);
+bool KwmAddHotkey(std::string KeySym, std::string Command, bool Passthrough, std::string &Error);
 void KwmRemoveHotkey(std::string KeySym);
 void KwmExecuteHotkey(hotkey *Hotkey);
 void *KwmMainHotkeyTrigger(void *EventPtr);
@@ -24,10 +46,15 @@ void KwmSetSpacesKey(std::string KeySym);
 void KwmSetPrefix(std::string KeySym);
 void KwmSetPrefixGlobal(bool Global);
 void KwmSetPrefixTimeout(double Timeout);
-void CheckPrefixTimeout();
+void KwmSetSequenceTimeout(double Timeout);
 
-CFStringRef KeycodeToString(CGKeyCode Keycode);
 bool KeycodeForChar(char Key, CGKeyCode *Keycode);
+bool KwmGetCachedKeycode(char Key, CGKeyCode *Keycode);
+void KwmSetCachedKeycode(char Key, CGKeyCode Keycode);
+std::string KwmGetKeyboardLayoutID();
 bool GetLayoutIndependentKeycode(std::string Key, CGKeyCode *Keycode);
+void KwmBuildKeyboardLayoutTable();
+void KwmRemapHotkeys();
+void KwmObserveKeyboardLayout();
 
 #endif
@@ -7,6 +7,11 @@
 #include "keys.h"
 #include "interpreter.h"
 #include "border.h"
+#include "state.h"
+#include "config.h"
+#include "define.h"
+#include "startup.h"
+#include "rules.h"
 
 const std::string KwmCurrentVersion = "Kwm Version 2.2.0";
 
@@ -42,14 +47,11 @@ CGEventRef CGEventCallback(CGEventTapProxy Proxy, CGEventType Type, CGEventRef E
         {
             if(KWMToggles.UseBuiltinHotkeys)
             {
-                hotkey Eventkey = {}, Hotkey = {};
+                hotkey Eventkey = {};
+                bool Passthrough = false;
                 CreateHotkeyFromCGEvent(Event, &Eventkey);
-                if(HotkeyExists(Eventkey.Mod, Eventkey.Key, &Hotkey))
-                {
-                    KWMHotkeys.Queue.push(Hotkey);
-                    if(!Hotkey.Passthrough)
-                        return NULL;
-                }
+                if(KwmProcessKeyEvent(Eventkey.Mod, Eventkey.Key, &Passthrough) && !Passthrough)
+                    return NULL;
             }
 
             if(KWMMode.Focus == FocusModeAutofocus &&
@@ -95,6 +97,7 @@ void KwmQuit()
     CloseBorder(&FocusedBorder);
     CloseBorder(&MarkedBorder);
     CloseBorder(&PrefixBorder);
+    KwmCloseStatePage();
 
     exit(0);
 }
@@ -106,8 +109,6 @@ void * KwmWindowMonitor(void*)
         if(KWMTiling.MonitorWindows)
         {
             pthread_mutex_lock(&KWMThread.Lock);
-            CheckPrefixTimeout();
-
             if(!IsSpaceTransitionInProgress() &&
                IsActiveSpaceManaged())
             {
@@ -117,6 +118,7 @@ void * KwmWindowMonitor(void*)
                     UpdateWindowTree();
             }
 
+            KwmFlushPendingEvents();
             pthread_mutex_unlock(&KWMThread.Lock);
         }
 
@@ -124,34 +126,35 @@ void * KwmWindowMonitor(void*)
     }
 }
 
-void KwmDefineVariable(std::map<std::string, std::string> &Defines, std::string Line)
+void KwmDefineVariable(kwm_defines *Defines, std::string Line)
 {
     std::vector<std::string> Tokens = SplitString(Line, ' ');
+    if(Tokens.empty())
+        return;
+
     std::string Value = CreateStringFromTokens(Tokens, 1);
-    Defines[Tokens[0]] = Value;
+    KwmAddDefine(Defines, Tokens[0], Value);
 }
 
-void KwmSubstitueVariables(std::map<std::string, std::string> &Defines, std::string &Line)
+void KwmSubstitueVariables(kwm_defines *Defines, std::string &Line)
 {
-    if(Line.substr(0, 6) == "define")
+    if(Line.compare(0, 6, "define") == 0)
         return;
 
-    std::map<std::string, std::string>::iterator It;
-    for(It = Defines.begin(); It != Defines.end(); ++It)
-    {
-        std::size_t Pos = Line.find(It->first);
-        if(Pos != std::string::npos)
-        {
-            DEBUG("Replacing " << It->first << " with " << It->second);
-            Line.replace(Pos, It->first.size(), It->second);
-        }
-    }
+    if(KwmSubstituteDefines(Defines, Line))
+        DEBUG("Substituted defines: " << Line);
 }
 
-void KwmReloadConfig()
+void KwmReloadConfig(std::string &Report)
 {
+    config_settings Previous;
+    KwmSaveConfigSettings(&Previous);
+
     KwmClearSettings();
     KwmExecuteConfig();
+
+    KwmDiffConfigSettings(&Previous, Report);
+    DEBUG("KwmReloadConfig() " << Report);
 }
 
 void KwmClearSettings()
@@ -166,12 +169,11 @@ void KwmClearSettings()
         WindowRoles.clear();
     }
 
-    KWMHotkeys.List.clear();
-    KWMTiling.WindowRules.clear();
+    KWMHotkeys.Prefix.Enabled = false;
+    KwmClearHotkeys();
+    KwmClearRules();
     KWMTiling.SpaceSettings.clear();
     KWMTiling.DisplaySettings.clear();
-    KWMTiling.EnforcedWindows.clear();
-    KWMHotkeys.Prefix.Enabled = false;
 }
 
 void KwmExecuteConfig()
@@ -184,7 +186,18 @@ void KwmExecuteConfig()
     }
 
     KWMPath.EnvHome = HomeP;
-    KwmExecuteFile(KWMPath.ConfigFile);
+    kwm_time_point Start = std::chrono::steady_clock::now();
+
+    bool FromCache = KwmExecuteConfigCache();
+    if(!FromCache)
+    {
+        KwmBeginConfigRecording();
+        KwmExecuteFile(KWMPath.ConfigFile);
+        KwmEndConfigRecording();
+    }
+
+    std::chrono::duration<double, std::milli> Duration = std::chrono::steady_clock::now() - Start;
+    KwmSetConfigLoadTime(Duration.count(), FromCache);
 }
 
 void KwmExecuteInitScript()
@@ -198,7 +211,10 @@ void KwmExecuteInitScript()
 
 void KwmExecuteFile(std::string File)
 {
-    std::ifstream FileHandle(KWMPath.EnvHome + "/" + KWMPath.ConfigFolder + "/" + File);
+    std::string FilePath = KWMPath.EnvHome + "/" + KWMPath.ConfigFolder + "/" + File;
+    KwmRecordConfigSource(FilePath);
+
+    std::ifstream FileHandle(FilePath);
     if(FileHandle.fail())
     {
         DEBUG("Could not open " << KWMPath.EnvHome << "/" << KWMPath.ConfigFolder << "/" << File
@@ -207,20 +223,27 @@ void KwmExecuteFile(std::string File)
     }
 
     std::string Line;
-    std::map<std::string, std::string> Defines;
+    kwm_defines Defines;
+    KwmInitDefines(&Defines);
     while(std::getline(FileHandle, Line))
     {
         if(!Line.empty() && Line[0] != '#')
         {
-            KwmSubstitueVariables(Defines, Line);
+            KwmSubstitueVariables(&Defines, Line);
             if(IsPrefixOfString(Line, "kwmc"))
+            {
+                KwmRecordConfigLine(ConfigLineCommand, Line);
                 KwmInterpretCommand(Line, 0);
+            }
             else if(IsPrefixOfString(Line, "sys"))
+            {
+                KwmRecordConfigLine(ConfigLineSystem, Line);
                 KwmExecuteThreadedSystemCommand(Line);
+            }
             else if(IsPrefixOfString(Line, "include"))
                 KwmExecuteFile(Line);
             else if(IsPrefixOfString(Line, "define"))
-                KwmDefineVariable(Defines, Line);
+                KwmDefineVariable(&Defines, Line);
         }
     }
 
@@ -264,18 +287,45 @@ bool GetKwmFilePath()
     return Result;
 }
 
+void * KwmEnumerateDisplaysBG(void *List)
+{
+    KwmBeginStartupPhase(StartupPhaseDisplays);
+    EnumerateActiveDisplays((display_list *) List);
+    KwmEndStartupPhase(StartupPhaseDisplays);
+    return NULL;
+}
+
+void * KwmCopyWindowListBG(void *Snapshot)
+{
+    KwmBeginStartupPhase(StartupPhaseWindowList);
+    *((CFArrayRef *) Snapshot) = CopyOnScreenWindowList();
+    KwmEndStartupPhase(StartupPhaseWindowList);
+    return NULL;
+}
+
+/* Executing the config, enumerating the displays and copying the window list do
+ * not depend on each other, so the latter two run on their own threads while the
+ * config is executed on this one. Settings from the config are applied to the
+ * displays after the join, and the first layout is created right away from the
+ * copied window list instead of waiting for the window monitor. */
 void KwmInit()
 {
+    KwmBeginStartup();
+    KwmBeginStartupPhase(StartupPhasePrivileges);
     if(!CheckPrivileges())
         Fatal("Could not access OSX Accessibility!");
+    KwmEndStartupPhase(StartupPhasePrivileges);
 
     if (pthread_mutex_init(&KWMThread.Lock, NULL) != 0)
         Fatal("Could not create mutex!");
 
+    KwmBeginStartupPhase(StartupPhaseDaemon);
+    KwmInitInterpreter();
     if(KwmStartDaemon())
         pthread_create(&KWMThread.Daemon, NULL, &KwmDaemonHandleConnectionBG, NULL);
     else
         Fatal("Kwm: Could not start daemon..");
+    KwmEndStartupPhase(StartupPhaseDaemon);
 
     signal(SIGSEGV, SignalHandler);
     signal(SIGABRT, SignalHandler);
@@ -300,10 +350,13 @@ void KwmInit()
     KWMMode.Focus = FocusModeAutoraise;
     KWMMode.Cycle = CycleModeScreen;
 
+    KwmInitKeyQueue(&KWMHotkeys.Queue);
     KWMHotkeys.Prefix.Enabled = false;
     KWMHotkeys.Prefix.Global = false;
     KWMHotkeys.Prefix.Active = false;
     KWMHotkeys.Prefix.Timeout = 0.75;
+    KWMHotkeys.SequenceTimeout = 1.0;
+    KwmRebuildHotkeyTable();
 
     FocusedBorder.Radius = -1;
     MarkedBorder.Radius = -1;
@@ -314,13 +367,44 @@ void KwmInit()
     KWMPath.BSPLayouts = "layouts";
 
     GetKwmFilePath();
+
+    pthread_t DisplayThread, WindowListThread;
+    display_list Displays;
+    CFArrayRef Snapshot = NULL;
+    pthread_create(&DisplayThread, NULL, &KwmEnumerateDisplaysBG, &Displays);
+    pthread_create(&WindowListThread, NULL, &KwmCopyWindowListBG, &Snapshot);
+
+    KwmBeginStartupPhase(StartupPhaseConfig);
     KwmExecuteConfig();
-    GetActiveDisplays();
+    KwmEndStartupPhase(StartupPhaseConfig);
+
+    pthread_join(DisplayThread, NULL);
+    pthread_join(WindowListThread, NULL);
+
+    KwmBeginStartupPhase(StartupPhaseStatePage);
+    KwmOpenStatePage();
+    KwmEndStartupPhase(StartupPhaseStatePage);
+
+    KwmBeginStartupPhase(StartupPhaseFirstLayout);
+    pthread_mutex_lock(&KWMThread.Lock);
+    GetActiveDisplays(&Displays);
+    SetWindowListSnapshot(Snapshot);
+    UpdateWindowTree();
+    SetWindowListSnapshot(NULL);
+    pthread_mutex_unlock(&KWMThread.Lock);
+    KwmEndStartupPhase(StartupPhaseFirstLayout);
+
+    KwmBeginStartupPhase(StartupPhaseInitScript);
     KwmExecuteInitScript();
+    KwmEndStartupPhase(StartupPhaseInitScript);
 
     pthread_create(&KWMThread.WindowMonitor, NULL, &KwmWindowMonitor, NULL);
     pthread_create(&KWMThread.Hotkey, NULL, &KwmMainHotkeyTrigger, NULL);
     FocusWindowOfOSX();
+
+    KwmEndStartup();
+    if(KWMToggles.StartupReport)
+        std::cout << KwmCreateStartupReport() << std::endl;
 }
 
 bool CheckPrivileges()
@@ -353,6 +437,10 @@ bool CheckArguments(int argc, char **argv)
             std::cout << KwmCurrentVersion << std::endl;
             Result = true;
         }
+        else if(Arg == "--startup-report")
+        {
+            KWMToggles.StartupReport = true;
+        }
     }
 
     return Result;
@@ -394,6 +482,7 @@ int main(int argc, char **argv)
 
     CGEventTapEnable(KWMMach.EventTap, true);
     CreateWorkspaceWatcher(KWMMach.WorkspaceWatcher);
+    KwmObserveKeyboardLayout();
 
     NSApplicationLoad();
     CFRunLoopRun();
@@ -2,6 +2,7 @@
 #define KWM_H
 
 #include "types.h"
+#include "define.h"
 
 extern "C" void NSApplicationLoad(void);
 extern void CreateWorkspaceWatcher(void *Watcher);
@@ -15,10 +16,10 @@ void KwmExecuteSystemCommand(std::string Command);
 void KwmExecuteConfig();
 void KwmExecuteInitScript();
 void KwmExecuteFile(std::string File);
-void KwmReloadConfig();
+void KwmReloadConfig(std::string &Report);
 void KwmClearSettings();
-void KwmSubstitueVariables(std::map<std::string, std::string> &Defines, std::string &Line);
-void KwmDefineVariable(std::map<std::string, std::string> &Defines, std::string Line);
+void KwmSubstitueVariables(kwm_defines *Defines, std::string &Line);
+void KwmDefineVariable(kwm_defines *Defines, std::string Line);
 
 void KwmInit();
 void KwmQuit();
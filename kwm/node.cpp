@@ -3,6 +3,7 @@
 #include "tree.h"
 #include "space.h"
 #include "window.h"
+#include "daemon.h"
 
 extern kwm_screen KWMScreen;
 extern kwm_tiling KWMTiling;
@@ -260,6 +261,7 @@ void ResizeWindowToContainerSize(tree_node *Node)
             SetWindowDimensions(WindowRef, Window,
                         Node->Container.X, Node->Container.Y,
                         Node->Container.Width, Node->Container.Height);
+            KwmMarkEventPending(EventTypeTree);
 
             if(WindowsAreEqual(Window, KWMFocus.Window))
                 KWMFocus.Cache = *Window;
@@ -279,6 +281,7 @@ void ResizeWindowToContainerSize(link_node *Link)
             SetWindowDimensions(WindowRef, Window,
                         Link->Container.X, Link->Container.Y,
                         Link->Container.Width, Link->Container.Height);
+            KwmMarkEventPending(EventTypeTree);
 
             if(WindowsAreEqual(Window, KWMFocus.Window))
                 KWMFocus.Cache = *Window;
@@ -346,10 +349,10 @@ void ModifyContainerSplitRatio(double Offset, int Degrees)
         tree_node *Node = GetTreeNodeFromWindowIDOrLinkNode(Root, KWMFocus.Window->WID);
         if(Node)
         {
-            window_info WindowInDirection = {};
+            window_info *WindowInDirection = NULL;
             if(FindClosestWindow(Degrees, &WindowInDirection, false))
             {
-                tree_node *Target = GetTreeNodeFromWindowIDOrLinkNode(Root, WindowInDirection.WID);
+                tree_node *Target = GetTreeNodeFromWindowIDOrLinkNode(Root, WindowInDirection->WID);
                 tree_node *Ancestor = FindLowestCommonAncestor(Node, Target);
                 if(Ancestor &&
                    Ancestor->SplitRatio + Offset > 0.0 &&
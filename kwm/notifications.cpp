@@ -3,6 +3,7 @@
 #include "space.h"
 #include "window.h"
 #include "border.h"
+#include "daemon.h"
 
 extern kwm_screen KWMScreen;
 extern kwm_toggles KWMToggles;
@@ -17,7 +18,10 @@ void FocusedAXObserverCallback(AXObserverRef Observer, AXUIElementRef Element, C
 
     window_info *Window = KWMFocus.Window;
     if(Window && CFEqual(Notification, kAXTitleChangedNotification))
+    {
         Window->Name = GetWindowTitle(Element);
+        KwmEmitEvent(EventTypeFocus);
+    }
     else if(CFEqual(Notification, kAXFocusedWindowChangedNotification))
     {
         if(!Window || Window->WID != GetWindowIDFromRef(Element))
@@ -59,14 +63,14 @@ void FocusedAXObserverCallback(AXObserverRef Observer, AXUIElementRef Element, C
         if(KWMTiling.LockToContainer)
             LockWindowToContainerSize(Window);
 
-        UpdateBorder("focused");
+        UpdateBorder(BorderTypeFocused);
         if(Window && Window->WID == KWMScreen.MarkedWindow)
-            UpdateBorder("marked");
+            UpdateBorder(BorderTypeMarked);
     }
     else if(CFEqual(Notification, kAXUIElementDestroyedNotification) ||
             CFEqual(Notification, kAXWindowMiniaturizedNotification))
     {
-        UpdateBorder("focused");
+        UpdateBorder(BorderTypeFocused);
         if(Window && Window->WID == KWMScreen.MarkedWindow)
             ClearMarkedWindow();
     }
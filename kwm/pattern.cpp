@@ -0,0 +1,146 @@
+#include "pattern.h"
+
+void KwmInitPatternSet(kwm_pattern_set *Set)
+{
+    pattern_node Root = { 0, -1, -1, 0, -1, -1 };
+    Set->Nodes.clear();
+    Set->Ids.clear();
+    Set->Nodes.push_back(Root);
+    Set->Count = 0;
+    Set->Seen.clear();
+    Set->Stamp = 0;
+    for(int Index = 0; Index < 256; ++Index)
+        Set->Root[Index] = 0;
+}
+
+int KwmFindPatternChild(kwm_pattern_set *Set, int Node, char Key)
+{
+    if(Node == 0)
+    {
+        int Child = Set->Root[(unsigned char) Key];
+        return Child ? Child : -1;
+    }
+
+    int Child = Set->Nodes[Node].Child;
+    while(Child != -1 && Set->Nodes[Child].Key != Key)
+        Child = Set->Nodes[Child].Sibling;
+
+    return Child;
+}
+
+int KwmAddPattern(kwm_pattern_set *Set, const std::string &Pattern)
+{
+    if(Pattern.empty())
+        return -1;
+
+    std::map<std::string, int>::iterator It = Set->Ids.find(Pattern);
+    if(It != Set->Ids.end())
+        return It->second;
+
+    int Node = 0;
+    for(std::size_t Index = 0; Index < Pattern.size(); ++Index)
+    {
+        int Child = KwmFindPatternChild(Set, Node, Pattern[Index]);
+        if(Child == -1)
+        {
+            pattern_node NewNode = { Pattern[Index], -1, Set->Nodes[Node].Child, 0, -1, -1 };
+            Child = Set->Nodes.size();
+            Set->Nodes.push_back(NewNode);
+            Set->Nodes[Node].Child = Child;
+            if(Node == 0)
+                Set->Root[(unsigned char) Pattern[Index]] = Child;
+        }
+
+        Node = Child;
+    }
+
+    int Id = Set->Count++;
+    Set->Nodes[Node].Pattern = Id;
+    Set->Ids[Pattern] = Id;
+    Set->Seen.push_back(0);
+    return Id;
+}
+
+/* Nodes are visited breadth first, so the failure link of a parent is always known
+ * before its children are processed. Output points at the nearest node on the
+ * failure chain that ends a pattern, which lets matching report every pattern that
+ * ends at a position without walking the whole chain. */
+void KwmBuildPatternSet(kwm_pattern_set *Set)
+{
+    std::vector<int> Queue;
+    Queue.reserve(Set->Nodes.size());
+
+    for(int Child = Set->Nodes[0].Child; Child != -1; Child = Set->Nodes[Child].Sibling)
+    {
+        Set->Nodes[Child].Fail = 0;
+        Set->Nodes[Child].Output = -1;
+        Queue.push_back(Child);
+    }
+
+    for(std::size_t Head = 0; Head < Queue.size(); ++Head)
+    {
+        int Node = Queue[Head];
+        for(int Child = Set->Nodes[Node].Child; Child != -1; Child = Set->Nodes[Child].Sibling)
+        {
+            char Key = Set->Nodes[Child].Key;
+            int Fail = Set->Nodes[Node].Fail;
+            int Next = KwmFindPatternChild(Set, Fail, Key);
+            while(Next == -1 && Fail != 0)
+            {
+                Fail = Set->Nodes[Fail].Fail;
+                Next = KwmFindPatternChild(Set, Fail, Key);
+            }
+
+            Next = Next == -1 ? 0 : Next;
+            Set->Nodes[Child].Fail = Next;
+            Set->Nodes[Child].Output = Set->Nodes[Next].Pattern != -1 ? Next : Set->Nodes[Next].Output;
+            Queue.push_back(Child);
+        }
+    }
+}
+
+void KwmReportPattern(kwm_pattern_set *Set, int Pattern, std::vector<int> *Found)
+{
+    if(Set->Seen[Pattern] != Set->Stamp)
+    {
+        Set->Seen[Pattern] = Set->Stamp;
+        Found->push_back(Pattern);
+    }
+}
+
+bool KwmPatternWasFound(kwm_pattern_set *Set, int Pattern)
+{
+    return Pattern != -1 && Set->Seen[Pattern] == Set->Stamp;
+}
+
+void KwmMatchPatternSet(kwm_pattern_set *Set, const std::string &Text, std::vector<int> *Found)
+{
+    Found->clear();
+    if(Set->Count == 0)
+        return;
+
+    if(++Set->Stamp == 0)
+    {
+        Set->Seen.assign(Set->Seen.size(), 0);
+        Set->Stamp = 1;
+    }
+
+    int Node = 0;
+    for(std::size_t Index = 0; Index < Text.size(); ++Index)
+    {
+        char Key = Text[Index];
+        int Next = KwmFindPatternChild(Set, Node, Key);
+        while(Next == -1 && Node != 0)
+        {
+            Node = Set->Nodes[Node].Fail;
+            Next = KwmFindPatternChild(Set, Node, Key);
+        }
+
+        Node = Next == -1 ? 0 : Next;
+        if(Set->Nodes[Node].Pattern != -1)
+            KwmReportPattern(Set, Set->Nodes[Node].Pattern, Found);
+
+        for(int Output = Set->Nodes[Node].Output; Output != -1; Output = Set->Nodes[Output].Output)
+            KwmReportPattern(Set, Set->Nodes[Output].Pattern, Found);
+    }
+}
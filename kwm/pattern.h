@@ -0,0 +1,44 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+/* A pattern set finds which of a fixed set of substrings occur in a text, in one
+ * pass over the text no matter how many patterns there are (Aho-Corasick). Patterns
+ * are added first, KwmBuildPatternSet creates the failure links, and matching then
+ * reports the id of every distinct pattern found. Until the next match,
+ * KwmPatternWasFound answers whether a given pattern was among them.
+ *
+ * Children of a node are kept in a sibling list; the root has a direct table since
+ * nearly every character of the text starts at the root. */
+
+struct pattern_node
+{
+    char Key;
+    int Child;
+    int Sibling;
+    int Fail;
+    int Output;
+    int Pattern;
+};
+
+struct kwm_pattern_set
+{
+    std::vector<pattern_node> Nodes;
+    std::map<std::string, int> Ids;
+    int Root[256];
+    int Count;
+
+    std::vector<unsigned int> Seen;
+    unsigned int Stamp;
+};
+
+void KwmInitPatternSet(kwm_pattern_set *Set);
+int KwmAddPattern(kwm_pattern_set *Set, const std::string &Pattern);
+void KwmBuildPatternSet(kwm_pattern_set *Set);
+void KwmMatchPatternSet(kwm_pattern_set *Set, const std::string &Text, std::vector<int> *Found);
+bool KwmPatternWasFound(kwm_pattern_set *Set, int Pattern);
+
+#endif
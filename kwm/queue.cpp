@@ -0,0 +1,87 @@
+#include "queue.h"
+
+#include <errno.h>
+#include <time.h>
+
+void KwmInitKeyQueue(kwm_key_queue *Queue)
+{
+    Queue->Head.store(0, std::memory_order_relaxed);
+    Queue->Tail.store(0, std::memory_order_relaxed);
+    Queue->Dropped.store(0, std::memory_order_relaxed);
+
+#ifdef __APPLE__
+    Queue->Signal = dispatch_semaphore_create(0);
+#else
+    sem_init(&Queue->Signal, 0, 0);
+#endif
+}
+
+/* Head and Tail count pushes and pops and are only reduced to an index when
+ * an event is stored or read; the ring is full when they are a whole ring apart. */
+bool KwmPushKeyEvent(kwm_key_queue *Queue, kwm_key_event *Event)
+{
+    unsigned int Tail = Queue->Tail.load(std::memory_order_relaxed);
+    unsigned int Head = Queue->Head.load(std::memory_order_acquire);
+    if(Tail - Head == KWM_KEY_QUEUE_SIZE)
+    {
+        Queue->Dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Queue->Events[Tail & (KWM_KEY_QUEUE_SIZE - 1)] = *Event;
+    Queue->Tail.store(Tail + 1, std::memory_order_release);
+
+#ifdef __APPLE__
+    dispatch_semaphore_signal(Queue->Signal);
+#else
+    sem_post(&Queue->Signal);
+#endif
+
+    return true;
+}
+
+bool KwmPopKeyEvent(kwm_key_queue *Queue, kwm_key_event *Event)
+{
+    unsigned int Head = Queue->Head.load(std::memory_order_relaxed);
+    unsigned int Tail = Queue->Tail.load(std::memory_order_acquire);
+    if(Head == Tail)
+        return false;
+
+    *Event = Queue->Events[Head & (KWM_KEY_QUEUE_SIZE - 1)];
+    Queue->Head.store(Head + 1, std::memory_order_release);
+    return true;
+}
+
+/* The semaphore is signalled once per push, so after draining the ring the
+ * consumer may wake up a few times to find it empty; it never misses an event.
+ * A negative timeout waits forever, otherwise the wait gives up after Timeout
+ * seconds and returns false. */
+bool KwmWaitForKeyEvent(kwm_key_queue *Queue, double Timeout)
+{
+#ifdef __APPLE__
+    dispatch_time_t Deadline = Timeout < 0 ? DISPATCH_TIME_FOREVER :
+                               dispatch_time(DISPATCH_TIME_NOW, (int64_t) (Timeout * NSEC_PER_SEC));
+    return dispatch_semaphore_wait(Queue->Signal, Deadline) == 0;
+#else
+    if(Timeout < 0)
+    {
+        while(sem_wait(&Queue->Signal) == -1 && errno == EINTR);
+        return true;
+    }
+
+    struct timespec Deadline;
+    clock_gettime(CLOCK_REALTIME, &Deadline);
+    long long Nanoseconds = Deadline.tv_nsec + (long long) (Timeout * 1000000000.0);
+    Deadline.tv_sec += Nanoseconds / 1000000000;
+    Deadline.tv_nsec = Nanoseconds % 1000000000;
+
+    int Result;
+    while((Result = sem_timedwait(&Queue->Signal, &Deadline)) == -1 && errno == EINTR);
+    return Result == 0;
+#endif
+}
+
+unsigned int KwmGetDroppedKeyEvents(kwm_key_queue *Queue)
+{
+    return Queue->Dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,52 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <atomic>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+/* Key events travel from the event tap to the hotkey thread through a bounded
+ * single-producer/single-consumer ring. Each side owns one index, so a push or a
+ * pop is a load, a store and an atomic release; neither side ever takes a lock.
+ * Every push signals a counting semaphore that the consumer sleeps on once the
+ * ring is empty, so a key is handled as soon as the hotkey thread is scheduled.
+ *
+ * The producer must never block the event tap: when the ring is full the event
+ * is dropped and counted instead. */
+
+#define KWM_KEY_QUEUE_SIZE 256
+#define KWM_CACHE_LINE 64
+
+struct kwm_key_event
+{
+    unsigned int Mod;
+    unsigned short Key;
+    int Node;
+    bool Transition;
+};
+
+struct kwm_key_queue
+{
+    alignas(KWM_CACHE_LINE) std::atomic<unsigned int> Head;
+    alignas(KWM_CACHE_LINE) std::atomic<unsigned int> Tail;
+    alignas(KWM_CACHE_LINE) std::atomic<unsigned int> Dropped;
+    kwm_key_event Events[KWM_KEY_QUEUE_SIZE];
+
+#ifdef __APPLE__
+    dispatch_semaphore_t Signal;
+#else
+    sem_t Signal;
+#endif
+};
+
+void KwmInitKeyQueue(kwm_key_queue *Queue);
+bool KwmPushKeyEvent(kwm_key_queue *Queue, kwm_key_event *Event);
+bool KwmPopKeyEvent(kwm_key_queue *Queue, kwm_key_event *Event);
+bool KwmWaitForKeyEvent(kwm_key_queue *Queue, double Timeout);
+unsigned int KwmGetDroppedKeyEvents(kwm_key_queue *Queue);
+
+#endif
@@ -0,0 +1,446 @@
+#include "regex.h"
+
+#include <algorithm>
+#include <bitset>
+#include <map>
+#include <ctype.h>
+
+enum regex_state_type
+{
+    RegexStateChar,
+    RegexStateSplit,
+    RegexStateEmpty,
+    RegexStateMatch
+};
+
+struct regex_state
+{
+    regex_state_type Type;
+    int Set;
+    int Out;
+    int Out1;
+};
+
+struct regex_fragment
+{
+    int Start;
+    int End;
+};
+
+struct regex_parser
+{
+    const char *At;
+    const char *End;
+    std::vector<regex_state> States;
+    std::vector<std::bitset<256> > Sets;
+    std::string Error;
+
+    int Depth;
+    bool TopLevelAlternation;
+};
+
+int KwmAddRegexState(regex_parser *Parser, regex_state_type Type, int Set, int Out, int Out1)
+{
+    regex_state State = { Type, Set, Out, Out1 };
+    Parser->States.push_back(State);
+    return Parser->States.size() - 1;
+}
+
+regex_fragment KwmCreateRegexFragment(regex_parser *Parser, std::bitset<256> &Set)
+{
+    Parser->Sets.push_back(Set);
+    regex_fragment Fragment;
+    Fragment.End = KwmAddRegexState(Parser, RegexStateEmpty, -1, -1, -1);
+    Fragment.Start = KwmAddRegexState(Parser, RegexStateChar, Parser->Sets.size() - 1, Fragment.End, -1);
+    return Fragment;
+}
+
+regex_fragment KwmCreateEmptyRegexFragment(regex_parser *Parser)
+{
+    regex_fragment Fragment;
+    Fragment.Start = Fragment.End = KwmAddRegexState(Parser, RegexStateEmpty, -1, -1, -1);
+    return Fragment;
+}
+
+bool KwmParseRegexEscape(char C, std::bitset<256> &Set)
+{
+    bool Negate = C == 'D' || C == 'W' || C == 'S';
+    switch(C)
+    {
+        case 'd': case 'D':
+        {
+            for(int Char = '0'; Char <= '9'; ++Char)
+                Set.set(Char);
+        } break;
+        case 'w': case 'W':
+        {
+            for(int Char = 0; Char < 256; ++Char)
+                if(isalnum(Char) || Char == '_')
+                    Set.set(Char);
+        } break;
+        case 's': case 'S':
+        {
+            Set.set(' '); Set.set('\t'); Set.set('\n');
+            Set.set('\r'); Set.set('\f'); Set.set('\v');
+        } break;
+        default:
+        {
+            return false;
+        } break;
+    }
+
+    if(Negate)
+        Set.flip();
+
+    return true;
+}
+
+bool KwmParseRegexClass(regex_parser *Parser, std::bitset<256> &Set)
+{
+    bool Negate = false;
+    if(Parser->At < Parser->End && *Parser->At == '^')
+    {
+        Negate = true;
+        ++Parser->At;
+    }
+
+    bool First = true;
+    while(Parser->At < Parser->End && (*Parser->At != ']' || First))
+    {
+        First = false;
+        unsigned char Low = *Parser->At++;
+        if(Low == '\\' && Parser->At < Parser->End)
+        {
+            Low = *Parser->At++;
+            if(KwmParseRegexEscape(Low, Set))
+                continue;
+        }
+
+        unsigned char High = Low;
+        if(Parser->At + 1 < Parser->End && Parser->At[0] == '-' && Parser->At[1] != ']')
+        {
+            High = Parser->At[1];
+            Parser->At += 2;
+            if(High == '\\' && Parser->At < Parser->End)
+                High = *Parser->At++;
+        }
+
+        if(High < Low)
+        {
+            Parser->Error = "invalid range in character class";
+            return false;
+        }
+
+        for(int Char = Low; Char <= High; ++Char)
+            Set.set(Char);
+    }
+
+    if(Parser->At == Parser->End)
+    {
+        Parser->Error = "missing ']'";
+        return false;
+    }
+
+    ++Parser->At;
+    if(Negate)
+        Set.flip();
+
+    return true;
+}
+
+bool KwmParseRegexAlternation(regex_parser *Parser, regex_fragment *Result);
+
+bool KwmParseRegexAtom(regex_parser *Parser, regex_fragment *Result)
+{
+    char C = *Parser->At++;
+    std::bitset<256> Set;
+    switch(C)
+    {
+        case '(':
+        {
+            ++Parser->Depth;
+            if(!KwmParseRegexAlternation(Parser, Result))
+                return false;
+
+            --Parser->Depth;
+            if(Parser->At == Parser->End || *Parser->At != ')')
+            {
+                Parser->Error = "missing ')'";
+                return false;
+            }
+
+            ++Parser->At;
+            return true;
+        } break;
+        case '[':
+        {
+            if(!KwmParseRegexClass(Parser, Set))
+                return false;
+        } break;
+        case '.':
+        {
+            Set.set();
+        } break;
+        case '\\':
+        {
+            if(Parser->At == Parser->End)
+            {
+                Parser->Error = "trailing '\\'";
+                return false;
+            }
+
+            C = *Parser->At++;
+            if(!KwmParseRegexEscape(C, Set))
+                Set.set((unsigned char) C);
+        } break;
+        case '*': case '+': case '?':
+        {
+            Parser->Error = std::string("nothing to repeat before '") + C + "'";
+            return false;
+        } break;
+        default:
+        {
+            Set.set((unsigned char) C);
+        } break;
+    }
+
+    *Result = KwmCreateRegexFragment(Parser, Set);
+    return true;
+}
+
+bool KwmParseRegexRepeat(regex_parser *Parser, regex_fragment *Result)
+{
+    if(!KwmParseRegexAtom(Parser, Result))
+        return false;
+
+    while(Parser->At < Parser->End &&
+          (*Parser->At == '*' || *Parser->At == '+' || *Parser->At == '?'))
+    {
+        char C = *Parser->At++;
+        int End = KwmAddRegexState(Parser, RegexStateEmpty, -1, -1, -1);
+        int Split = KwmAddRegexState(Parser, RegexStateSplit, -1, Result->Start, End);
+        Parser->States[Result->End].Out = C == '?' ? End : Split;
+
+        if(C != '+')
+            Result->Start = Split;
+
+        Result->End = End;
+    }
+
+    return true;
+}
+
+bool KwmParseRegexConcatenation(regex_parser *Parser, regex_fragment *Result)
+{
+    *Result = KwmCreateEmptyRegexFragment(Parser);
+    while(Parser->At < Parser->End && *Parser->At != '|' && *Parser->At != ')')
+    {
+        regex_fragment Next;
+        if(!KwmParseRegexRepeat(Parser, &Next))
+            return false;
+
+        Parser->States[Result->End].Out = Next.Start;
+        Result->End = Next.End;
+    }
+
+    return true;
+}
+
+bool KwmParseRegexAlternation(regex_parser *Parser, regex_fragment *Result)
+{
+    if(!KwmParseRegexConcatenation(Parser, Result))
+        return false;
+
+    while(Parser->At < Parser->End && *Parser->At == '|')
+    {
+        if(Parser->Depth == 0)
+            Parser->TopLevelAlternation = true;
+
+        ++Parser->At;
+        regex_fragment Next;
+        if(!KwmParseRegexConcatenation(Parser, &Next))
+            return false;
+
+        int End = KwmAddRegexState(Parser, RegexStateEmpty, -1, -1, -1);
+        int Split = KwmAddRegexState(Parser, RegexStateSplit, -1, Result->Start, Next.Start);
+        Parser->States[Result->End].Out = End;
+        Parser->States[Next.End].Out = End;
+        Result->Start = Split;
+        Result->End = End;
+    }
+
+    return true;
+}
+
+/* Only character and match states are kept in a closure; the epsilon states
+ * in between are followed but do not distinguish two DFA states. */
+void KwmAddRegexClosure(regex_parser *Parser, int State, std::vector<char> &Visited, std::vector<int> &Closure)
+{
+    while(State != -1 && !Visited[State])
+    {
+        Visited[State] = 1;
+        regex_state *Current = &Parser->States[State];
+        if(Current->Type == RegexStateChar || Current->Type == RegexStateMatch)
+        {
+            Closure.push_back(State);
+            return;
+        }
+
+        if(Current->Type == RegexStateSplit)
+            KwmAddRegexClosure(Parser, Current->Out1, Visited, Closure);
+
+        State = Current->Out;
+    }
+}
+
+void KwmCreateRegexClasses(regex_parser *Parser, kwm_regex *Regex)
+{
+    std::map<std::string, int> Signatures;
+    for(int Char = 0; Char < 256; ++Char)
+    {
+        std::string Signature(Parser->Sets.size(), '0');
+        for(std::size_t Set = 0; Set < Parser->Sets.size(); ++Set)
+            if(Parser->Sets[Set].test(Char))
+                Signature[Set] = '1';
+
+        std::map<std::string, int>::iterator It = Signatures.find(Signature);
+        if(It == Signatures.end())
+            It = Signatures.insert(std::make_pair(Signature, (int) Signatures.size())).first;
+
+        Regex->Classes[Char] = It->second;
+    }
+
+    Regex->ClassCount = Signatures.size();
+}
+
+bool KwmCompileRegex(const std::string &Pattern, kwm_regex *Regex, std::string &Error)
+{
+    regex_parser Parser;
+    Parser.At = Pattern.c_str();
+    Parser.End = Parser.At + Pattern.size();
+    Parser.Depth = 0;
+    Parser.TopLevelAlternation = false;
+
+    Regex->Pattern = Pattern;
+    Regex->AnchorStart = Parser.At < Parser.End && *Parser.At == '^';
+    if(Regex->AnchorStart)
+        ++Parser.At;
+
+    Regex->AnchorEnd = Parser.End > Parser.At && Parser.End[-1] == '$' &&
+                       (Parser.End - 1 == Parser.At || Parser.End[-2] != '\\');
+    if(Regex->AnchorEnd)
+        --Parser.End;
+
+    regex_fragment Fragment;
+    if(!KwmParseRegexAlternation(&Parser, &Fragment))
+    {
+        Error = Parser.Error;
+        return false;
+    }
+
+    if(Parser.At != Parser.End)
+    {
+        Error = "unmatched ')'";
+        return false;
+    }
+
+    /* The anchors apply to the whole pattern, so '^a|b$' would silently mean
+     * '^(a|b)$'. The grouping has to be written out instead. */
+    if(Parser.TopLevelAlternation && (Regex->AnchorStart || Regex->AnchorEnd))
+    {
+        Error = "an anchored pattern must group its alternatives, as in '^(a|b)$'";
+        return false;
+    }
+
+    int Match = KwmAddRegexState(&Parser, RegexStateMatch, -1, -1, -1);
+    Parser.States[Fragment.End].Out = Match;
+    KwmCreateRegexClasses(&Parser, Regex);
+
+    std::vector<int> Initial;
+    std::vector<char> Visited(Parser.States.size(), 0);
+    KwmAddRegexClosure(&Parser, Fragment.Start, Visited, Initial);
+
+    std::map<std::vector<int>, int> Ids;
+    std::vector<std::vector<int> > Pending;
+    Regex->Table.clear();
+    Regex->Accept.clear();
+
+    std::sort(Initial.begin(), Initial.end());
+    Ids[Initial] = 0;
+    Pending.push_back(Initial);
+    Regex->Start = 0;
+
+    std::vector<int> Representatives(Regex->ClassCount, -1);
+    for(int Char = 255; Char >= 0; --Char)
+        Representatives[Regex->Classes[Char]] = Char;
+
+    for(std::size_t DState = 0; DState < Pending.size(); ++DState)
+    {
+        std::vector<int> Current = Pending[DState];
+        char Accepting = 0;
+        for(std::size_t Index = 0; Index < Current.size(); ++Index)
+            if(Parser.States[Current[Index]].Type == RegexStateMatch)
+                Accepting = 1;
+
+        Regex->Accept.push_back(Accepting);
+        for(int Class = 0; Class < Regex->ClassCount; ++Class)
+        {
+            int Char = Representatives[Class];
+            std::vector<int> Next;
+            Visited.assign(Parser.States.size(), 0);
+            for(std::size_t Index = 0; Index < Current.size(); ++Index)
+            {
+                regex_state *State = &Parser.States[Current[Index]];
+                if(State->Type == RegexStateChar && Parser.Sets[State->Set].test(Char))
+                    KwmAddRegexClosure(&Parser, State->Out, Visited, Next);
+            }
+
+            if(!Regex->AnchorStart)
+                KwmAddRegexClosure(&Parser, Fragment.Start, Visited, Next);
+
+            if(Next.empty())
+            {
+                Regex->Table.push_back(-1);
+                continue;
+            }
+
+            std::sort(Next.begin(), Next.end());
+            std::map<std::vector<int>, int>::iterator It = Ids.find(Next);
+            if(It == Ids.end())
+            {
+                if(Pending.size() >= KWM_REGEX_MAX_STATES)
+                {
+                    Error = "pattern is too complex";
+                    return false;
+                }
+
+                It = Ids.insert(std::make_pair(Next, (int) Pending.size())).first;
+                Pending.push_back(Next);
+            }
+
+            Regex->Table.push_back(It->second);
+        }
+    }
+
+    return true;
+}
+
+bool KwmMatchRegex(kwm_regex *Regex, const std::string &Text)
+{
+    int State = Regex->Start;
+    if(Regex->Accept[State] && !Regex->AnchorEnd)
+        return true;
+
+    const int *Table = &Regex->Table[0];
+    for(std::size_t Index = 0; Index < Text.size(); ++Index)
+    {
+        State = Table[State * Regex->ClassCount + Regex->Classes[(unsigned char) Text[Index]]];
+        if(State == -1)
+            return false;
+
+        if(Regex->Accept[State] && !Regex->AnchorEnd)
+            return true;
+    }
+
+    return Regex->Accept[State];
+}
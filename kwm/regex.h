@@ -0,0 +1,49 @@
+#ifndef REGEX_H
+#define REGEX_H
+
+#include <string>
+#include <vector>
+
+/* A small regular expression matcher used by window rules. The pattern is parsed
+ * into a Thompson NFA which is turned into a DFA right away, so matching costs one
+ * table lookup per character of the text and never backtracks.
+ *
+ * Supported syntax:
+ *
+ *     abc             literal characters
+ *     .               any character
+ *     [a-z] [^0-9]    character classes, with ranges and negation
+ *     \d \w \s        digits, word characters and whitespace (\D \W \S negated)
+ *     \x              any other escaped character is taken literally
+ *     (..)            grouping
+ *     a|b             alternation
+ *     * + ?           repetition
+ *     ^ $             anchors, only as the first and last character of the pattern
+ *
+ * A pattern matches if it matches any part of the text, unless it is anchored.
+ * An anchor applies to the whole pattern, so an anchored pattern must put its
+ * alternatives in a group: '^(Safari|Mail)$' is accepted, '^Safari|Mail$' is
+ * rejected rather than read as either '^(Safari|Mail)$' or '(^Safari)|(Mail$)'.
+ * Bytes are mapped to the classes the pattern can tell apart, which keeps the
+ * transition table small. */
+
+#define KWM_REGEX_MAX_STATES 4096
+
+struct kwm_regex
+{
+    std::string Pattern;
+    bool AnchorStart;
+    bool AnchorEnd;
+
+    unsigned char Classes[256];
+    int ClassCount;
+
+    int Start;
+    std::vector<int> Table;
+    std::vector<char> Accept;
+};
+
+bool KwmCompileRegex(const std::string &Pattern, kwm_regex *Regex, std::string &Error);
+bool KwmMatchRegex(kwm_regex *Regex, const std::string &Text);
+
+#endif
@@ -5,6 +5,9 @@
 #include "window.h"
 #include "tree.h"
 #include "helpers.h"
+#include "regex.h"
+
+#include <algorithm>
 
 extern int GetNumberOfSpacesOfDisplay(screen_info *Screen);
 extern void AddWindowToSpace(int CGSpaceID, int WindowID);
@@ -15,6 +18,20 @@ extern int GetCGSpaceIDFromSpaceNumber(screen_info *Screen, int SpaceID);
 extern kwm_screen KWMScreen;
 extern kwm_tiling KWMTiling;
 
+#define KWM_RULE_MEMO_MAX_ENTRIES 1024
+
+unsigned int KwmRuleGeneration = 1;
+rule_index KwmRuleIndex = {};
+
+std::map<std::string, kwm_regex> KwmRuleRegexes;
+std::unordered_map<std::string, unsigned int> KwmOwnerAtoms;
+unsigned int KwmOwnerAtomCount = 0;
+std::unordered_map<unsigned long long, rule_memo_entry> KwmRuleMemo;
+unsigned int KwmRuleMemoEntries = 0;
+unsigned int KwmRuleMemoHits = 0;
+unsigned int KwmRuleMemoMisses = 0;
+rule_stats KwmRuleStats = {};
+
 /* Current Window Properties:
  *          float = "true" | "false"
  *          display = "id"
@@ -39,6 +56,10 @@ extern kwm_tiling KWMTiling;
  *
  * Assign iTunes to space 1 of display 1
  *          kwmc rule owner="iTunes" properties={space="1"; display="1"}
+ *
+ * Owner and name also accept a regular expression between slashes (see regex.h).
+ * Float the preference windows of every application
+ *          kwmc rule name=/^(Preferences|Settings)( - .*)?$/ properties={float="true"}
 */
 
 bool ParseIdentifier(tokenizer *Tokenizer, std::string *Member)
@@ -70,6 +91,58 @@ bool ParseIdentifier(tokenizer *Tokenizer, std::string *Member)
     return false;
 }
 
+/* Regular expressions are compiled once per distinct pattern and never freed, so
+ * rules (and the copies kept by a config reload) can point at them directly. */
+kwm_regex *KwmGetRuleRegex(const std::string &Pattern)
+{
+    std::map<std::string, kwm_regex>::iterator It = KwmRuleRegexes.find(Pattern);
+    if(It != KwmRuleRegexes.end())
+        return &It->second;
+
+    kwm_regex Regex;
+    std::string Error;
+    if(!KwmCompileRegex(Pattern, &Regex, Error))
+    {
+        DEBUG("Invalid regular expression /" << Pattern << "/: " << Error);
+        return NULL;
+    }
+
+    return &(KwmRuleRegexes[Pattern] = Regex);
+}
+
+bool ParseMatcher(tokenizer *Tokenizer, std::string *Member, kwm_regex **Regex)
+{
+    if(RequireToken(Tokenizer, Token_Equals))
+    {
+        token Token = GetToken(Tokenizer);
+        switch(Token.Type)
+        {
+            case Token_String:
+            {
+                *Member = std::string(Token.Text, Token.TextLength);
+                *Regex = NULL;
+                return true;
+            } break;
+            case Token_Regex:
+            {
+                *Member = std::string(Token.Text, Token.TextLength);
+                *Regex = KwmGetRuleRegex(*Member);
+                return *Regex != NULL;
+            } break;
+            default:
+            {
+                DEBUG("Expected token of type Token_String or Token_Regex");
+            } break;
+        }
+    }
+    else
+    {
+        DEBUG("Expected token '='\n");
+    }
+
+    return false;
+}
+
 bool ParseProperties(tokenizer *Tokenizer, window_properties *Properties)
 {
     if(RequireToken(Tokenizer, Token_Equals))
@@ -155,9 +228,9 @@ bool KwmParseRule(std::string RuleSym, window_rule *Rule)
             case Token_Identifier:
             {
                 if(TokenEquals(Token, "owner"))
-                    Result = Result && ParseIdentifier(&Tokenizer, &Rule->Owner);
+                    Result = Result && ParseMatcher(&Tokenizer, &Rule->Owner, &Rule->OwnerRegex);
                 else if(TokenEquals(Token, "name"))
-                    Result = Result && ParseIdentifier(&Tokenizer, &Rule->Name);
+                    Result = Result && ParseMatcher(&Tokenizer, &Rule->Name, &Rule->NameRegex);
                 else if(TokenEquals(Token, "properties"))
                     Result = Result && ParseProperties(&Tokenizer, &Rule->Properties);
                 else if(TokenEquals(Token, "except"))
@@ -173,17 +246,128 @@ bool KwmParseRule(std::string RuleSym, window_rule *Rule)
 void KwmAddRule(std::string RuleSym)
 {
     window_rule Rule = {};
+    Rule.LastMatch = -1;
     if(KwmParseRule(RuleSym, &Rule))
+    {
         KWMTiling.WindowRules.push_back(Rule);
+        ++KwmRuleGeneration;
+    }
+}
+
+void KwmClearRules()
+{
+    KWMTiling.WindowRules.clear();
+    ++KwmRuleGeneration;
+}
+
+unsigned int KwmGetRuleGeneration()
+{
+    return KwmRuleGeneration;
+}
+
+void KwmBuildRuleIndex(rule_index *Index)
+{
+    KwmInitPatternSet(&Index->Patterns);
+    Index->Owners.clear();
+    Index->Names.clear();
+    Index->Always.clear();
+    Index->NamePattern.clear();
+    Index->ExceptPattern.clear();
+
+    for(std::size_t RuleIndex = 0; RuleIndex < KWMTiling.WindowRules.size(); ++RuleIndex)
+    {
+        window_rule *Rule = &KWMTiling.WindowRules[RuleIndex];
+        int Name = Rule->NameRegex ? -1 : KwmAddPattern(&Index->Patterns, Rule->Name);
+        int Except = KwmAddPattern(&Index->Patterns, Rule->Except);
+        Index->NamePattern.push_back(Name);
+        Index->ExceptPattern.push_back(Except);
+
+        if(!Rule->Owner.empty() && !Rule->OwnerRegex)
+        {
+            Index->Owners[Rule->Owner].push_back(RuleIndex);
+        }
+        else if(Name != -1)
+        {
+            if(Index->Names.size() <= (std::size_t) Name)
+                Index->Names.resize(Name + 1);
+
+            Index->Names[Name].push_back(RuleIndex);
+        }
+        else
+        {
+            Index->Always.push_back(RuleIndex);
+        }
+    }
+
+    Index->Names.resize(Index->Patterns.Count);
+    KwmBuildPatternSet(&Index->Patterns);
+    Index->Generation = KwmRuleGeneration;
+}
+
+/* Collects the rules that match the window, in the order they were added, so that
+ * later rules still override the properties set by earlier ones. */
+std::vector<int> &KwmFindMatchingRules(window_info *Window)
+{
+    rule_index *Index = &KwmRuleIndex;
+    if(Index->Generation != KwmRuleGeneration)
+        KwmBuildRuleIndex(Index);
+
+    Index->Candidates.clear();
+    KwmMatchPatternSet(&Index->Patterns, Window->Name, &Index->Found);
+
+    std::unordered_map<std::string, std::vector<int> >::iterator It = Index->Owners.find(Window->Owner);
+    if(It != Index->Owners.end())
+        Index->Candidates.insert(Index->Candidates.end(), It->second.begin(), It->second.end());
+
+    Index->Candidates.insert(Index->Candidates.end(), Index->Always.begin(), Index->Always.end());
+    for(std::size_t FoundIndex = 0; FoundIndex < Index->Found.size(); ++FoundIndex)
+    {
+        std::vector<int> &Rules = Index->Names[Index->Found[FoundIndex]];
+        Index->Candidates.insert(Index->Candidates.end(), Rules.begin(), Rules.end());
+    }
+
+    std::size_t Matches = 0;
+    for(std::size_t CandidateIndex = 0; CandidateIndex < Index->Candidates.size(); ++CandidateIndex)
+    {
+        int RuleIndex = Index->Candidates[CandidateIndex];
+        window_rule *Rule = &KWMTiling.WindowRules[RuleIndex];
+        int Name = Index->NamePattern[RuleIndex];
+        int Except = Index->ExceptPattern[RuleIndex];
+        if((Name == -1 || KwmPatternWasFound(&Index->Patterns, Name)) &&
+           !KwmPatternWasFound(&Index->Patterns, Except) &&
+           (!Rule->OwnerRegex || KwmMatchRegex(Rule->OwnerRegex, Window->Owner)) &&
+           (!Rule->NameRegex || KwmMatchRegex(Rule->NameRegex, Window->Name)))
+            Index->Candidates[Matches++] = RuleIndex;
+    }
+
+    Index->Candidates.resize(Matches);
+    std::sort(Index->Candidates.begin(), Index->Candidates.end());
+    return Index->Candidates;
+}
+
+bool WindowRulesAreEqual(window_rule *A, window_rule *B)
+{
+    return A->Owner == B->Owner &&
+           A->Name == B->Name &&
+           A->OwnerRegex == B->OwnerRegex &&
+           A->NameRegex == B->NameRegex &&
+           A->Except == B->Except &&
+           A->Properties.Display == B->Properties.Display &&
+           A->Properties.Space == B->Properties.Space &&
+           A->Properties.Float == B->Properties.Float;
 }
 
 bool MatchWindowRule(window_rule *Rule, window_info *Window)
 {
     bool Match = true;
-    if(!Rule->Owner.empty())
+    if(Rule->OwnerRegex)
+        Match = KwmMatchRegex(Rule->OwnerRegex, Window->Owner);
+    else if(!Rule->Owner.empty())
         Match = Rule->Owner == Window->Owner;
 
-    if(!Rule->Name.empty())
+    if(Rule->NameRegex)
+        Match = Match && KwmMatchRegex(Rule->NameRegex, Window->Name);
+    else if(!Rule->Name.empty())
         Match = Match && Window->Name.find(Rule->Name) != std::string::npos;
 
     if(!Rule->Except.empty())
@@ -192,38 +376,124 @@ bool MatchWindowRule(window_rule *Rule, window_info *Window)
     return Match;
 }
 
+unsigned int KwmGetOwnerAtom(const std::string &Owner)
+{
+    std::unordered_map<std::string, unsigned int>::iterator It = KwmOwnerAtoms.find(Owner);
+    if(It != KwmOwnerAtoms.end())
+        return It->second;
+
+    unsigned int Atom = KwmOwnerAtomCount++;
+    KwmOwnerAtoms[Owner] = Atom;
+    return Atom;
+}
+
+unsigned int KwmHashWindowTitle(const std::string &Name)
+{
+    unsigned int Hash = 2166136261u;
+    for(std::size_t Index = 0; Index < Name.size(); ++Index)
+    {
+        Hash ^= (unsigned char) Name[Index];
+        Hash *= 16777619u;
+    }
+
+    return Hash;
+}
+
+void KwmEvaluateWindowRules(window_info *Window, rule_memo_entry *Entry)
+{
+    kwm_time_point Start = std::chrono::steady_clock::now();
+    window_properties *Properties = &Entry->Properties;
+    Properties->Display = -1;
+    Properties->Space = -1;
+    Properties->Float = 0;
+
+    Entry->Rules = KwmFindMatchingRules(Window);
+    for(std::size_t Index = 0; Index < Entry->Rules.size(); ++Index)
+    {
+        window_rule *Rule = &KWMTiling.WindowRules[Entry->Rules[Index]];
+        if(Rule->Properties.Float != -1)
+            Properties->Float = Rule->Properties.Float == 1;
+
+        if(Rule->Properties.Display != -1)
+            Properties->Display = Rule->Properties.Display;
+
+        if(Rule->Properties.Space != -1)
+            Properties->Space = Rule->Properties.Space;
+    }
+
+    std::chrono::duration<double, std::milli> Duration = std::chrono::steady_clock::now() - Start;
+    KwmRuleStats.EvaluationTime += Duration.count();
+    ++KwmRuleStats.Evaluations;
+}
+
+/* A memo entry keeps the indices of the rules that matched, which stay valid for
+ * its generation, so the counters move on a memo hit just as on a miss. */
 void CheckWindowRules(window_info *Window)
 {
     if(HasRuleBeenApplied(Window))
         return;
 
-    Window->Display = -1;
-    Window->Space = -1;
-    Window->Float = 0;
+    unsigned long long Key = ((unsigned long long) KwmGetOwnerAtom(Window->Owner) << 32) |
+                             KwmHashWindowTitle(Window->Name);
 
-    for(int Index = 0; Index < KWMTiling.WindowRules.size(); ++Index)
+    rule_memo_entry *Entry = NULL;
+    std::unordered_map<unsigned long long, rule_memo_entry>::iterator It = KwmRuleMemo.find(Key);
+    if(It != KwmRuleMemo.end() &&
+       It->second.Generation == KwmRuleGeneration &&
+       It->second.Name == Window->Name)
     {
-        window_rule *Rule = &KWMTiling.WindowRules[Index];
-        if(MatchWindowRule(Rule, Window))
-        {
-            if(Rule->Properties.Float != -1)
-                Window->Float = Rule->Properties.Float == 1;
+        Entry = &It->second;
+        ++KwmRuleMemoHits;
+    }
+    else
+    {
+        if(It == KwmRuleMemo.end() && KwmRuleMemo.size() >= KWM_RULE_MEMO_MAX_ENTRIES)
+            KwmRuleMemo.clear();
 
-            if(Rule->Properties.Display != -1)
-                Window->Display = Rule->Properties.Display;
+        Entry = &KwmRuleMemo[Key];
+        Entry->Generation = KwmRuleGeneration;
+        Entry->Name = Window->Name;
+        KwmEvaluateWindowRules(Window, Entry);
+        KwmRuleMemoEntries = KwmRuleMemo.size();
+        ++KwmRuleMemoMisses;
+    }
 
-            if(Rule->Properties.Space != -1)
-                Window->Space = Rule->Properties.Space;
-        }
+    for(std::size_t Index = 0; Index < Entry->Rules.size(); ++Index)
+    {
+        window_rule *Rule = &KWMTiling.WindowRules[Entry->Rules[Index]];
+        Rule->LastMatch = Window->WID;
+        ++Rule->Hits;
     }
+
+    Window->Display = Entry->Properties.Display;
+    Window->Space = Entry->Properties.Space;
+    Window->Float = Entry->Properties.Float;
+}
+
+std::string KwmGetRuleCacheStats()
+{
+    unsigned int Hits = KwmRuleMemoHits;
+    unsigned int Misses = KwmRuleMemoMisses;
+    unsigned int Total = Hits + Misses;
+    char Buffer[32];
+    snprintf(Buffer, sizeof(Buffer), "%.1f%%", Total ? (100.0 * Hits) / Total : 0.0);
+
+    return "hits: " + std::to_string(Hits) +
+           ", misses: " + std::to_string(Misses) +
+           ", hit-rate: " + Buffer +
+           ", entries: " + std::to_string(KwmRuleMemoEntries) +
+           ", owners: " + std::to_string(KwmOwnerAtomCount) +
+           ", rule-generation: " + std::to_string(KwmRuleGeneration);
 }
 
 bool EnforceWindowRules(window_info *Window)
 {
+    kwm_time_point Start = std::chrono::steady_clock::now();
     bool Result  = false;
 
     if(Window->Float)
     {
+        ++KwmRuleStats.Floated;
         screen_info *ScreenOfWindow = GetDisplayOfWindow(Window);
         if(ScreenOfWindow)
         {
@@ -243,6 +513,7 @@ bool EnforceWindowRules(window_info *Window)
         if(Screen && Screen != GetDisplayOfWindow(Window))
         {
             MoveWindowToDisplay(Window, Window->Display, false);
+            ++KwmRuleStats.DisplayMoves;
             Result = true;
         }
     }
@@ -261,11 +532,19 @@ bool EnforceWindowRules(window_info *Window)
             {
                 AddWindowToSpace(DestinationCGSpaceID, Window->WID);
                 RemoveWindowFromSpace(SourceCGSpaceID, Window->WID);
+                ++KwmRuleStats.SpaceMoves;
             }
         }
     }
 
     KWMTiling.EnforcedWindows[Window->WID] = true;
+
+    std::chrono::duration<double, std::milli> Duration = std::chrono::steady_clock::now() - Start;
+    KwmRuleStats.EnforceTime += Duration.count();
+    if(Duration.count() > KwmRuleStats.EnforceMaxTime)
+        KwmRuleStats.EnforceMaxTime = Duration.count();
+
+    ++KwmRuleStats.Enforced;
     return Result;
 }
 
@@ -274,3 +553,72 @@ bool HasRuleBeenApplied(window_info *Window)
     std::map<int, bool>::iterator It = KWMTiling.EnforcedWindows.find(Window->WID);
     return It != KWMTiling.EnforcedWindows.end();
 }
+
+void KwmCreateMatcherString(const char *Key, std::string &Value, kwm_regex *Regex, std::string &Output)
+{
+    if(Regex)
+        Output += std::string(" ") + Key + "=/" + Value + "/";
+    else if(!Value.empty())
+        Output += std::string(" ") + Key + "=\"" + Value + "\"";
+}
+
+void KwmCreateLastMatchString(int WindowID, std::string &Output)
+{
+    Output += ", last: " + std::to_string(WindowID);
+    for(std::size_t Index = 0; Index < KWMTiling.WindowLst.size(); ++Index)
+    {
+        window_info *Window = &KWMTiling.WindowLst[Index];
+        if(Window->WID == WindowID)
+        {
+            Output += ", " + Window->Owner + ", " + Window->Name;
+            break;
+        }
+    }
+}
+
+void KwmCreateRulesString(bool Stats, std::string &Output)
+{
+    char Buffer[256];
+    if(Stats)
+    {
+        snprintf(Buffer, sizeof(Buffer),
+                 "rules: %zu, evaluations: %u, evaluation-time: %.3fms\n"
+                 "enforced: %u, float: %u, display-moves: %u, space-moves: %u, enforce-time: %.3fms, enforce-max: %.3fms",
+                 KWMTiling.WindowRules.size(), KwmRuleStats.Evaluations, KwmRuleStats.EvaluationTime,
+                 KwmRuleStats.Enforced, KwmRuleStats.Floated, KwmRuleStats.DisplayMoves,
+                 KwmRuleStats.SpaceMoves, KwmRuleStats.EnforceTime, KwmRuleStats.EnforceMaxTime);
+        Output += Buffer;
+    }
+
+    for(std::size_t Index = 0; Index < KWMTiling.WindowRules.size(); ++Index)
+    {
+        window_rule *Rule = &KWMTiling.WindowRules[Index];
+        if(!Output.empty())
+            Output += "\n";
+
+        Output += std::to_string(Index) + ":";
+        KwmCreateMatcherString("owner", Rule->Owner, Rule->OwnerRegex, Output);
+        KwmCreateMatcherString("name", Rule->Name, Rule->NameRegex, Output);
+        KwmCreateMatcherString("except", Rule->Except, NULL, Output);
+
+        std::vector<std::string> Properties;
+        if(Rule->Properties.Float != -1)
+            Properties.push_back(std::string("float=\"") + (Rule->Properties.Float ? "true" : "false") + "\"");
+        if(Rule->Properties.Display != -1)
+            Properties.push_back("display=\"" + std::to_string(Rule->Properties.Display) + "\"");
+        if(Rule->Properties.Space != -1)
+            Properties.push_back("space=\"" + std::to_string(Rule->Properties.Space) + "\"");
+
+        Output += " properties={";
+        for(std::size_t Property = 0; Property < Properties.size(); ++Property)
+            Output += (Property ? "; " : "") + Properties[Property];
+        Output += "}";
+
+        if(Stats)
+        {
+            Output += " hits: " + std::to_string(Rule->Hits);
+            if(Rule->LastMatch != -1)
+                KwmCreateLastMatchString(Rule->LastMatch, Output);
+        }
+    }
+}
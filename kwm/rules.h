@@ -2,14 +2,72 @@
 #define RULES_H
 
 #include "types.h"
+#include "pattern.h"
+
+#include <unordered_map>
+
+/* The rule index is rebuilt whenever the rule generation changes. Rules with a
+ * literal owner are bucketed by that owner; the other rules are listed under the
+ * literal name they require, or as always-candidates if they have none. Every
+ * literal name and except string is part of one pattern set, so a window costs one
+ * pass over its title plus the rules that can actually match it. Regular expressions
+ * are only run for the candidates that use them. */
+struct rule_index
+{
+    unsigned int Generation;
+    kwm_pattern_set Patterns;
+    std::unordered_map<std::string, std::vector<int> > Owners;
+    std::vector<std::vector<int> > Names;
+    std::vector<int> Always;
+    std::vector<int> NamePattern;
+    std::vector<int> ExceptPattern;
+
+    std::vector<int> Found;
+    std::vector<int> Candidates;
+};
+
+/* Counters of the rule engine. Evaluation is only timed when the memo misses and
+ * enforcement is rare, so they stay cheap enough to be always on. Per rule hits and
+ * the last matching window are kept in window_rule itself. */
+struct rule_stats
+{
+    unsigned int Evaluations;
+    double EvaluationTime;
+
+    unsigned int Enforced;
+    unsigned int Floated;
+    unsigned int DisplayMoves;
+    unsigned int SpaceMoves;
+    double EnforceTime;
+    double EnforceMaxTime;
+};
+
+/* The outcome of the rules only depends on the owner and title of a window and on
+ * the rule set, so it is memoized under the interned owner and a hash of the title.
+ * An entry created for an older rule generation is evaluated again; the title is
+ * kept to tell two titles with the same hash apart. */
+struct rule_memo_entry
+{
+    unsigned int Generation;
+    std::string Name;
+    window_properties Properties;
+    std::vector<int> Rules;
+};
 
 bool ParseIdentifier(tokenizer *Tokenizer, std::string *Member);
 bool ParseProperties(tokenizer *Tokenizer, window_properties *Properties);
 bool KwmParseRule(std::string RuleSym, window_rule *Rule);
+unsigned int KwmGetOwnerAtom(const std::string &Owner);
 
 void KwmAddRule(std::string RuleSym);
+void KwmClearRules();
+unsigned int KwmGetRuleGeneration();
+bool WindowRulesAreEqual(window_rule *A, window_rule *B);
 bool MatchWindowRule(window_rule *Rule, window_info *Window);
+std::vector<int> &KwmFindMatchingRules(window_info *Window);
 void CheckWindowRules(window_info *Window);
+std::string KwmGetRuleCacheStats();
+void KwmCreateRulesString(bool Stats, std::string &Output);
 bool EnforceWindowRules(window_info *Window);
 bool HasRuleBeenApplied(window_info *Window);
 
@@ -5,6 +5,12 @@
 #include "space.h"
 #include "border.h"
 #include "helpers.h"
+#include "window.h"
+#include "json.h"
+
+extern kwm_tiling KWMTiling;
+extern kwm_toggles KWMToggles;
+extern kwm_mode KWMMode;
 
 void SerializeParentNode(tree_node *Parent, std::string Role, std::vector<std::string> &Serialized)
 {
@@ -170,7 +176,240 @@ void LoadBSPTreeFromFile(screen_info *Screen, std::string Name)
         Space->RootNode = DeserializeNodeTree(SerializedTree);
         FillDeserializedTree(Space->RootNode);
         ApplyTreeNodeContainer(Space->RootNode);
-        UpdateBorder("focused");
-        UpdateBorder("marked");
+        UpdateBorder(BorderTypeFocused);
+        UpdateBorder(BorderTypeMarked);
+    }
+}
+
+const char *GetSpaceModeName(space_tiling_option Mode)
+{
+    switch(Mode)
+    {
+        case SpaceModeBSP: { return "bsp"; } break;
+        case SpaceModeMonocle: { return "monocle"; } break;
+        case SpaceModeFloating: { return "float"; } break;
+        default: { return "default"; } break;
+    }
+}
+
+const char *GetSplitModeName(split_type Mode)
+{
+    switch(Mode)
+    {
+        case SPLIT_VERTICAL: { return "vertical"; } break;
+        case SPLIT_HORIZONTAL: { return "horizontal"; } break;
+        default: { return "optimal"; } break;
+    }
+}
+
+const char *GetFocusModeName(focus_option Mode)
+{
+    switch(Mode)
+    {
+        case FocusModeAutofocus: { return "autofocus"; } break;
+        case FocusModeAutoraise: { return "autoraise"; } break;
+        case FocusModeStandby: { return "standby"; } break;
+        default: { return "off"; } break;
     }
 }
+
+void SerializeContainerToJson(json_writer *Writer, node_container *Container)
+{
+    JsonBeginObject(Writer, "container");
+    JsonWriteDouble(Writer, "x", Container->X);
+    JsonWriteDouble(Writer, "y", Container->Y);
+    JsonWriteDouble(Writer, "width", Container->Width);
+    JsonWriteDouble(Writer, "height", Container->Height);
+    JsonEndObject(Writer);
+}
+
+void SerializeOffsetToJson(json_writer *Writer, container_offset *Offset)
+{
+    JsonBeginObject(Writer, "padding");
+    JsonWriteDouble(Writer, "top", Offset->PaddingTop);
+    JsonWriteDouble(Writer, "bottom", Offset->PaddingBottom);
+    JsonWriteDouble(Writer, "left", Offset->PaddingLeft);
+    JsonWriteDouble(Writer, "right", Offset->PaddingRight);
+    JsonEndObject(Writer);
+
+    JsonBeginObject(Writer, "gap");
+    JsonWriteDouble(Writer, "vertical", Offset->VerticalGap);
+    JsonWriteDouble(Writer, "horizontal", Offset->HorizontalGap);
+    JsonEndObject(Writer);
+}
+
+void SerializeWindowIDToJson(json_writer *Writer, const char *Key, int WindowID)
+{
+    if(WindowID != -1)
+        JsonWriteInt(Writer, Key, WindowID);
+    else
+        JsonWriteNull(Writer, Key);
+}
+
+void SerializeNodeToJson(json_writer *Writer, const char *Key, tree_node *Node)
+{
+    if(!Node)
+    {
+        JsonWriteNull(Writer, Key);
+        return;
+    }
+
+    JsonBeginObject(Writer, Key);
+    JsonWriteString(Writer, "type", Node->Type == NodeTypeLink ? "monocle" : "bsp");
+    SerializeWindowIDToJson(Writer, "window", Node->WindowID);
+    JsonWriteString(Writer, "split-mode", GetSplitModeName(Node->SplitMode));
+    JsonWriteDouble(Writer, "split-ratio", Node->SplitRatio);
+    SerializeContainerToJson(Writer, &Node->Container);
+
+    if(Node->List)
+    {
+        JsonBeginArray(Writer, "links");
+        for(link_node *Link = Node->List; Link; Link = Link->Next)
+        {
+            JsonBeginObject(Writer, NULL);
+            SerializeWindowIDToJson(Writer, "window", Link->WindowID);
+            SerializeContainerToJson(Writer, &Link->Container);
+            JsonEndObject(Writer);
+        }
+        JsonEndArray(Writer);
+    }
+
+    if(!IsLeafNode(Node))
+    {
+        SerializeNodeToJson(Writer, "left", Node->LeftChild);
+        SerializeNodeToJson(Writer, "right", Node->RightChild);
+    }
+
+    JsonEndObject(Writer);
+}
+
+void SerializeDisplaysToJson(json_writer *Writer)
+{
+    JsonBeginArray(Writer, "displays");
+    std::map<unsigned int, screen_info>::iterator It;
+    for(It = KWMTiling.DisplayMap.begin(); It != KWMTiling.DisplayMap.end(); ++It)
+    {
+        screen_info *Screen = &It->second;
+        JsonBeginObject(Writer, NULL);
+        JsonWriteInt(Writer, "id", Screen->ID);
+        JsonWriteBool(Writer, "focused", Screen == KWMScreen.Current);
+        JsonWriteInt(Writer, "x", Screen->X);
+        JsonWriteInt(Writer, "y", Screen->Y);
+        JsonWriteDouble(Writer, "width", Screen->Width);
+        JsonWriteDouble(Writer, "height", Screen->Height);
+
+        JsonBeginArray(Writer, "spaces");
+        std::map<int, space_info>::iterator SpaceIt;
+        for(SpaceIt = Screen->Space.begin(); SpaceIt != Screen->Space.end(); ++SpaceIt)
+        {
+            space_info *Space = &SpaceIt->second;
+            JsonBeginObject(Writer, NULL);
+            JsonWriteInt(Writer, "id", GetSpaceNumberFromCGSpaceID(Screen, SpaceIt->first));
+            JsonWriteInt(Writer, "cgs-id", SpaceIt->first);
+            JsonWriteBool(Writer, "active", SpaceIt->first == Screen->ActiveSpace);
+            JsonWriteBool(Writer, "managed", Space->Managed);
+            JsonWriteBool(Writer, "initialized", Space->Initialized);
+            JsonWriteString(Writer, "mode", GetSpaceModeName(Space->Settings.Mode));
+            SerializeOffsetToJson(Writer, &Space->Settings.Offset);
+            SerializeWindowIDToJson(Writer, "focused", Space->Initialized ? Space->FocusedWindowID : -1);
+            SerializeNodeToJson(Writer, "tree", Space->RootNode);
+            JsonEndObject(Writer);
+        }
+        JsonEndArray(Writer);
+
+        JsonEndObject(Writer);
+    }
+    JsonEndArray(Writer);
+}
+
+void SerializeWindowsToJson(json_writer *Writer)
+{
+    JsonBeginArray(Writer, "windows");
+    for(std::size_t WindowIndex = 0; WindowIndex < KWMTiling.FocusLst.size(); ++WindowIndex)
+    {
+        window_info *Window = &KWMTiling.FocusLst[WindowIndex];
+        JsonBeginObject(Writer, NULL);
+        JsonWriteInt(Writer, "id", Window->WID);
+        JsonWriteInt(Writer, "pid", Window->PID);
+        JsonWriteString(Writer, "owner", Window->Owner);
+        JsonWriteString(Writer, "name", Window->Name);
+        JsonWriteInt(Writer, "layer", Window->Layer);
+        JsonWriteInt(Writer, "x", Window->X);
+        JsonWriteInt(Writer, "y", Window->Y);
+        JsonWriteInt(Writer, "width", Window->Width);
+        JsonWriteInt(Writer, "height", Window->Height);
+        JsonWriteBool(Writer, "floating", IsWindowFloating(Window->WID, NULL));
+        JsonEndObject(Writer);
+    }
+    JsonEndArray(Writer);
+}
+
+void SerializeFocusToJson(json_writer *Writer)
+{
+    JsonBeginObject(Writer, "focus");
+    if(KWMFocus.Window)
+    {
+        JsonWriteInt(Writer, "window", KWMFocus.Window->WID);
+        JsonWriteString(Writer, "owner", KWMFocus.Window->Owner);
+        JsonWriteString(Writer, "name", KWMFocus.Window->Name);
+    }
+    else
+    {
+        JsonWriteNull(Writer, "window");
+    }
+
+    if(KWMScreen.Current)
+    {
+        JsonWriteInt(Writer, "display", KWMScreen.Current->ID);
+        JsonWriteInt(Writer, "space", GetSpaceNumberFromCGSpaceID(KWMScreen.Current, KWMScreen.Current->ActiveSpace));
+    }
+
+    SerializeWindowIDToJson(Writer, "marked", KWMScreen.MarkedWindow);
+    JsonWriteBool(Writer, "prefix", KWMHotkeys.Prefix.Active);
+    JsonEndObject(Writer);
+}
+
+void SerializeBorderToJson(json_writer *Writer, const char *Key, kwm_border *Border)
+{
+    JsonBeginObject(Writer, Key);
+    JsonWriteBool(Writer, "enabled", Border->Enabled);
+    JsonWriteInt(Writer, "size", Border->Width);
+    JsonWriteDouble(Writer, "radius", Border->Radius);
+    JsonWriteString(Writer, "color", Border->Color.Format);
+    JsonEndObject(Writer);
+}
+
+void SerializeSettingsToJson(json_writer *Writer)
+{
+    JsonBeginObject(Writer, "settings");
+    JsonWriteString(Writer, "tiling", KWMToggles.EnableTilingMode ? GetSpaceModeName(KWMMode.Space) : "off");
+    JsonWriteString(Writer, "focus-follows-mouse", GetFocusModeName(KWMMode.Focus));
+    JsonWriteBool(Writer, "mouse-follows-focus", KWMToggles.UseMouseFollowsFocus);
+    JsonWriteBool(Writer, "standby-on-float", KWMToggles.StandbyOnFloat);
+    JsonWriteString(Writer, "cycle-focus", KWMMode.Cycle == CycleModeScreen ? "screen" : "off");
+    JsonWriteString(Writer, "spawn", KWMTiling.SpawnAsLeftChild ? "left" : "right");
+    JsonWriteString(Writer, "split-mode", GetSplitModeName(KWMScreen.SplitMode));
+    JsonWriteDouble(Writer, "split-ratio", KWMScreen.SplitRatio);
+    JsonWriteDouble(Writer, "optimal-ratio", KWMTiling.OptimalRatio);
+    JsonWriteBool(Writer, "float-non-resizable", KWMTiling.FloatNonResizable);
+    JsonWriteBool(Writer, "lock-to-container", KWMTiling.LockToContainer);
+    JsonWriteBool(Writer, "hotkeys", KWMToggles.UseBuiltinHotkeys);
+    SerializeOffsetToJson(Writer, &KWMScreen.DefaultOffset);
+
+    JsonBeginObject(Writer, "prefix");
+    JsonWriteBool(Writer, "enabled", KWMHotkeys.Prefix.Enabled);
+    JsonWriteBool(Writer, "global", KWMHotkeys.Prefix.Global);
+    JsonWriteDouble(Writer, "timeout", KWMHotkeys.Prefix.Timeout);
+    JsonWriteDouble(Writer, "sequence-timeout", KWMHotkeys.SequenceTimeout);
+    JsonEndObject(Writer);
+
+    JsonBeginObject(Writer, "border");
+    SerializeBorderToJson(Writer, "focused", &FocusedBorder);
+    SerializeBorderToJson(Writer, "marked", &MarkedBorder);
+    SerializeBorderToJson(Writer, "prefix", &PrefixBorder);
+    JsonEndObject(Writer);
+
+    JsonWriteInt(Writer, "hotkey-count", KWMHotkeys.List.size());
+    JsonWriteInt(Writer, "rule-count", KWMTiling.WindowRules.size());
+    JsonEndObject(Writer);
+}
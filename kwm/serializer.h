@@ -11,4 +11,14 @@ tree_node *DeserializeNodeTree(std::vector<std::string> &Serialized);
 void SaveBSPTreeToFile(screen_info *Screen, std::string Name);
 void LoadBSPTreeFromFile(screen_info *Screen, std::string Name);
 
+const char *GetSpaceModeName(space_tiling_option Mode);
+const char *GetSplitModeName(split_type Mode);
+const char *GetFocusModeName(focus_option Mode);
+void SerializeContainerToJson(json_writer *Writer, node_container *Container);
+void SerializeNodeToJson(json_writer *Writer, const char *Key, tree_node *Node);
+void SerializeDisplaysToJson(json_writer *Writer);
+void SerializeWindowsToJson(json_writer *Writer);
+void SerializeFocusToJson(json_writer *Writer);
+void SerializeSettingsToJson(json_writer *Writer);
+
 #endif
@@ -6,6 +6,7 @@
 #include "keys.h"
 #include "notifications.h"
 #include "helpers.h"
+#include "daemon.h"
 
 extern kwm_mach KWMMach;
 extern kwm_tiling KWMTiling;
@@ -17,7 +18,7 @@ extern kwm_thread KWMThread;
 extern kwm_border FocusedBorder;
 extern kwm_border MarkedBorder;
 
-void GetTagForMonocleSpace(space_info *Space, std::string &Tag)
+void GetTagForMonocleSpace(space_info *Space, char *Tag, std::size_t Size)
 {
     tree_node *Node = Space->RootNode;
     bool FoundFocusedWindow = false;
@@ -41,32 +42,47 @@ void GetTagForMonocleSpace(space_info *Space, std::string &Tag)
     }
 
     if(FoundFocusedWindow)
-        Tag = "[" + std::to_string(FocusedIndex) + "/" + std::to_string(NumberOfWindows) + "]";
+        snprintf(Tag, Size, "[%d/%d]", FocusedIndex, NumberOfWindows);
     else
-        Tag = "[" + std::to_string(NumberOfWindows) + "]";
+        snprintf(Tag, Size, "[%d]", NumberOfWindows);
 }
 
-void GetTagForCurrentSpace(std::string &Tag)
+/* Writes into a caller buffer so that the state page can be updated on every
+ * focus change without building a string. */
+void GetTagForCurrentSpace(char *Tag, std::size_t Size)
 {
+    const char *Mode = "";
     if(IsSpaceInitializedForScreen(KWMScreen.Current))
     {
         space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
         if(Space->Settings.Mode == SpaceModeBSP)
-            Tag = "[bsp]";
+            Mode = "[bsp]";
         else if(Space->Settings.Mode == SpaceModeFloating)
-            Tag = "[float]";
+            Mode = "[float]";
         else if(Space->Settings.Mode == SpaceModeMonocle)
-            GetTagForMonocleSpace(Space, Tag);
+        {
+            GetTagForMonocleSpace(Space, Tag, Size);
+            return;
+        }
     }
     else
     {
         if(KWMMode.Space == SpaceModeBSP)
-            Tag = "[bsp]";
+            Mode = "[bsp]";
         else if(KWMMode.Space == SpaceModeFloating)
-            Tag = "[float]";
+            Mode = "[float]";
         else if(KWMMode.Space == SpaceModeMonocle)
-            Tag = "[monocle]";
+            Mode = "[monocle]";
     }
+
+    snprintf(Tag, Size, "%s", Mode);
+}
+
+void GetTagForCurrentSpace(std::string &Tag)
+{
+    char Buffer[32];
+    GetTagForCurrentSpace(Buffer, sizeof(Buffer));
+    Tag = Buffer;
 }
 
 void GoToPreviousSpace(bool MoveFocusedWindow)
@@ -91,6 +107,17 @@ void GoToPreviousSpace(bool MoveFocusedWindow)
     }
 }
 
+bool SpaceSettingsAreEqual(space_settings *A, space_settings *B)
+{
+    return A->Mode == B->Mode &&
+           A->Offset.PaddingTop == B->Offset.PaddingTop &&
+           A->Offset.PaddingBottom == B->Offset.PaddingBottom &&
+           A->Offset.PaddingLeft == B->Offset.PaddingLeft &&
+           A->Offset.PaddingRight == B->Offset.PaddingRight &&
+           A->Offset.VerticalGap == B->Offset.VerticalGap &&
+           A->Offset.HorizontalGap == B->Offset.HorizontalGap;
+}
+
 bool IsActiveSpaceFloating()
 {
     return IsSpaceFloating(KWMScreen.Current->ActiveSpace);
@@ -212,6 +239,7 @@ void FloatFocusedSpace()
         Space->Initialized = true;
         Space->NeedsUpdate = false;
         ClearFocusedWindow();
+        KwmEmitEvent(EventTypeMode);
     }
 }
 
@@ -232,6 +260,7 @@ void TileFocusedSpace(space_tiling_option Mode)
         Space->Settings.Mode = Mode;
         std::vector<window_info*> WindowsOnDisplay = GetAllWindowsOnDisplay(KWMScreen.Current->ID);
         CreateWindowNodeTree(KWMScreen.Current, &WindowsOnDisplay);
+        KwmEmitEvent(EventTypeMode);
     }
 }
 
@@ -303,6 +332,8 @@ void UpdateActiveSpace()
         }
     }
 
+    KwmEmitEvent(EventTypeSpace);
+    KwmEmitEvent(EventTypeMode);
     pthread_mutex_unlock(&KWMThread.Lock);
 }
 
@@ -5,8 +5,10 @@
 
 extern void MoveFocusedWindowToSpace(std::string SpaceID);
 
-void GetTagForMonocleSpace(space_info *Space, std::string &Tag);
+void GetTagForMonocleSpace(space_info *Space, char *Tag, std::size_t Size);
+void GetTagForCurrentSpace(char *Tag, std::size_t Size);
 void GetTagForCurrentSpace(std::string &Tag);
+bool SpaceSettingsAreEqual(space_settings *A, space_settings *B);
 bool IsSpaceInitializedForScreen(screen_info *Screen);
 bool DoesSpaceExistInMapOfScreen(screen_info *Screen);
 space_info *GetActiveSpaceOfScreen(screen_info *Screen);
@@ -0,0 +1,84 @@
+#include "startup.h"
+
+/* Every phase of KwmInit records when it started and how long it took, relative
+ * to the start of KwmInit. Each phase is only ever written by the thread that runs
+ * it, and the concurrent phases are joined before the report is created, so the
+ * table needs no lock. */
+
+kwm_time_point KwmStartupBegin;
+double KwmStartupTotal = 0;
+startup_phase KwmStartupPhases[StartupPhaseCount] =
+{
+    { "privileges", false, false, 0, 0 },
+    { "daemon", false, false, 0, 0 },
+    { "config", true, false, 0, 0 },
+    { "displays", true, false, 0, 0 },
+    { "window-list", true, false, 0, 0 },
+    { "state-page", false, false, 0, 0 },
+    { "first-layout", false, false, 0, 0 },
+    { "init-script", false, false, 0, 0 },
+};
+
+double KwmGetStartupTime()
+{
+    std::chrono::duration<double, std::milli> Elapsed = std::chrono::steady_clock::now() - KwmStartupBegin;
+    return Elapsed.count();
+}
+
+void KwmBeginStartup()
+{
+    KwmStartupBegin = std::chrono::steady_clock::now();
+}
+
+void KwmBeginStartupPhase(startup_phase_type Phase)
+{
+    KwmStartupPhases[Phase].Start = KwmGetStartupTime();
+}
+
+void KwmEndStartupPhase(startup_phase_type Phase)
+{
+    KwmStartupPhases[Phase].Duration = KwmGetStartupTime() - KwmStartupPhases[Phase].Start;
+    KwmStartupPhases[Phase].Done = true;
+}
+
+void KwmEndStartup()
+{
+    KwmStartupTotal = KwmGetStartupTime();
+}
+
+/* The concurrent phases overlap; the time saved is the sum of their durations
+ * minus the wall-clock time between the first of them starting and the last
+ * of them finishing. */
+std::string KwmCreateStartupReport()
+{
+    std::string Output = "phase          start(ms)  duration(ms)";
+    char Buffer[128];
+
+    double Sum = 0;
+    double First = -1;
+    double Last = 0;
+    for(int Index = 0; Index < StartupPhaseCount; ++Index)
+    {
+        startup_phase *Phase = &KwmStartupPhases[Index];
+        if(!Phase->Done)
+            continue;
+
+        snprintf(Buffer, sizeof(Buffer), "\n%-14s %9.2f %13.2f%s",
+                 Phase->Name, Phase->Start, Phase->Duration, Phase->Concurrent ? "  (concurrent)" : "");
+        Output += Buffer;
+
+        if(Phase->Concurrent)
+        {
+            Sum += Phase->Duration;
+            if(First < 0 || Phase->Start < First)
+                First = Phase->Start;
+            if(Phase->Start + Phase->Duration > Last)
+                Last = Phase->Start + Phase->Duration;
+        }
+    }
+
+    double Saved = First < 0 ? 0 : Sum - (Last - First);
+    snprintf(Buffer, sizeof(Buffer), "\ntotal: %.2fms, saved by concurrent phases: %.2fms", KwmStartupTotal, Saved);
+    Output += Buffer;
+    return Output;
+}
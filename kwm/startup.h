@@ -0,0 +1,12 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include "types.h"
+
+void KwmBeginStartup();
+void KwmBeginStartupPhase(startup_phase_type Phase);
+void KwmEndStartupPhase(startup_phase_type Phase);
+void KwmEndStartup();
+std::string KwmCreateStartupReport();
+
+#endif
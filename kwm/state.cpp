@@ -0,0 +1,109 @@
+#include "state.h"
+#include "types.h"
+#include "space.h"
+#include "window.h"
+#include "cache.h"
+
+#include <sys/mman.h>
+#include <fcntl.h>
+
+extern kwm_path KWMPath;
+extern kwm_screen KWMScreen;
+extern kwm_focus KWMFocus;
+extern kwm_mode KWMMode;
+extern kwm_toggles KWMToggles;
+extern kwm_hotkeys KWMHotkeys;
+
+kwm_state_page *KwmStatePage = NULL;
+pthread_mutex_t KwmStatePageLock = PTHREAD_MUTEX_INITIALIZER;
+
+bool KwmOpenStatePage()
+{
+    std::string File = KWMPath.EnvHome + "/" + KWMPath.ConfigFolder + "/" + KWM_STATE_PAGE_FILE;
+    int FileFD = open(File.c_str(), O_RDWR | O_CREAT, 0644);
+    if(FileFD == -1)
+    {
+        DEBUG("KwmOpenStatePage() Could not open " << File);
+        return false;
+    }
+
+    if(ftruncate(FileFD, sizeof(kwm_state_page)) == -1)
+    {
+        close(FileFD);
+        return false;
+    }
+
+    void *Memory = mmap(NULL, sizeof(kwm_state_page), PROT_READ | PROT_WRITE, MAP_SHARED, FileFD, 0);
+    close(FileFD);
+    if(Memory == MAP_FAILED)
+        return false;
+
+    kwm_state_page *Page = (kwm_state_page*) Memory;
+    BeginStatePageWrite(Page);
+    Page->Magic = KWM_STATE_PAGE_MAGIC;
+    Page->Version = KWM_STATE_PAGE_VERSION;
+    Page->PID = getpid();
+    Page->FocusedWindowID = -1;
+    Page->MarkedWindowID = -1;
+    Page->DisplayID = -1;
+    Page->SpaceID = -1;
+    Page->TilingMode = -1;
+    Page->PrefixActive = 0;
+    Page->SplitRatio = 0;
+    Page->Tag[0] = '\0';
+    Page->Owner[0] = '\0';
+    Page->Title[0] = '\0';
+    EndStatePageWrite(Page);
+
+    KwmStatePage = Page;
+    KwmUpdateStatePage();
+    return true;
+}
+
+void KwmUpdateStatePage()
+{
+    KwmBumpGeneration();
+    if(!KwmStatePage)
+        return;
+
+    char Tag[sizeof(KwmStatePage->Tag)];
+    GetTagForCurrentSpace(Tag, sizeof(Tag));
+
+    int32_t TilingMode = KWMToggles.EnableTilingMode ? KWMMode.Space : -1;
+    if(KWMToggles.EnableTilingMode && IsSpaceInitializedForScreen(KWMScreen.Current))
+        TilingMode = GetActiveSpaceOfScreen(KWMScreen.Current)->Settings.Mode;
+
+    pthread_mutex_lock(&KwmStatePageLock);
+    kwm_state_page *Page = KwmStatePage;
+    BeginStatePageWrite(Page);
+
+    Page->FocusedWindowID = KWMFocus.Window ? KWMFocus.Window->WID : -1;
+    Page->MarkedWindowID = KWMScreen.MarkedWindow;
+    Page->DisplayID = KWMScreen.Current ? KWMScreen.Current->ID : -1;
+    Page->SpaceID = KWMScreen.Current ? GetSpaceNumberFromCGSpaceID(KWMScreen.Current, KWMScreen.Current->ActiveSpace) : -1;
+    Page->TilingMode = TilingMode;
+    Page->PrefixActive = KWMHotkeys.Prefix.Active;
+    Page->SplitRatio = KWMScreen.SplitRatio;
+
+    CopyToStatePageString(Page->Tag, Tag, sizeof(Page->Tag));
+    CopyToStatePageString(Page->Owner, KWMFocus.Window ? KWMFocus.Window->Owner.c_str() : "", sizeof(Page->Owner));
+    CopyToStatePageString(Page->Title, KWMFocus.Window ? KWMFocus.Window->Name.c_str() : "", sizeof(Page->Title));
+
+    EndStatePageWrite(Page);
+    pthread_mutex_unlock(&KwmStatePageLock);
+}
+
+void KwmCloseStatePage()
+{
+    if(KwmStatePage)
+    {
+        pthread_mutex_lock(&KwmStatePageLock);
+        BeginStatePageWrite(KwmStatePage);
+        KwmStatePage->PID = 0;
+        EndStatePageWrite(KwmStatePage);
+
+        munmap(KwmStatePage, sizeof(kwm_state_page));
+        KwmStatePage = NULL;
+        pthread_mutex_unlock(&KwmStatePageLock);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* The state page is a small memory-mapped file that kwm rewrites whenever the
+ * focused window, space, tiling mode, prefix, split-ratio or marked window changes.
+ * It is protected by a sequence lock: the writer makes Sequence odd while it
+ * updates the page and even when it is done, so a reader retries until it has
+ * copied the page without observing a write in progress. Readers never make a
+ * syscall once the file is mapped, but give up after KWM_STATE_PAGE_RETRIES
+ * attempts; a writer that died mid-write leaves the sequence odd for good.
+ *
+ * This header is shared with kwmc and must not depend on anything but libc. */
+
+#define KWM_STATE_PAGE_MAGIC 0x6b776d73
+#define KWM_STATE_PAGE_VERSION 1
+#define KWM_STATE_PAGE_FILE "kwm.state"
+#define KWM_STATE_PAGE_RETRIES 100000
+
+struct kwm_state_page
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Sequence;
+    int32_t PID;
+
+    int32_t FocusedWindowID;
+    int32_t MarkedWindowID;
+    int32_t DisplayID;
+    int32_t SpaceID;
+    int32_t TilingMode;
+    int32_t PrefixActive;
+    double SplitRatio;
+
+    char Tag[32];
+    char Owner[128];
+    char Title[256];
+};
+
+inline void
+BeginStatePageWrite(kwm_state_page *Page)
+{
+    uint32_t Sequence = __atomic_load_n(&Page->Sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&Page->Sequence, Sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+inline void
+EndStatePageWrite(kwm_state_page *Page)
+{
+    uint32_t Sequence = __atomic_load_n(&Page->Sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&Page->Sequence, Sequence + 1, __ATOMIC_RELEASE);
+}
+
+inline void
+CopyToStatePageString(char *Destination, const char *Source, size_t Size)
+{
+    size_t Length = strnlen(Source, Size - 1);
+    memcpy(Destination, Source, Length);
+    Destination[Length] = '\0';
+}
+
+inline bool
+ReadStatePage(const kwm_state_page *Page, kwm_state_page *Snapshot)
+{
+    if(Page->Magic != KWM_STATE_PAGE_MAGIC ||
+       Page->Version != KWM_STATE_PAGE_VERSION)
+        return false;
+
+    for(int Attempt = 0; Attempt < KWM_STATE_PAGE_RETRIES; ++Attempt)
+    {
+        uint32_t Before = __atomic_load_n(&Page->Sequence, __ATOMIC_ACQUIRE);
+        if(Before & 1)
+            continue;
+
+        memcpy(Snapshot, Page, sizeof(kwm_state_page));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        uint32_t After = __atomic_load_n(&Page->Sequence, __ATOMIC_RELAXED);
+        if(Before == After)
+            return true;
+    }
+
+    return false;
+}
+
+bool KwmOpenStatePage();
+void KwmUpdateStatePage();
+void KwmCloseStatePage();
+
+#endif
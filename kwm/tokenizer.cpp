@@ -56,6 +56,24 @@ token GetToken(tokenizer *Tokenizer)
                 ++Tokenizer->At;
         } break;
 
+        case '/':
+        {
+            Token.Text = Tokenizer->At;
+            while(Tokenizer->At[0] && Tokenizer->At[0] != '/')
+            {
+                if(Tokenizer->At[0] == '\\' && Tokenizer->At[1])
+                    ++Tokenizer->At;
+
+                ++Tokenizer->At;
+            }
+
+            Token.Type = Token_Regex;
+            Token.TextLength = Tokenizer->At - Token.Text;
+
+            if(Tokenizer->At[0] == '/')
+                ++Tokenizer->At;
+        } break;
+
         default:
         {
             if(IsAlpha(C))
@@ -6,6 +6,7 @@
 #include "space.h"
 #include "window.h"
 #include "border.h"
+#include "state.h"
 
 tree_node *CreateTreeFromWindowIDList(screen_info *Screen, std::vector<window_info*> *WindowsPtr)
 {
@@ -411,6 +412,7 @@ void ChangeSplitRatio(double Value)
     {
         DEBUG("ChangeSplitRatio() New Split-Ratio is " << Value);
         KWMScreen.SplitRatio = Value;
+        KwmUpdateStatePage();
     }
 }
 
@@ -8,10 +8,12 @@
 #include <queue>
 #include <stack>
 #include <map>
+#include <list>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <chrono>
+#include <memory>
 
 #include <stdlib.h>
 #include <string.h>
@@ -25,24 +27,42 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "queue.h"
+
 struct token;
 struct tokenizer;
+struct json_writer;
+struct query_request;
+struct query_snapshot;
+struct parsed_command;
+struct config_source;
+struct config_line;
+struct startup_phase;
+struct config_settings;
 struct space_identifier;
 struct color;
 struct hotkey;
+struct hotkey_slot;
+struct hotkey_node;
+struct hotkey_table;
+struct kwm_command;
+struct kwm_condition;
 struct modifiers;
 struct space_settings;
 struct container_offset;
 
 struct window_properties;
 struct window_rule;
+struct kwm_regex;
 struct window_info;
 struct window_role;
 struct screen_info;
+struct display_list;
 struct space_info;
 struct node_container;
 struct tree_node;
 
+struct kwm_subscriber;
 struct kwm_mach;
 struct kwm_border;
 struct kwm_hotkeys;
@@ -76,6 +96,13 @@ typedef BSP_WINDOW_EVENT_CALLBACK(OnBSPWindowDestroy);
 
 typedef std::chrono::time_point<std::chrono::steady_clock> kwm_time_point;
 
+#define KWM_HOTKEY_KEYCODES 256
+#define KWM_HOTKEY_SLOT_BITS 12
+#define KWM_HOTKEY_SLOTS (1 << KWM_HOTKEY_SLOT_BITS)
+#define KWM_HOTKEY_NODES 256
+#define KWM_HOTKEY_ROOT 0
+#define KWM_HOTKEY_PREFIX 1
+
 #define CGSSpaceTypeUser 0
 extern "C" int CGSGetActiveSpace(int cid);
 extern "C" int CGSSpaceGetType(int cid, int sid);
@@ -126,6 +153,44 @@ enum node_type
     NodeTypeLink
 };
 
+enum condition_field
+{
+    ConditionFieldAlways,
+    ConditionFieldFocusedOwner,
+    ConditionFieldFocusedName,
+    ConditionFieldFocusedID,
+    ConditionFieldFocusedFloat,
+    ConditionFieldMarkedID,
+    ConditionFieldSpaceMode,
+    ConditionFieldDisplayID,
+    ConditionFieldPrefix
+};
+
+enum config_line_type
+{
+    ConfigLineCommand,
+    ConfigLineSystem
+};
+
+enum border_type
+{
+    BorderTypeFocused,
+    BorderTypeMarked
+};
+
+enum startup_phase_type
+{
+    StartupPhasePrivileges,
+    StartupPhaseDaemon,
+    StartupPhaseConfig,
+    StartupPhaseDisplays,
+    StartupPhaseWindowList,
+    StartupPhaseStatePage,
+    StartupPhaseFirstLayout,
+    StartupPhaseInitScript,
+    StartupPhaseCount
+};
+
 enum hotkey_state
 {
     HotkeyStateNone,
@@ -133,6 +198,17 @@ enum hotkey_state
     HotkeyStateExclude
 };
 
+enum event_type
+{
+    EventTypeFocus = (1 << 0),
+    EventTypeSpace = (1 << 1),
+    EventTypeTree = (1 << 2),
+    EventTypeMode = (1 << 3),
+    EventTypePrefix = (1 << 4),
+    EventTypeAll = EventTypeFocus | EventTypeSpace | EventTypeTree |
+                   EventTypeMode | EventTypePrefix
+};
+
 enum token_type
 {
     Token_Colon,
@@ -149,6 +225,7 @@ enum token_type
 
     Token_Identifier,
     Token_String,
+    Token_Regex,
 
     Token_EndOfStream,
     Token_Unknown,
@@ -167,6 +244,17 @@ struct tokenizer
     char *At;
 };
 
+struct json_writer
+{
+    std::string *Output;
+
+    int Depth;
+    bool NeedsSeparator[32];
+
+    int Used;
+    char Buffer[4096];
+};
+
 struct space_identifier
 {
 
@@ -187,9 +275,43 @@ struct modifiers
     bool ShiftKey;
 };
 
+struct kwm_condition
+{
+    condition_field Field;
+    bool Equal;
+    std::string Value;
+    int Number;
+
+    kwm_command *Command;
+    std::vector<std::string> Args;
+};
+
+struct hotkey_slot
+{
+    bool Bound;
+    bool Passthrough;
+    unsigned int Key;
+    int Index;
+    int Child;
+};
+
+struct hotkey_node
+{
+    double Timeout;
+    bool Sticky;
+};
+
+struct hotkey_table
+{
+    hotkey_slot Slots[KWM_HOTKEY_SLOTS];
+    hotkey_node Nodes[KWM_HOTKEY_NODES];
+    int NodeCount;
+};
+
 struct hotkey
 {
     std::vector<std::string> List;
+    std::vector<unsigned long long> Owners;
     bool IsSystemCommand;
     hotkey_state State;
     bool Passthrough;
@@ -197,8 +319,13 @@ struct hotkey
     modifiers Mod;
     CGKeyCode Key;
     bool Prefixed;
+    std::vector<unsigned int> Sequence;
 
+    std::string KeySym;
     std::string Command;
+    kwm_command *Compiled;
+    std::vector<std::string> Args;
+    std::vector<kwm_condition> Conditions;
 };
 
 struct container_offset
@@ -263,6 +390,12 @@ struct window_rule
     std::string Except;
     std::string Owner;
     std::string Name;
+
+    kwm_regex *OwnerRegex;
+    kwm_regex *NameRegex;
+
+    unsigned int Hits;
+    int LastMatch;
 };
 
 struct window_info
@@ -318,6 +451,73 @@ struct screen_info
     std::map<int, space_info> Space;
 };
 
+struct display_list
+{
+    std::vector<CGDirectDisplayID> Displays;
+    std::vector<screen_info> Screens;
+};
+
+struct query_request
+{
+    std::string Query;
+    kwm_command *Command;
+    std::vector<std::string> Args;
+};
+
+struct query_snapshot
+{
+    unsigned int Generation;
+    std::map<std::string, std::string> Responses;
+};
+
+struct config_source
+{
+    std::string Path;
+    long long Size;
+    unsigned int Hash;
+};
+
+struct startup_phase
+{
+    const char *Name;
+    bool Concurrent;
+    bool Done;
+    double Start;
+    double Duration;
+};
+
+struct config_line
+{
+    config_line_type Type;
+    std::string Text;
+};
+
+struct config_settings
+{
+    std::vector<hotkey> Hotkeys;
+    hotkey PrefixKey;
+    bool PrefixEnabled;
+
+    std::vector<window_rule> WindowRules;
+    std::map<space_identifier, space_settings> SpaceSettings;
+    std::map<unsigned int, space_settings> DisplaySettings;
+    std::map<std::string, std::vector<CFTypeRef> > AllowedWindowRoles;
+};
+
+struct parsed_command
+{
+    std::string Message;
+    kwm_command *Command;
+    std::vector<std::string> Args;
+};
+
+struct kwm_subscriber
+{
+    int SockFD;
+    unsigned int Events;
+    bool Alive;
+};
+
 struct kwm_mach
 {
     void *WorkspaceWatcher;
@@ -339,7 +539,6 @@ struct kwm_border
 
 struct kwm_prefix
 {
-    kwm_time_point Time;
     hotkey Key;
 
     double Timeout;
@@ -351,8 +550,15 @@ struct kwm_prefix
 
 struct kwm_hotkeys
 {
-    std::queue<hotkey> Queue;
+    kwm_key_queue Queue;
     std::vector<hotkey> List;
+    hotkey_table Tables[2];
+    std::atomic<hotkey_table *> Table;
+    std::atomic<int> Readers;
+
+    std::atomic<unsigned long long> State;
+    std::atomic<long long> Deadline;
+    double SequenceTimeout;
     kwm_prefix Prefix;
     modifiers SpacesKey;
 };
@@ -363,6 +569,7 @@ struct kwm_toggles
     bool EnableTilingMode;
     bool UseBuiltinHotkeys;
     bool StandbyOnFloat;
+    bool StartupReport;
 };
 
 struct kwm_path
@@ -381,6 +588,7 @@ struct kwm_focus
 
     ProcessSerialNumber PSN;
     window_info *Window;
+    unsigned int OwnerAtom;
     window_info Cache;
     window_info NULLWindowInfo;
     window_info InsertionPoint;
@@ -9,6 +9,9 @@
 #include "border.h"
 #include "helpers.h"
 #include "rules.h"
+#include "daemon.h"
+#include "state.h"
+#include "cache.h"
 
 #include <cmath>
 
@@ -23,6 +26,8 @@ extern kwm_thread KWMThread;
 extern kwm_border MarkedBorder;
 extern kwm_border FocusedBorder;
 
+CFArrayRef WindowListSnapshot = NULL;
+
 bool WindowsAreEqual(window_info *Window, window_info *Match)
 {
     if(Window && Match)
@@ -36,6 +41,25 @@ bool WindowsAreEqual(window_info *Window, window_info *Match)
     return false;
 }
 
+bool WindowListsAreEqual(std::vector<window_info> *A, std::vector<window_info> *B)
+{
+    if(A->size() != B->size())
+        return false;
+
+    for(std::size_t WindowIndex = 0; WindowIndex < A->size(); ++WindowIndex)
+    {
+        window_info *Window = &(*A)[WindowIndex];
+        window_info *Match = &(*B)[WindowIndex];
+        if(!WindowsAreEqual(Window, Match) ||
+           Window->X != Match->X || Window->Y != Match->Y ||
+           Window->Width != Match->Width || Window->Height != Match->Height ||
+           Window->Name != Match->Name || Window->Float != Match->Float)
+            return false;
+    }
+
+    return true;
+}
+
 std::vector<window_info> FilterWindowListAllDisplays()
 {
     std::vector<window_info> FilteredWindowLst;
@@ -162,6 +186,7 @@ void ClearFocusedWindow()
     ClearBorder(&FocusedBorder);
     KWMFocus.Window = NULL;
     KWMFocus.Cache = KWMFocus.NULLWindowInfo;
+    KwmEmitEvent(EventTypeFocus);
 }
 
 bool GetWindowFocusedByOSX(AXUIElementRef *WindowRef)
@@ -290,13 +315,34 @@ void UpdateWindowTree()
     }
 }
 
-void UpdateActiveWindowList(screen_info *Screen)
+CFArrayRef CopyOnScreenWindowList()
 {
     static CGWindowListOption OsxWindowListOption = kCGWindowListOptionOnScreenOnly |
                                                     kCGWindowListExcludeDesktopElements;
 
-    KWMTiling.WindowLst.clear();
-    CFArrayRef OsxWindowLst = CGWindowListCopyWindowInfo(OsxWindowListOption, kCGNullWindowID);
+    return CGWindowListCopyWindowInfo(OsxWindowListOption, kCGNullWindowID);
+}
+
+/* The window list copied during startup, while the config is executed, is handed
+ * to the first UpdateActiveWindowList instead of asking the window server again.
+ * Any snapshot that was not used is released when a new one is set. */
+void SetWindowListSnapshot(CFArrayRef Snapshot)
+{
+    if(WindowListSnapshot)
+        CFRelease(WindowListSnapshot);
+
+    WindowListSnapshot = Snapshot;
+}
+
+void UpdateActiveWindowList(screen_info *Screen)
+{
+    std::vector<window_info> PreviousWindowLst;
+    PreviousWindowLst.swap(KWMTiling.WindowLst);
+    CFArrayRef OsxWindowLst = WindowListSnapshot;
+    WindowListSnapshot = NULL;
+    if(!OsxWindowLst)
+        OsxWindowLst = CopyOnScreenWindowList();
+
     if(!OsxWindowLst)
         return;
 
@@ -315,6 +361,8 @@ void UpdateActiveWindowList(screen_info *Screen)
         CheckWindowRules(&KWMTiling.WindowLst[Index]);
 
     KWMTiling.FocusLst = KWMTiling.WindowLst;
+    if(!WindowListsAreEqual(&PreviousWindowLst, &KWMTiling.WindowLst))
+        KwmBumpGeneration();
 }
 
 std::vector<int> GetAllWindowIDsInTree(space_info *Space)
@@ -925,9 +973,9 @@ void ToggleFocusedWindowParentContainer()
 
         if(KWMTiling.LockToContainer)
         {
-            UpdateBorder("focused");
+            UpdateBorder(BorderTypeFocused);
             if(KWMFocus.Window->WID == KWMScreen.MarkedWindow)
-                UpdateBorder("marked");
+                UpdateBorder(BorderTypeMarked);
 
             CreateApplicationNotifications();
         }
@@ -970,9 +1018,9 @@ void ToggleFocusedWindowFullscreen()
 
         if(KWMTiling.LockToContainer)
         {
-            UpdateBorder("focused");
+            UpdateBorder(BorderTypeFocused);
             if(KWMFocus.Window->WID == KWMScreen.MarkedWindow)
-                UpdateBorder("marked");
+                UpdateBorder(BorderTypeMarked);
 
             CreateApplicationNotifications();
         }
@@ -1030,11 +1078,11 @@ void DetachAndReinsertWindow(int WindowID, int Degrees)
            WindowID == -1)
             return;
 
-        window_info InsertWindow = {};
+        window_info *InsertWindow = NULL;
         if(FindClosestWindow(Degrees, &InsertWindow, false))
         {
             ToggleWindowFloating(WindowID, false);
-            KWMScreen.MarkedWindow = InsertWindow.WID;
+            KWMScreen.MarkedWindow = InsertWindow->WID;
             ToggleWindowFloating(WindowID, false);
             MoveCursorToCenterOfFocusedWindow();
         }
@@ -1094,7 +1142,7 @@ void SwapFocusedWindowWithNearest(int Shift)
 
                 if(Link->WindowID == KWMScreen.MarkedWindow ||
                    ShiftNode->WindowID == KWMScreen.MarkedWindow)
-                    UpdateBorder("marked");
+                    UpdateBorder(BorderTypeMarked);
             }
         }
     }
@@ -1117,7 +1165,7 @@ void SwapFocusedWindowWithNearest(int Shift)
 
                 if(TreeNode->WindowID == KWMScreen.MarkedWindow ||
                    NewFocusNode->WindowID == KWMScreen.MarkedWindow)
-                    UpdateBorder("marked");
+                    UpdateBorder(BorderTypeMarked);
             }
         }
     }
@@ -1142,9 +1190,9 @@ void SwapFocusedWindowDirected(int Degrees)
         if(TreeNode)
         {
             tree_node *NewFocusNode = NULL;
-            window_info SwapWindow = {};
+            window_info *SwapWindow = NULL;
             if(FindClosestWindow(Degrees, &SwapWindow, KWMMode.Cycle == CycleModeScreen))
-                NewFocusNode = GetTreeNodeFromWindowID(Space->RootNode, SwapWindow.WID);
+                NewFocusNode = GetTreeNodeFromWindowID(Space->RootNode, SwapWindow->WID);
 
             if(NewFocusNode)
             {
@@ -1153,7 +1201,7 @@ void SwapFocusedWindowDirected(int Degrees)
 
                 if(TreeNode->WindowID == KWMScreen.MarkedWindow ||
                    NewFocusNode->WindowID == KWMScreen.MarkedWindow)
-                    UpdateBorder("marked");
+                    UpdateBorder(BorderTypeMarked);
             }
         }
     }
@@ -1189,6 +1237,14 @@ void GetCenterOfWindow(window_info *Window, int *X, int *Y)
     *Y = Window->Y + Window->Height / 2;
 }
 
+double GetCenterDistance(int X1, int Y1, int X2, int Y2)
+{
+    int ScoreX = X1 >= X2 - 15 && X1 <= X2 + 15 ? 1 : 11;
+    int ScoreY = Y1 >= Y2 - 10 && Y1 <= Y2 + 10 ? 1 : 22;
+    int Weight = ScoreX * ScoreY;
+    return std::sqrt(std::pow(X2-X1, 2) + std::pow(Y2-Y1, 2)) + Weight;
+}
+
 double GetWindowDistance(window_info *A, window_info *B)
 {
     double Dist = INT_MAX;
@@ -1198,57 +1254,51 @@ double GetWindowDistance(window_info *A, window_info *B)
         int X1, Y1, X2, Y2;
         GetCenterOfWindow(A, &X1, &Y1);
         GetCenterOfWindow(B, &X2, &Y2);
-
-        int ScoreX = X1 >= X2 - 15 && X1 <= X2 + 15 ? 1 : 11;
-        int ScoreY = Y1 >= Y2 - 10 && Y1 <= Y2 + 10 ? 1 : 22;
-        int Weight = ScoreX * ScoreY;
-        Dist = std::sqrt(std::pow(X2-X1, 2) + std::pow(Y2-Y1, 2)) + Weight;
+        Dist = GetCenterDistance(X1, Y1, X2, Y2);
     }
 
     return Dist;
 }
 
-bool FindClosestWindow(int Degrees, window_info *Target, bool Wrap)
+/* Target points into KWMTiling.WindowLst and is only valid until the window list
+ * is updated again. Wrapping only moves the center of a candidate, so no window
+ * is copied while searching. */
+bool FindClosestWindow(int Degrees, window_info **Target, bool Wrap)
 {
-    *Target = KWMFocus.Cache;
+    *Target = NULL;
     window_info *Match = KWMFocus.Window;
-    std::vector<window_info> Windows = KWMTiling.WindowLst;
+    std::vector<window_info> &Windows = KWMTiling.WindowLst;
 
     int MatchX, MatchY;
     GetCenterOfWindow(Match, &MatchX, &MatchY);
 
     double MinDist = INT_MAX;
-    for(int Index = 0; Index < Windows.size(); ++Index)
+    for(std::size_t Index = 0; Index < Windows.size(); ++Index)
     {
         if(!WindowsAreEqual(Match, &Windows[Index]) &&
            WindowIsInDirection(Match, &Windows[Index], Degrees, Wrap) &&
            !IsWindowFloating(Windows[Index].WID, NULL))
         {
-            window_info FocusWindow = Windows[Index];
+            int WindowX, WindowY;
+            GetCenterOfWindow(&Windows[Index], &WindowX, &WindowY);
 
             if(Wrap)
             {
-                int WindowX, WindowY;
-                GetCenterOfWindow(&Windows[Index], &WindowX, &WindowY);
-
-                window_info WrappedWindow = Windows[Index];
                 if(Degrees == 0 && MatchY < WindowY)
-                    WrappedWindow.Y -= KWMScreen.Current->Height;
+                    WindowY -= KWMScreen.Current->Height;
                 else if(Degrees == 180 && MatchY > WindowY)
-                    WrappedWindow.Y += KWMScreen.Current->Height;
+                    WindowY += KWMScreen.Current->Height;
                 else if(Degrees == 90 && MatchX > WindowX)
-                    WrappedWindow.X += KWMScreen.Current->Width;
+                    WindowX += KWMScreen.Current->Width;
                 else if(Degrees == 270 && MatchX < WindowX)
-                    WrappedWindow.X -= KWMScreen.Current->Width;
-
-                FocusWindow = WrappedWindow;
+                    WindowX -= KWMScreen.Current->Width;
             }
 
-            double Dist = GetWindowDistance(Match, &FocusWindow);
+            double Dist = GetCenterDistance(MatchX, MatchY, WindowX, WindowY);
             if(Dist < MinDist)
             {
                 MinDist = Dist;
-                *Target = Windows[Index];
+                *Target = &Windows[Index];
             }
         }
     }
@@ -1264,13 +1314,13 @@ void ShiftWindowFocusDirected(int Degrees)
     space_info *Space = GetActiveSpaceOfScreen(KWMScreen.Current);
     if(Space->Settings.Mode == SpaceModeBSP)
     {
-        window_info NewFocusWindow = {};
+        window_info *NewFocusWindow = NULL;
         if((KWMMode.Cycle == CycleModeDisabled &&
             FindClosestWindow(Degrees, &NewFocusWindow, false)) ||
            (KWMMode.Cycle == CycleModeScreen &&
             FindClosestWindow(Degrees, &NewFocusWindow, true)))
         {
-            SetWindowFocus(&NewFocusWindow);
+            SetWindowFocus(NewFocusWindow);
             MoveCursorToCenterOfFocusedWindow();
         }
     }
@@ -1438,6 +1488,7 @@ void ClearMarkedWindow()
 {
     KWMScreen.MarkedWindow = -1;
     ClearBorder(&MarkedBorder);
+    KwmUpdateStatePage();
 }
 
 void MarkWindowContainer(window_info *Window)
@@ -1453,7 +1504,8 @@ void MarkWindowContainer(window_info *Window)
         {
             DEBUG("MarkWindowContainer() Marked " << Window->Name);
             KWMScreen.MarkedWindow = Window->WID;
-            UpdateBorder("marked");
+            UpdateBorder(BorderTypeMarked);
+            KwmUpdateStatePage();
         }
     }
 }
@@ -1467,15 +1519,19 @@ void SetKwmFocus(AXUIElementRef WindowRef)
 {
     int OldProcessPID = KWMFocus.Window ? KWMFocus.Window->PID : -1;
 
-    KWMFocus.Cache = GetWindowByRef(WindowRef);
+    window_info *Window = GetWindowByID(GetWindowIDFromRef(WindowRef));
+    KWMFocus.Cache = Window ? *Window : KWMFocus.NULLWindowInfo;
     if(WindowsAreEqual(&KWMFocus.Cache, &KWMFocus.NULLWindowInfo))
     {
         KWMFocus.Window = NULL;
         ClearBorder(&FocusedBorder);
+        KwmEmitEvent(EventTypeFocus);
         return;
     }
 
     KWMFocus.Window = &KWMFocus.Cache;
+    if(OldProcessPID != KWMFocus.Window->PID)
+        KWMFocus.OwnerAtom = KwmGetOwnerAtom(KWMFocus.Window->Owner);
     ProcessSerialNumber NewPSN;
     GetProcessForPID(KWMFocus.Window->PID, &NewPSN);
     KWMFocus.PSN = NewPSN;
@@ -1486,7 +1542,7 @@ void SetKwmFocus(AXUIElementRef WindowRef)
            !KWMFocus.Observer)
             CreateApplicationNotifications();
 
-        UpdateBorder("focused");
+        UpdateBorder(BorderTypeFocused);
     }
 
     if(KWMToggles.EnableTilingMode)
@@ -1499,21 +1555,27 @@ void SetKwmFocus(AXUIElementRef WindowRef)
        KWMMode.Focus != FocusModeAutofocus &&
        KWMToggles.StandbyOnFloat)
         KWMMode.Focus = IsFocusedWindowFloating() ? FocusModeStandby : FocusModeAutoraise;
+
+    KwmEmitEvent(EventTypeFocus);
 }
 
 void SetWindowRefFocus(AXUIElementRef WindowRef)
 {
     int OldProcessPID = KWMFocus.Window ? KWMFocus.Window->PID : -1;
 
-    KWMFocus.Cache = GetWindowByRef(WindowRef);
+    window_info *Window = GetWindowByID(GetWindowIDFromRef(WindowRef));
+    KWMFocus.Cache = Window ? *Window : KWMFocus.NULLWindowInfo;
     if(WindowsAreEqual(&KWMFocus.Cache, &KWMFocus.NULLWindowInfo))
     {
         KWMFocus.Window = NULL;
         ClearBorder(&FocusedBorder);
+        KwmEmitEvent(EventTypeFocus);
         return;
     }
 
     KWMFocus.Window = &KWMFocus.Cache;
+    if(OldProcessPID != KWMFocus.Window->PID)
+        KWMFocus.OwnerAtom = KwmGetOwnerAtom(KWMFocus.Window->Owner);
     KWMFocus.InsertionPoint = KWMFocus.Cache;
 
     ProcessSerialNumber NewPSN;
@@ -1533,7 +1595,7 @@ void SetWindowRefFocus(AXUIElementRef WindowRef)
            !KWMFocus.Observer)
             CreateApplicationNotifications();
 
-        UpdateBorder("focused");
+        UpdateBorder(BorderTypeFocused);
     }
 
     if(KWMToggles.EnableTilingMode)
@@ -1547,6 +1609,8 @@ void SetWindowRefFocus(AXUIElementRef WindowRef)
        KWMMode.Focus != FocusModeAutofocus &&
        KWMToggles.StandbyOnFloat)
         KWMMode.Focus = IsFocusedWindowFloating() ? FocusModeStandby : FocusModeAutoraise;
+
+    KwmEmitEvent(EventTypeFocus);
 }
 
 void SetWindowFocus(window_info *Window)
@@ -12,6 +12,7 @@ bool IsAnyWindowBelowCursor();
 bool IsWindowBelowCursor(window_info *Window);
 bool IsWindowOnActiveSpace(int WindowID);
 bool WindowsAreEqual(window_info *Window, window_info *Match);
+bool WindowListsAreEqual(std::vector<window_info> *A, std::vector<window_info> *B);
 
 void ClearFocusedWindow();
 bool GetWindowFocusedByOSX(AXUIElementRef *WindowRef);
@@ -21,6 +22,8 @@ void FocusWindowBelowCursor();
 void UpdateWindowTree();
 std::vector<window_info> FilterWindowListAllDisplays();
 bool FilterWindowList(screen_info *Screen);
+CFArrayRef CopyOnScreenWindowList();
+void SetWindowListSnapshot(CFArrayRef Snapshot);
 void UpdateActiveWindowList(screen_info *Screen);
 void CreateWindowNodeTree(screen_info *Screen, std::vector<window_info*> *Windows);
 void ShouldWindowNodeTreeUpdate(screen_info *Screen);
@@ -58,7 +61,8 @@ void FocusWindowByID(int WindowID);
 void ShiftWindowFocus(int Shift);
 void ShiftSubTreeWindowFocus(int Shift);
 void ShiftWindowFocusDirected(int Degrees);
-bool FindClosestWindow(int Degrees, window_info *Target, bool Wrap);
+bool FindClosestWindow(int Degrees, window_info **Target, bool Wrap);
+double GetCenterDistance(int X1, int Y1, int X2, int Y2);
 double GetWindowDistance(window_info *A, window_info *B);
 void GetCenterOfWindow(window_info *Window, int *X, int *Y);
 bool WindowIsInDirection(window_info *A, window_info *B, int Degrees, bool Wrap);
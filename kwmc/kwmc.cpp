@@ -1,17 +1,64 @@
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
+#ifdef __APPLE__
 #include <libproc.h>
+#endif
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "../kwm/state.h"
 
 #define KwmDaemonPort 3020
 
 int KwmcSockFD;
 
+struct kwmc_bench_command
+{
+    std::string Message;
+    int Weight;
+};
+
+struct kwmc_bench_sample
+{
+    int Command;
+    double Latency;
+};
+
+struct kwmc_bench_client
+{
+    pthread_t Thread;
+    int Index;
+    int Errors;
+    std::vector<kwmc_bench_sample> Samples;
+};
+
+struct kwmc_bench
+{
+    std::vector<kwmc_bench_command> Commands;
+    int TotalWeight;
+    int Clients;
+    int Port;
+    double Rate;
+    double Duration;
+    std::chrono::steady_clock::time_point Start;
+};
+
+kwmc_bench KwmcBench;
+
 void Fatal(const std::string &err)
 {
     std::cout << err << std::endl;
@@ -42,7 +89,7 @@ void WriteToSocket(std::string Msg)
     close(KwmcSockFD);
 }
 
-void KwmcForwardMessageThroughSocket(int argc, char **argv)
+std::string KwmcCreateMessage(int argc, char **argv)
 {
     std::string Msg;
     for(int i = 1; i < argc; ++i)
@@ -53,7 +100,28 @@ void KwmcForwardMessageThroughSocket(int argc, char **argv)
             Msg += " ";
     }
 
-    WriteToSocket(Msg);
+    return Msg;
+}
+
+void KwmcForwardMessageThroughSocket(int argc, char **argv)
+{
+    WriteToSocket(KwmcCreateMessage(argc, argv));
+}
+
+void KwmcSubscribe(int argc, char **argv)
+{
+    std::string Msg = KwmcCreateMessage(argc, argv) + "\n";
+    send(KwmcSockFD, Msg.c_str(), Msg.size(), 0);
+
+    char Buffer[512];
+    ssize_t Bytes;
+    while((Bytes = recv(KwmcSockFD, Buffer, sizeof(Buffer), 0)) > 0)
+    {
+        std::cout.write(Buffer, Bytes);
+        std::cout.flush();
+    }
+
+    close(KwmcSockFD);
 }
 
 void KwmcConnectToDaemon()
@@ -74,6 +142,278 @@ void KwmcConnectToDaemon()
         Fatal("Connection failed!");
 }
 
+bool KwmcReadStatePage(kwm_state_page *Snapshot)
+{
+    const char *Home = getenv("HOME");
+    if(!Home)
+        return false;
+
+    std::string File = std::string(Home) + "/.kwm/" + KWM_STATE_PAGE_FILE;
+    int FileFD = open(File.c_str(), O_RDONLY);
+    if(FileFD == -1)
+        return false;
+
+    struct stat Info;
+    if(fstat(FileFD, &Info) == -1 || Info.st_size < (off_t) sizeof(kwm_state_page))
+    {
+        close(FileFD);
+        return false;
+    }
+
+    void *Memory = mmap(NULL, sizeof(kwm_state_page), PROT_READ, MAP_SHARED, FileFD, 0);
+    close(FileFD);
+    if(Memory == MAP_FAILED)
+        return false;
+
+    bool Result = ReadStatePage((kwm_state_page*) Memory, Snapshot) &&
+                  Snapshot->PID != 0 &&
+                  kill(Snapshot->PID, 0) == 0;
+
+    munmap(Memory, sizeof(kwm_state_page));
+    return Result;
+}
+
+bool KwmcQueryStatePage(int argc, char **argv)
+{
+    if(argc != 4 || std::string(argv[2]) != "query")
+        return false;
+
+    kwm_state_page Page;
+    if(!KwmcReadStatePage(&Page))
+        return false;
+
+    std::string Query = argv[3];
+    std::string Output;
+    if(Query == "focused")
+    {
+        Output = Page.Tag;
+        if(Page.FocusedWindowID != -1)
+            Output += " " + std::string(Page.Owner) + (Page.Title[0] ? " - " + std::string(Page.Title) : "");
+    }
+    else if(Query == "current")
+    {
+        Output = std::to_string(Page.FocusedWindowID);
+    }
+    else if(Query == "marked")
+    {
+        Output = std::to_string(Page.MarkedWindowID);
+    }
+    else if(Query == "tag")
+    {
+        Output = Page.Tag;
+    }
+    else if(Query == "prefix")
+    {
+        Output = Page.PrefixActive ? "active" : "inactive";
+    }
+    else if(Query == "split-ratio")
+    {
+        Output = std::to_string(Page.SplitRatio);
+        Output.erase(Output.find_last_not_of('0') + 1, std::string::npos);
+    }
+    else
+    {
+        return false;
+    }
+
+    std::cout << Output << std::endl;
+    return true;
+}
+
+bool KwmcBenchRequest(const std::string &Message)
+{
+    int SockFD = socket(PF_INET, SOCK_STREAM, 0);
+    if(SockFD == -1)
+        return false;
+
+    struct sockaddr_in SrvAddr = {};
+    SrvAddr.sin_family = AF_INET;
+    SrvAddr.sin_port = htons(KwmcBench.Port);
+    SrvAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool Result = false;
+    if(connect(SockFD, (struct sockaddr*) &SrvAddr, sizeof(SrvAddr)) != -1 &&
+       send(SockFD, Message.c_str(), Message.size(), 0) == (ssize_t) Message.size())
+    {
+        char Buffer[4096];
+        ssize_t Bytes;
+        while((Bytes = recv(SockFD, Buffer, sizeof(Buffer), 0)) > 0);
+        Result = Bytes == 0;
+    }
+
+    close(SockFD);
+    return Result;
+}
+
+int KwmcBenchPickCommand(unsigned int *Seed)
+{
+    int Pick = rand_r(Seed) % KwmcBench.TotalWeight;
+    for(std::size_t Index = 0; Index < KwmcBench.Commands.size(); ++Index)
+    {
+        Pick -= KwmcBench.Commands[Index].Weight;
+        if(Pick < 0)
+            return Index;
+    }
+
+    return 0;
+}
+
+/* With a target rate every client sends on a fixed schedule and latency is
+ * measured from the time a request was scheduled, not from when it was sent,
+ * so a daemon that falls behind shows up in the tail instead of silently
+ * lowering the offered load. Without a rate each client sends back to back. */
+void *KwmcBenchClient(void *Data)
+{
+    typedef std::chrono::steady_clock clock;
+    kwmc_bench_client *Client = (kwmc_bench_client*) Data;
+    unsigned int Seed = 0x9e3779b9 * (Client->Index + 1);
+
+    clock::duration Interval = clock::duration::zero();
+    if(KwmcBench.Rate > 0)
+        Interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(KwmcBench.Clients / KwmcBench.Rate));
+
+    clock::time_point End = KwmcBench.Start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(KwmcBench.Duration));
+    clock::time_point Next = KwmcBench.Start + (Interval * Client->Index) / KwmcBench.Clients;
+
+    while(true)
+    {
+        clock::time_point Scheduled = clock::now();
+        if(Interval != clock::duration::zero())
+        {
+            std::this_thread::sleep_until(Next);
+            Scheduled = Next;
+            Next += Interval;
+        }
+
+        if(Scheduled >= End)
+            break;
+
+        int Command = KwmcBenchPickCommand(&Seed);
+        if(KwmcBenchRequest(KwmcBench.Commands[Command].Message))
+        {
+            kwmc_bench_sample Sample;
+            Sample.Command = Command;
+            Sample.Latency = std::chrono::duration<double, std::micro>(clock::now() - Scheduled).count();
+            Client->Samples.push_back(Sample);
+        }
+        else
+        {
+            ++Client->Errors;
+        }
+    }
+
+    return NULL;
+}
+
+double KwmcBenchPercentile(std::vector<double> &Sorted, double Percentile)
+{
+    if(Sorted.empty())
+        return 0;
+
+    std::size_t Index = (std::size_t)(Percentile * Sorted.size());
+    return Sorted[std::min(Index, Sorted.size() - 1)];
+}
+
+void KwmcBenchReport(const char *Name, std::vector<double> &Latencies)
+{
+    std::sort(Latencies.begin(), Latencies.end());
+    printf("%-24s %8zu  p50 %9.1fus  p99 %9.1fus  p999 %9.1fus  max %9.1fus\n",
+           Name, Latencies.size(),
+           KwmcBenchPercentile(Latencies, 0.50),
+           KwmcBenchPercentile(Latencies, 0.99),
+           KwmcBenchPercentile(Latencies, 0.999),
+           Latencies.empty() ? 0 : Latencies.back());
+}
+
+void KwmcRunBench(int argc, char **argv)
+{
+    KwmcBench.Clients = 4;
+    KwmcBench.Port = KwmDaemonPort;
+    KwmcBench.Rate = 0;
+    KwmcBench.Duration = 5;
+    KwmcBench.TotalWeight = 0;
+
+    for(int Index = 2; Index < argc; ++Index)
+    {
+        std::string Arg = argv[Index];
+        if(Arg == "-c" && Index + 1 < argc)
+            KwmcBench.Clients = std::max(1, atoi(argv[++Index]));
+        else if(Arg == "-r" && Index + 1 < argc)
+            KwmcBench.Rate = atof(argv[++Index]);
+        else if(Arg == "-d" && Index + 1 < argc)
+            KwmcBench.Duration = atof(argv[++Index]);
+        else if(Arg == "-p" && Index + 1 < argc)
+            KwmcBench.Port = atoi(argv[++Index]);
+        else
+        {
+            kwmc_bench_command Command = { Arg, 1 };
+            std::size_t Split = Arg.find(':');
+            if(Split != std::string::npos && Split > 0 &&
+               Arg.find_first_not_of("0123456789") == Split)
+            {
+                Command.Weight = atoi(Arg.substr(0, Split).c_str());
+                Command.Message = Arg.substr(Split + 1);
+            }
+
+            if(Command.Weight > 0 && !Command.Message.empty())
+                KwmcBench.Commands.push_back(Command);
+        }
+    }
+
+    if(KwmcBench.Commands.empty())
+    {
+        kwmc_bench_command Command = { "query focused", 1 };
+        KwmcBench.Commands.push_back(Command);
+    }
+
+    for(std::size_t Index = 0; Index < KwmcBench.Commands.size(); ++Index)
+    {
+        KwmcBench.Commands[Index].Message += "\n";
+        KwmcBench.TotalWeight += KwmcBench.Commands[Index].Weight;
+    }
+
+    std::vector<kwmc_bench_client> Clients(KwmcBench.Clients);
+    KwmcBench.Start = std::chrono::steady_clock::now();
+    for(int Index = 0; Index < KwmcBench.Clients; ++Index)
+    {
+        Clients[Index].Index = Index;
+        Clients[Index].Errors = 0;
+        if(pthread_create(&Clients[Index].Thread, NULL, &KwmcBenchClient, &Clients[Index]) != 0)
+            Fatal("Could not create bench client!");
+    }
+
+    int Errors = 0;
+    std::vector<double> Total;
+    std::vector<std::vector<double> > PerCommand(KwmcBench.Commands.size());
+    for(int Index = 0; Index < KwmcBench.Clients; ++Index)
+    {
+        pthread_join(Clients[Index].Thread, NULL);
+        Errors += Clients[Index].Errors;
+        for(std::size_t Sample = 0; Sample < Clients[Index].Samples.size(); ++Sample)
+        {
+            kwmc_bench_sample *Current = &Clients[Index].Samples[Sample];
+            Total.push_back(Current->Latency);
+            PerCommand[Current->Command].push_back(Current->Latency);
+        }
+    }
+
+    double Elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - KwmcBench.Start).count();
+    printf("clients %d, target rate %s, %.2fs: %zu requests, %d errors, %.1f req/s\n",
+           KwmcBench.Clients,
+           KwmcBench.Rate > 0 ? std::to_string((int)KwmcBench.Rate).c_str() : "max",
+           Elapsed, Total.size(), Errors, Total.size() / Elapsed);
+
+    for(std::size_t Index = 0; Index < KwmcBench.Commands.size(); ++Index)
+    {
+        std::string Name = KwmcBench.Commands[Index].Message;
+        Name.erase(Name.size() - 1);
+        KwmcBenchReport(Name.c_str(), PerCommand[Index]);
+    }
+
+    if(KwmcBench.Commands.size() > 1)
+        KwmcBenchReport("total", Total);
+}
+
 void KwmcInterpreter()
 {
     while(true)
@@ -95,6 +435,23 @@ int main(int argc, char **argv)
         std::string Command = argv[1];
         if(Command == "interpret")
             KwmcInterpreter();
+        else if(Command == "--shm")
+        {
+            if(!KwmcQueryStatePage(argc, argv))
+            {
+                KwmcConnectToDaemon();
+                KwmcForwardMessageThroughSocket(argc - 1, argv + 1);
+            }
+        }
+        else if(Command == "bench")
+        {
+            KwmcRunBench(argc, argv);
+        }
+        else if(Command == "subscribe")
+        {
+            KwmcConnectToDaemon();
+            KwmcSubscribe(argc, argv);
+        }
         else
         {
             KwmcConnectToDaemon();
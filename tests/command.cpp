@@ -0,0 +1,107 @@
+#include "../kwm/interpreter.h"
+#include "../kwm/helpers.h"
+
+#include <new>
+
+/* Resolving a command that was seen before must not touch the heap: the argument
+ * vector is reused, and the arguments of these commands fit in a std::string
+ * without allocating. operator new is replaced to count every allocation made
+ * while Counting is set. */
+
+bool Counting = false;
+long Allocations = 0;
+
+void *operator new(std::size_t Size)
+{
+    if(Counting)
+        ++Allocations;
+
+    void *Memory = malloc(Size ? Size : 1);
+    if(!Memory)
+        throw std::bad_alloc();
+
+    return Memory;
+}
+
+void operator delete(void *Memory) noexcept
+{
+    free(Memory);
+}
+
+void operator delete(void *Memory, std::size_t) noexcept
+{
+    free(Memory);
+}
+
+void KwmInitStubBackend(int Windows);
+
+const char *Commands[] =
+{
+    "config focused-border size 4",
+    "config split-ratio 0.5",
+    "window -f east",
+    "window -s prev",
+    "window -c split-mode toggle",
+    "space -t bsp",
+    "query focused",
+    "query split-mode global",
+    "query dir east wrap",
+};
+
+int main()
+{
+    KwmInitStubBackend(4);
+    KwmInitInterpreter();
+
+    int Failures = 0;
+    std::vector<std::string> Args;
+    std::string Error;
+    for(std::size_t Index = 0; Index < sizeof(Commands) / sizeof(Commands[0]); ++Index)
+    {
+        std::string Message = Commands[Index];
+        kwm_command *Command = NULL;
+        if(!KwmCompileCommand(Message, &Command, Args, Error))
+        {
+            printf("command: '%s' does not resolve: %s\n", Commands[Index], Error.c_str());
+            ++Failures;
+            continue;
+        }
+
+        Allocations = 0;
+        Counting = true;
+        for(int Repeat = 0; Repeat < 100; ++Repeat)
+            KwmCompileCommand(Message, &Command, Args, Error);
+        Counting = false;
+
+        if(Allocations)
+        {
+            printf("command: '%s' allocated %.2f times per dispatch\n", Commands[Index], Allocations / 100.0);
+            ++Failures;
+        }
+    }
+
+    std::string Line = "cmd-alt-ctrl-l";
+    std::string Number = "1234", Decimal = "0.75", Hex = "0xFF00FF00";
+    Allocations = 0;
+    Counting = true;
+    int Value = ConvertStringToInt(Number);
+    double Ratio = ConvertStringToDouble(Decimal);
+    unsigned int Color = ConvertHexStringToInt(Hex);
+    bool Prefixed = IsPrefixOfString(Line, "cmd");
+    Counting = false;
+
+    if(Allocations)
+    {
+        printf("command: the conversion helpers allocated %ld times\n", Allocations);
+        ++Failures;
+    }
+
+    if(Value != 1234 || Ratio != 0.75 || Color != 0xFF00FF00 || !Prefixed || Line != "alt-ctrl-l")
+    {
+        printf("command: the conversion helpers returned the wrong values\n");
+        ++Failures;
+    }
+
+    printf("command: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+#include "../kwm/types.h"
+#include "../kwm/daemon.h"
+#include "../kwm/cache.h"
+
+#include <algorithm>
+
+/* A hotkey thread moves focus every millisecond, the way a held key repeats, and
+ * times how long it waits for KWMThread.Lock, first with an idle daemon and then
+ * while dashboard clients keep all daemon threads busy with queries. Queries only
+ * take the lock to build a query snapshot, at most once per generation for every
+ * distinct query, so the number of builds is bounded by the number of mutations
+ * however fast the clients poll. The window backend is the one of kwm-stub. */
+
+#define CLIENTS 4
+#define SECONDS 1
+
+extern int KwmDaemonPort;
+extern kwm_thread KWMThread;
+extern unsigned int KwmQuerySnapshotBuilds;
+
+void KwmInitStubBackend(int Windows);
+void ShiftWindowFocus(int Shift);
+
+const char *Queries[] =
+{
+    "query focused\n",
+    "query tag\n",
+    "query current\n",
+    "query split-mode global\n",
+};
+
+#define QUERIES (int) (sizeof(Queries) / sizeof(Queries[0]))
+
+std::atomic<bool> ClientsRunning(false);
+long Answered[CLIENTS];
+
+bool SendQuery(const char *Message)
+{
+    int SockFD = socket(PF_INET, SOCK_STREAM, 0);
+    if(SockFD == -1)
+        return false;
+
+    struct sockaddr_in SrvAddr = {};
+    SrvAddr.sin_family = AF_INET;
+    SrvAddr.sin_port = htons(KwmDaemonPort);
+    SrvAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    bool Result = false;
+    if(connect(SockFD, (struct sockaddr*) &SrvAddr, sizeof(SrvAddr)) != -1 &&
+       send(SockFD, Message, strlen(Message), 0) == (ssize_t) strlen(Message))
+    {
+        char Buffer[256];
+        ssize_t Bytes, Total = 0;
+        while((Bytes = recv(SockFD, Buffer, sizeof(Buffer), 0)) > 0)
+            Total += Bytes;
+
+        Result = Bytes == 0 && Total > 0;
+    }
+
+    close(SockFD);
+    return Result;
+}
+
+void *QueryClient(void *Data)
+{
+    long Index = (long) Data;
+    for(int Query = Index; ClientsRunning; ++Query)
+    {
+        if(SendQuery(Queries[Query % QUERIES]))
+            ++Answered[Index];
+    }
+
+    return NULL;
+}
+
+/* Returns the number of mutations; Waits receives how long each one waited for
+ * the lock, in microseconds. */
+int RunMutations(std::vector<double> &Waits)
+{
+    Waits.clear();
+    std::chrono::steady_clock::time_point End = std::chrono::steady_clock::now() + std::chrono::seconds(SECONDS);
+    while(std::chrono::steady_clock::now() < End)
+    {
+        std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+        pthread_mutex_lock(&KWMThread.Lock);
+        std::chrono::duration<double, std::micro> Wait = std::chrono::steady_clock::now() - Start;
+        ShiftWindowFocus(1);
+        KwmBumpGeneration();
+        pthread_mutex_unlock(&KWMThread.Lock);
+
+        Waits.push_back(Wait.count());
+        usleep(1000);
+    }
+
+    std::sort(Waits.begin(), Waits.end());
+    return Waits.size();
+}
+
+double Percentile(std::vector<double> &Sorted, double Fraction)
+{
+    return Sorted[std::min((std::size_t) (Fraction * Sorted.size()), Sorted.size() - 1)];
+}
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN);
+    pthread_mutex_init(&KWMThread.Lock, NULL);
+    KwmInitStubBackend(8);
+    KwmInitInterpreter();
+
+    KwmDaemonPort = 3023;
+    if(!KwmStartDaemon())
+    {
+        printf("contention: could not listen on port %d\n", KwmDaemonPort);
+        return 1;
+    }
+
+    pthread_t Daemon;
+    pthread_create(&Daemon, NULL, &KwmDaemonHandleConnectionBG, NULL);
+
+    std::vector<double> Idle, Loaded;
+    RunMutations(Idle);
+
+    pthread_t Clients[CLIENTS];
+    ClientsRunning = true;
+    for(long Index = 0; Index < CLIENTS; ++Index)
+        pthread_create(&Clients[Index], NULL, &QueryClient, (void *) Index);
+
+    usleep(100000);
+    unsigned int Builds = __sync_add_and_fetch(&KwmQuerySnapshotBuilds, 0);
+    int Mutations = RunMutations(Loaded);
+    Builds = __sync_add_and_fetch(&KwmQuerySnapshotBuilds, 0) - Builds;
+
+    ClientsRunning = false;
+    long Total = 0;
+    for(int Index = 0; Index < CLIENTS; ++Index)
+    {
+        pthread_join(Clients[Index], NULL);
+        Total += Answered[Index];
+    }
+
+    int Failures = 0;
+    if(Total == 0)
+    {
+        printf("contention: no query was answered\n");
+        ++Failures;
+    }
+
+    /* One build per generation for every distinct query, plus the generation that
+     * was current when the measurement started. */
+    if(Builds > (unsigned int) (Mutations + 1) * QUERIES)
+    {
+        printf("contention: queries took the lock %u times for %d mutations\n", Builds, Mutations);
+        ++Failures;
+    }
+
+    /* A build holds the lock for a few microseconds; a wait of a millisecond would
+     * mean that queries render their responses under the lock one by one again. */
+    if(Percentile(Loaded, 0.99) > 1000)
+    {
+        printf("contention: mutations waited %.1fus for the lock under query load\n", Percentile(Loaded, 0.99));
+        ++Failures;
+    }
+
+    printf("contention: idle     lock wait p50 %7.1fus  p99 %7.1fus  max %7.1fus\n",
+           Percentile(Idle, 0.5), Percentile(Idle, 0.99), Idle.back());
+    printf("contention: queries  lock wait p50 %7.1fus  p99 %7.1fus  max %7.1fus\n",
+           Percentile(Loaded, 0.5), Percentile(Loaded, 0.99), Loaded.back());
+    printf("contention: %ld queries answered with %u snapshot builds for %d mutations, %s\n",
+           Total, Builds, Mutations, Failures ? "FAILED" : "ok");
+
+    KwmTerminateDaemon();
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+#include "../kwm/types.h"
+#include "../kwm/daemon.h"
+#include "../kwm/state.h"
+
+#include <new>
+
+/* Moving focus emits a focus event and rewrites the state page. Without a
+ * subscriber, neither may touch the heap. The window backend is the one of
+ * kwm-stub; operator new is replaced to count every allocation made while
+ * Counting is set. */
+
+bool Counting = false;
+long Allocations = 0;
+
+void *operator new(std::size_t Size)
+{
+    if(Counting)
+        ++Allocations;
+
+    void *Memory = malloc(Size ? Size : 1);
+    if(!Memory)
+        throw std::bad_alloc();
+
+    return Memory;
+}
+
+void operator delete(void *Memory) noexcept
+{
+    free(Memory);
+}
+
+void operator delete(void *Memory, std::size_t) noexcept
+{
+    free(Memory);
+}
+
+extern kwm_path KWMPath;
+extern kwm_focus KWMFocus;
+extern kwm_state_page *KwmStatePage;
+
+void KwmInitStubBackend(int Windows);
+void ShiftWindowFocus(int Shift);
+void SwapFocusedWindowWithNearest(int Shift);
+
+int main()
+{
+    char Home[] = "/tmp/kwm-focus-XXXXXX";
+    if(!mkdtemp(Home))
+    {
+        printf("focus: could not create a directory for the state page\n");
+        return 1;
+    }
+
+    KWMPath.EnvHome = Home;
+    KWMPath.ConfigFolder = ".";
+    KwmInitStubBackend(8);
+    if(!KwmOpenStatePage())
+    {
+        printf("focus: could not open the state page\n");
+        return 1;
+    }
+
+    int Failures = 0;
+    Allocations = 0;
+    Counting = true;
+    for(int Repeat = 0; Repeat < 100; ++Repeat)
+        ShiftWindowFocus(1);
+    Counting = false;
+
+    if(Allocations)
+    {
+        printf("focus: moving focus allocated %.2f times\n", Allocations / 100.0);
+        ++Failures;
+    }
+
+    Allocations = 0;
+    Counting = true;
+    for(int Repeat = 0; Repeat < 100; ++Repeat)
+        SwapFocusedWindowWithNearest(1);
+    Counting = false;
+
+    if(Allocations)
+    {
+        printf("focus: swapping windows allocated %.2f times\n", Allocations / 100.0);
+        ++Failures;
+    }
+
+    kwm_state_page Snapshot;
+    if(!ReadStatePage(KwmStatePage, &Snapshot) ||
+       Snapshot.FocusedWindowID != KWMFocus.Window->WID ||
+       KWMFocus.Window->Owner != Snapshot.Owner ||
+       strcmp(Snapshot.Tag, "[bsp]") != 0)
+    {
+        printf("focus: the state page does not describe the focused window\n");
+        ++Failures;
+    }
+
+    KwmCloseStatePage();
+    std::string File = std::string(Home) + "/./" + KWM_STATE_PAGE_FILE;
+    unlink(File.c_str());
+    rmdir(Home);
+
+    printf("focus: %s\n", Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
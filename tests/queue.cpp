@@ -0,0 +1,147 @@
+#include "../kwm/queue.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+/* The producer pushes numbered events as fast as it can, the way a flood of key
+ * presses reaches the event tap, and the consumer drains the ring the way the
+ * hotkey thread does. Every field of an event is derived from its number, so an
+ * event that was read before it was completely written, read twice or reordered
+ * is caught. Events may be dropped while the ring is full, but every push must
+ * either arrive or be counted as dropped. The producer yields after a drop so
+ * that the two sides also interleave on a single core. */
+
+#define EVENTS 2000000
+
+kwm_key_queue Queue;
+std::atomic<bool> ProducerDone(false);
+long Popped = 0;
+long Corrupt = 0;
+long Reordered = 0;
+
+void FillKeyEvent(kwm_key_event *Event, unsigned int Number)
+{
+    Event->Mod = Number;
+    Event->Key = (unsigned short) (Number * 7);
+    Event->Node = (int) (Number ^ 0x5555);
+    Event->Transition = Number & 1;
+}
+
+bool IsKeyEventConsistent(kwm_key_event *Event)
+{
+    unsigned int Number = Event->Mod;
+    return Event->Key == (unsigned short) (Number * 7) &&
+           Event->Node == (int) (Number ^ 0x5555) &&
+           Event->Transition == (bool) (Number & 1);
+}
+
+void *KeyConsumer(void *Data)
+{
+    bool First = true;
+    unsigned int Last = 0;
+    while(true)
+    {
+        kwm_key_event Event;
+        while(KwmPopKeyEvent(&Queue, &Event))
+        {
+            if(!IsKeyEventConsistent(&Event))
+                ++Corrupt;
+            else if(!First && Event.Mod <= Last)
+                ++Reordered;
+
+            First = false;
+            Last = Event.Mod;
+            ++Popped;
+        }
+
+        if(ProducerDone && Queue.Head.load() == Queue.Tail.load())
+            break;
+
+        KwmWaitForKeyEvent(&Queue, 0.01);
+    }
+
+    return NULL;
+}
+
+long RunFlood(long *Pushed)
+{
+    Popped = Corrupt = Reordered = 0;
+    ProducerDone = false;
+    KwmInitKeyQueue(&Queue);
+
+    pthread_t Consumer;
+    pthread_create(&Consumer, NULL, KeyConsumer, NULL);
+
+    *Pushed = 0;
+    for(unsigned int Number = 0; Number < EVENTS; ++Number)
+    {
+        kwm_key_event Event;
+        FillKeyEvent(&Event, Number);
+        if(KwmPushKeyEvent(&Queue, &Event))
+            ++*Pushed;
+        else
+            sched_yield();
+    }
+
+    ProducerDone = true;
+    pthread_join(Consumer, NULL);
+    return KwmGetDroppedKeyEvents(&Queue);
+}
+
+int main()
+{
+    int Failures = 0;
+    long Pushed = 0;
+    long Dropped = RunFlood(&Pushed);
+    if(Corrupt || Reordered)
+    {
+        printf("queue: %ld corrupt and %ld reordered events\n", Corrupt, Reordered);
+        ++Failures;
+    }
+
+    if(Popped != Pushed || Pushed + Dropped != EVENTS)
+    {
+        printf("queue: %d events, %ld pushed, %ld popped, %ld dropped\n", EVENTS, Pushed, Popped, Dropped);
+        ++Failures;
+    }
+
+    /* A burst that fits in the ring is never dropped, even with nobody popping. */
+    KwmInitKeyQueue(&Queue);
+    for(unsigned int Number = 0; Number < KWM_KEY_QUEUE_SIZE; ++Number)
+    {
+        kwm_key_event Event;
+        FillKeyEvent(&Event, Number);
+        KwmPushKeyEvent(&Queue, &Event);
+    }
+
+    kwm_key_event Event;
+    FillKeyEvent(&Event, KWM_KEY_QUEUE_SIZE);
+    if(KwmGetDroppedKeyEvents(&Queue) != 0 || KwmPushKeyEvent(&Queue, &Event) ||
+       KwmGetDroppedKeyEvents(&Queue) != 1)
+    {
+        printf("queue: a full ring did not hold exactly %d events\n", KWM_KEY_QUEUE_SIZE);
+        ++Failures;
+    }
+
+    for(unsigned int Number = 0; Number < KWM_KEY_QUEUE_SIZE; ++Number)
+    {
+        if(!KwmPopKeyEvent(&Queue, &Event) || Event.Mod != Number || !IsKeyEventConsistent(&Event))
+        {
+            printf("queue: event %u of a full ring came back wrong\n", Number);
+            ++Failures;
+            break;
+        }
+    }
+
+    /* Every push posted the semaphore, so drain those before timing out. */
+    while(KwmWaitForKeyEvent(&Queue, 0));
+    if(KwmPopKeyEvent(&Queue, &Event) || KwmWaitForKeyEvent(&Queue, 0.01))
+    {
+        printf("queue: an empty ring returned an event\n");
+        ++Failures;
+    }
+
+    printf("queue: %ld of %d events delivered, %ld dropped, %s\n", Popped, EVENTS, Dropped, Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}
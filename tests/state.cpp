@@ -0,0 +1,136 @@
+#include "../kwm/state.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+/* Writers serialise on a mutex the same way KwmUpdateStatePage does, while the
+ * readers copy the page as fast as they can. Every field of a page is derived
+ * from one counter, so a snapshot that mixes two writes is caught. */
+
+#define WRITERS 2
+#define READERS 2
+#define WRITES_PER_WRITER 1000000
+
+kwm_state_page Page;
+pthread_mutex_t PageLock = PTHREAD_MUTEX_INITIALIZER;
+std::atomic<int> WritersDone(0);
+std::atomic<long> TornReads(0);
+std::atomic<long> Reads(0);
+
+void FillStatePage(kwm_state_page *Page, int32_t Value)
+{
+    Page->FocusedWindowID = Value;
+    Page->MarkedWindowID = -Value;
+    Page->DisplayID = Value ^ 0x5555;
+    Page->SpaceID = Value + 1;
+    Page->TilingMode = Value % 3;
+    Page->PrefixActive = Value & 1;
+    Page->SplitRatio = Value * 0.5;
+
+    /* Byte by byte, so that a write takes long enough to be interrupted. */
+    volatile char *Title = Page->Title;
+    for(size_t Index = 0; Index < sizeof(Page->Title) - 1; ++Index)
+        Title[Index] = 'a' + Value % 26;
+
+    memset(Page->Tag, 'a' + Value % 26, sizeof(Page->Tag) - 1);
+    memset(Page->Owner, 'a' + Value % 26, sizeof(Page->Owner) - 1);
+}
+
+bool IsStatePageConsistent(kwm_state_page *Page)
+{
+    int32_t Value = Page->FocusedWindowID;
+    if(Page->MarkedWindowID != -Value ||
+       Page->DisplayID != (Value ^ 0x5555) ||
+       Page->SpaceID != Value + 1 ||
+       Page->TilingMode != Value % 3 ||
+       Page->PrefixActive != (Value & 1) ||
+       Page->SplitRatio != Value * 0.5)
+        return false;
+
+    char Fill = 'a' + Value % 26;
+    for(size_t Index = 0; Index < sizeof(Page->Title) - 1; ++Index)
+    {
+        if(Page->Title[Index] != Fill ||
+           (Index < sizeof(Page->Owner) - 1 && Page->Owner[Index] != Fill) ||
+           (Index < sizeof(Page->Tag) - 1 && Page->Tag[Index] != Fill))
+            return false;
+    }
+
+    return true;
+}
+
+void *StateWriter(void *Data)
+{
+    long Offset = (long) Data;
+    for(int Index = 0; Index < WRITES_PER_WRITER; ++Index)
+    {
+        pthread_mutex_lock(&PageLock);
+        BeginStatePageWrite(&Page);
+        FillStatePage(&Page, Index * WRITERS + Offset);
+        EndStatePageWrite(&Page);
+        pthread_mutex_unlock(&PageLock);
+    }
+
+    ++WritersDone;
+    return NULL;
+}
+
+void *StateReader(void *Data)
+{
+    while(WritersDone < WRITERS)
+    {
+        kwm_state_page Snapshot;
+        if(ReadStatePage(&Page, &Snapshot))
+        {
+            ++Reads;
+            if(!IsStatePageConsistent(&Snapshot))
+                ++TornReads;
+        }
+    }
+
+    return NULL;
+}
+
+int main()
+{
+    Page.Magic = KWM_STATE_PAGE_MAGIC;
+    Page.Version = KWM_STATE_PAGE_VERSION;
+    FillStatePage(&Page, 0);
+
+    pthread_t Threads[WRITERS + READERS];
+    for(long Index = 0; Index < READERS; ++Index)
+        pthread_create(&Threads[Index], NULL, StateReader, NULL);
+    for(long Index = 0; Index < WRITERS; ++Index)
+        pthread_create(&Threads[READERS + Index], NULL, StateWriter, (void*) Index);
+    for(int Index = 0; Index < WRITERS + READERS; ++Index)
+        pthread_join(Threads[Index], NULL);
+
+    int Failures = 0;
+    if(TornReads != 0)
+    {
+        printf("state: %ld of %ld snapshots were torn\n", TornReads.load(), Reads.load());
+        ++Failures;
+    }
+
+    /* A writer that died between BeginStatePageWrite and EndStatePageWrite. */
+    kwm_state_page Snapshot;
+    BeginStatePageWrite(&Page);
+    if(ReadStatePage(&Page, &Snapshot))
+    {
+        printf("state: read succeeded while a write was in progress\n");
+        ++Failures;
+    }
+
+    EndStatePageWrite(&Page);
+    Page.Version = KWM_STATE_PAGE_VERSION + 1;
+    if(ReadStatePage(&Page, &Snapshot))
+    {
+        printf("state: read succeeded on a page of another version\n");
+        ++Failures;
+    }
+
+    printf("state: %ld snapshots, %s\n", Reads.load(), Failures ? "FAILED" : "ok");
+    return Failures ? 1 : 0;
+}